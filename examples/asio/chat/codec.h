@@ -52,6 +52,16 @@ class LengthHeaderCodec : boost::noncopyable
   }
 
   // FIXME: TcpConnectionPtr
+  // Frames message once, for sending to many connections.
+  static muduo::net::TcpConnection::SharedMessage encode(const muduo::StringPiece& message)
+  {
+    int32_t len = static_cast<int32_t>(message.size());
+    int32_t be32 = muduo::net::sockets::hostToNetwork32(len);
+    muduo::string* encoded = new muduo::string(reinterpret_cast<const char*>(&be32), sizeof be32);
+    encoded->append(message.data(), message.size());
+    return muduo::net::TcpConnection::SharedMessage(encoded);
+  }
+
   void send(muduo::net::TcpConnection* conn,
             const muduo::StringPiece& message)
   {
@@ -62,7 +62,9 @@ class ChatServer : boost::noncopyable
                        const string& message,
                        Timestamp)
   {
-    EventLoop::Functor f = boost::bind(&ChatServer::distributeMessage, this, message);
+    // framed once, each loop gets a reference
+    EventLoop::Functor f = boost::bind(&ChatServer::distributeMessage, this,
+                                       LengthHeaderCodec::encode(message));
     LOG_DEBUG;
 
     MutexLockGuard lock(mutex_);
@@ -77,14 +79,14 @@ class ChatServer : boost::noncopyable
 
   typedef std::set<TcpConnectionPtr> ConnectionList;
 
-  void distributeMessage(const string& message)
+  void distributeMessage(const TcpConnection::SharedMessage& message)
   {
     LOG_DEBUG << "begin";
     for (ConnectionList::iterator it = connections_.instance().begin();
         it != connections_.instance().end();
         ++it)
     {
-      codec_.send(get_pointer(*it), message);
+      (*it)->send(message);
     }
     LOG_DEBUG << "end";
   }
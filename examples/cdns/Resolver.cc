@@ -16,7 +16,9 @@
 #include <assert.h>
 
 using namespace muduo;
-using namespace muduo::net;
+using muduo::net::Channel;
+using muduo::net::EventLoop;
+using muduo::net::InetAddress;
 using namespace cdns;
 
 namespace
@@ -4,7 +4,8 @@
 #include <stdio.h>
 
 using namespace muduo;
-using namespace muduo::net;
+using muduo::net::EventLoop;
+using muduo::net::InetAddress;
 using namespace cdns;
 
 EventLoop* g_loop;
@@ -17,6 +17,7 @@ namespace pubsub
 {
 
 typedef std::set<string> ConnectionSubscription;
+const ContextSlot<ConnectionSubscription> kSubscription;
 
 class Topic : public muduo::copyable
 {
@@ -44,7 +45,8 @@ class Topic : public muduo::copyable
   {
     content_ = content;
     lastPubTime_ = time;
-    string message = makeMessage();
+    // one copy shared by all audiences
+    TcpConnection::SharedMessage message(new string(makeMessage()));
     for (std::set<TcpConnectionPtr>::iterator it = audiences_.begin();
          it != audiences_.end();
          ++it)
@@ -91,12 +93,11 @@ class PubSubServer : boost::noncopyable
   {
     if (conn->connected())
     {
-      conn->setContext(ConnectionSubscription());
+      conn->setContext(kSubscription, new ConnectionSubscription);
     }
     else
     {
-      const ConnectionSubscription& connSub
-        = boost::any_cast<const ConnectionSubscription&>(conn->getContext());
+      const ConnectionSubscription& connSub = *conn->getContext(kSubscription);
       for (ConnectionSubscription::const_iterator it = connSub.begin();
            it != connSub.end();
            ++it)
@@ -154,8 +155,7 @@ class PubSubServer : boost::noncopyable
   void doSubscribe(const TcpConnectionPtr& conn,
                    const string& topic)
   {
-    ConnectionSubscription* connSub
-      = boost::any_cast<ConnectionSubscription>(conn->getMutableContext());
+    ConnectionSubscription* connSub = conn->getContext(kSubscription);
 
     connSub->insert(topic);
     getTopic(topic).add(conn);
@@ -165,8 +165,7 @@ class PubSubServer : boost::noncopyable
                      const string& topic)
   {
     LOG_INFO << conn->name() << " unsubscribes " << topic;
-    ConnectionSubscription* connSub
-      = boost::any_cast<ConnectionSubscription>(conn->getMutableContext());
+    ConnectionSubscription* connSub = conn->getContext(kSubscription);
     connSub->erase(topic);
     getTopic(topic).remove(conn);
   }
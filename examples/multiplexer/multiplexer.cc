@@ -26,6 +26,7 @@ const size_t kHeaderLen = 3;
 const uint16_t kClientPort = 3333;
 const char* backendIp = "127.0.0.1";
 const uint16_t kBackendPort = 9999;
+const ContextSlot<int> kClientId;
 
 class MultiplexServer
 {
@@ -165,7 +166,7 @@ class MultiplexServer
       }
       else
       {
-        conn->setContext(id);
+        conn->setContext(kClientId, new int(id));
         char buf[256];
         snprintf(buf, sizeof(buf), "CONN %d FROM %s IS UP\r\n", id,
                  conn->peerAddress().toIpPort().c_str());
@@ -174,9 +175,9 @@ class MultiplexServer
     }
     else
     {
-      if (!conn->getContext().empty())
+      if (int* clientId = conn->getContext(kClientId))
       {
-        int id = boost::any_cast<int>(conn->getContext());
+        int id = *clientId;
         assert(id > 0 && id <= kMaxConns);
         char buf[256];
         snprintf(buf, sizeof(buf), "CONN %d FROM %s IS DOWN\r\n",
@@ -203,10 +204,9 @@ class MultiplexServer
     size_t len = buf->readableBytes();
     transferred_.addAndGet(len);
     receivedMessages_.incrementAndGet();
-    if (!conn->getContext().empty())
+    if (int* clientId = conn->getContext(kClientId))
     {
-      int id = boost::any_cast<int>(conn->getContext());
-      sendBackendBuffer(id, buf);
+      sendBackendBuffer(*clientId, buf);
       // assert(buf->readableBytes() == 0);
     }
     else
@@ -1,27 +1,20 @@
 #ifndef MUDUO_EXAMPLES_WORDCOUNT_HASH_H
 #define MUDUO_EXAMPLES_WORDCOUNT_HASH_H
 
-namespace boost
-{
-std::size_t hash_value(const muduo::string& x);
-}
-
 #include <boost/unordered_map.hpp>
 
-namespace boost
+#ifndef MUDUO_STD_STRING
+// muduo::string is __gnu_cxx::__sso_string, define hash_value() in its
+// namespace so it's found by ADL no matter which header includes
+// boost/unordered_map.hpp first (muduo/net/TcpServer.h does).
+namespace __gnu_cxx
 {
 inline std::size_t hash_value(const muduo::string& x)
 {
-  return hash_range(x.begin(), x.end());
+  return boost::hash_range(x.begin(), x.end());
 }
-// template <> struct hash<muduo::string>
-// {
-//   std::size_t operator()(const muduo::string& v) const
-//   {
-//     return hash_value(v);
-//   }
-// };
 }
+#endif
 
 typedef boost::unordered_map<muduo::string, int64_t> WordCountMap;
 
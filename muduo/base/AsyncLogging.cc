@@ -1,11 +1,222 @@
 #include <muduo/base/AsyncLogging.h>
+#include <muduo/base/BinaryLogging.h>
 #include <muduo/base/LogFile.h>
 #include <muduo/base/Timestamp.h>
 
+#include <algorithm>
+
 #include <stdio.h>
 
 using namespace muduo;
 
+namespace
+{
+
+// in front of every line in staging rings and shared buffers
+struct RecordHeader
+{
+  int64_t time;  // microseconds since epoch
+  int32_t len;
+  int32_t padding;
+};
+
+// Logger puts the level at a fixed column, after the time and the tid.
+const int kLevelColumn = 32;
+
+Logger::LogLevel levelOf(const char* logline, int len)
+{
+  if (len >= static_cast<int>(sizeof(BinaryLogger::Header))
+      && static_cast<unsigned char>(logline[0]) == BinaryLogger::kMagic)
+  {
+    BinaryLogger::Header header;
+    memcpy(&header, logline, sizeof header);
+    return header.level < Logger::NUM_LOG_LEVELS
+        ? static_cast<Logger::LogLevel>(header.level) : Logger::WARN;
+  }
+  if (len >= kLevelColumn + 6)
+  {
+    for (int i = 0; i < Logger::NUM_LOG_LEVELS; ++i)
+    {
+      if (memcmp(logline + kLevelColumn,
+                 Logger::levelName(static_cast<Logger::LogLevel>(i)), 6) == 0)
+      {
+        return static_cast<Logger::LogLevel>(i);
+      }
+    }
+  }
+  return Logger::WARN;
+}
+
+}
+
+// Single producer, single consumer byte ring of records.
+// The owner thread appends, the logging thread drains.
+class AsyncLogging::Staging : boost::noncopyable
+{
+ public:
+  static const size_t kSize = 128 * 1024;  // power of 2
+
+  Staging()
+    : data_(new char[kSize]),
+      head_(0),
+      tail_(0),
+      closed_(0),
+      refs_(2),
+      lastTime_(0),
+      spilledRound_(-1)
+  {
+  }
+
+  ~Staging()
+  {
+    delete[] data_;
+  }
+
+  // false if there is no room, *halfFull tells when this one filled it
+  // past the half, time to wake the logging thread.
+  bool append(int64_t now, const char* logline, int len, bool* halfFull)
+  {
+    // strictly increasing, so that the merge never swaps two lines of a thread
+    RecordHeader header = { std::max(now, lastTime_ + 1), len, 0 };
+    size_t need = sizeof header + static_cast<size_t>(len);
+    size_t tail = tail_;
+    size_t used = tail - __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+    if (used + need > kSize)
+    {
+      return false;
+    }
+    put(tail, &header, sizeof header);
+    put(tail + sizeof header, logline, static_cast<size_t>(len));
+    __atomic_store_n(&tail_, tail + need, __ATOMIC_RELEASE);
+    lastTime_ = header.time;
+    *halfFull = used < kSize / 2 && used + need >= kSize / 2;
+    return true;
+  }
+
+  // by the logging thread, appends all complete records to *out
+  void drainTo(std::vector<char>* out)
+  {
+    size_t head = head_;
+    size_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+    size_t n = tail - head;
+    if (n > 0)
+    {
+      size_t old = out->size();
+      out->resize(old + n);
+      get(head, &(*out)[old], n);
+      __atomic_store_n(&head_, tail, __ATOMIC_RELEASE);
+    }
+  }
+
+  // by the owner, when it exits
+  void close() { __atomic_store_n(&closed_, 1, __ATOMIC_RELEASE); }
+  bool closed() const { return __atomic_load_n(&closed_, __ATOMIC_ACQUIRE) != 0; }
+
+  // by the owner and by the AsyncLogging, true for the last one, who frees it
+  bool release() { return __atomic_sub_fetch(&refs_, 1, __ATOMIC_ACQ_REL) == 0; }
+
+  // by the owner, stamp of its last line, in this ring or in the shared buffer
+  int64_t lastTime() const { return lastTime_; }
+  void setLastTime(int64_t time) { lastTime_ = time; }
+
+  // by the owner, round of the shared buffer its last spilled line went to
+  int64_t spilledRound() const { return spilledRound_; }
+  void setSpilledRound(int64_t round) { spilledRound_ = round; }
+
+ private:
+  void put(size_t pos, const void* src, size_t n)
+  {
+    size_t offset = pos & (kSize - 1);
+    size_t first = std::min(n, kSize - offset);
+    memcpy(data_ + offset, src, first);
+    memcpy(data_, static_cast<const char*>(src) + first, n - first);
+  }
+
+  void get(size_t pos, char* dst, size_t n) const
+  {
+    size_t offset = pos & (kSize - 1);
+    size_t first = std::min(n, kSize - offset);
+    memcpy(dst, data_ + offset, first);
+    memcpy(dst + first, data_, n - first);
+  }
+
+  char* const data_;
+  size_t head_;   // written by the logging thread
+  char pad_[64];
+  size_t tail_;   // written by the owner
+  int closed_;
+  int refs_;
+  int64_t lastTime_;  // owner only
+  int64_t spilledRound_;  // owner only
+};
+
+// Per thread.  The ring is shared by its owner and the AsyncLogging,
+// so either may go first.
+struct AsyncLogging::StagingHandle : boost::noncopyable
+{
+  StagingHandle()
+    : staging(NULL)
+  {
+  }
+
+  ~StagingHandle()
+  {
+    if (staging)
+    {
+      staging->close();
+      if (staging->release())
+      {
+        delete staging;
+      }
+    }
+  }
+
+  Staging* staging;
+};
+
+// Records of one thread (or of the shared buffers) in append() order.
+struct AsyncLogging::Source
+{
+  Source(const char* b, const char* e)
+    : cur(b), end(e)
+  {
+    readHeader();
+  }
+
+  void readHeader()
+  {
+    RecordHeader header;
+    memcpy(&header, cur, sizeof header);
+    time = header.time;
+    len = header.len;
+  }
+
+  const char* line() const { return cur + sizeof(RecordHeader); }
+
+  // false when there is no more
+  bool next()
+  {
+    cur += sizeof(RecordHeader) + static_cast<size_t>(len);
+    if (cur < end)
+    {
+      readHeader();
+      return true;
+    }
+    return false;
+  }
+
+  // for a min-heap on time
+  bool operator<(const Source& rhs) const
+  {
+    return time > rhs.time;
+  }
+
+  const char* cur;
+  const char* end;
+  int64_t time;
+  int len;
+};
+
 AsyncLogging::AsyncLogging(const string& basename,
                            size_t rollSize,
                            int flushInterval)
@@ -13,24 +224,200 @@ AsyncLogging::AsyncLogging(const string& basename,
     running_(false),
     basename_(basename),
     rollSize_(rollSize),
+    backgroundRoll_(false),
+    compress_(false),
+    maxFiles_(0),
+    maxBytes_(0),
     thread_(boost::bind(&AsyncLogging::threadFunc, this), "Logging"),
     latch_(1),
+    memoryBudget_(100*1000*1000),
+    blockLevel_(Logger::ERROR),
+    bufferPoolSize_(4),
     mutex_(),
     cond_(mutex_),
+    notFull_(mutex_),
+    wakeUp_(false),
+    droppedToReport_(0),
+    lastSharedTime_(0),
+    round_(0),
     currentBuffer_(new Buffer),
     nextBuffer_(new Buffer),
-    buffers_()
+    buffers_(),
+    freeBuffers_()
 {
   currentBuffer_->bzero();
   nextBuffer_->bzero();
   buffers_.reserve(16);
 }
 
+// bzero() touches every page, so that the first burst does not fault them in
+void AsyncLogging::preallocate()
+{
+  muduo::MutexLockGuard lock(mutex_);
+  while (freeBuffers_.size() < static_cast<size_t>(bufferPoolSize_))
+  {
+    BufferPtr buffer(new Buffer);
+    buffer->bzero();
+    freeBuffers_.push_back(buffer.release());
+  }
+}
+
+size_t AsyncLogging::numFreeBuffers() const
+{
+  muduo::MutexLockGuard lock(mutex_);
+  return freeBuffers_.size();
+}
+
+AsyncLogging::~AsyncLogging()
+{
+  if (running_)
+  {
+    stop();
+  }
+  // rings of threads still running are freed when they exit
+  muduo::MutexLockGuard lock(mutex_);
+  for (size_t i = 0; i < stagings_.size(); ++i)
+  {
+    if (stagings_[i]->release())
+    {
+      delete stagings_[i];
+    }
+  }
+}
+
 void AsyncLogging::append(const char* logline, int len)
 {
+  Staging* staging = stagingOfThisThread();
+  if (!appendStaged(staging, logline, len))
+  {
+    // the level matters only where lines may be dropped
+    appendShared(staging, logline, len, levelOf(logline, len));
+  }
+}
+
+void AsyncLogging::append(const char* logline, int len, Logger::LogLevel level)
+{
+  Staging* staging = stagingOfThisThread();
+  if (!appendStaged(staging, logline, len))
+  {
+    appendShared(staging, logline, len, level);
+  }
+}
+
+bool AsyncLogging::appendStaged(Staging* staging, const char* logline, int len)
+{
+  // After a spill, the next line could fit the ring and be drained in
+  // the round going on, ahead of the spilled one still in currentBuffer_.
+  // So follow it to the shared buffer until the logging thread took that.
+  if (staging->spilledRound() == __atomic_load_n(&round_, __ATOMIC_ACQUIRE))
+  {
+    return false;
+  }
+  int64_t now = Timestamp::now().microSecondsSinceEpoch();
+  bool halfFull = false;
+  if (!staging->append(now, logline, len, &halfFull))
+  {
+    return false;
+  }
+  if (halfFull)
+  {
+    wakeUp();
+  }
+  return true;
+}
+
+AsyncLogging::Staging* AsyncLogging::stagingOfThisThread()
+{
+  StagingHandle& handle = stagingOfThread_.value();
+  if (handle.staging == NULL)
+  {
+    handle.staging = new Staging;
+    muduo::MutexLockGuard lock(mutex_);
+    stagings_.push_back(handle.staging);
+  }
+  return handle.staging;
+}
+
+void AsyncLogging::wakeUp()
+{
+  {
   muduo::MutexLockGuard lock(mutex_);
-  if (currentBuffer_->avail() > len)
+  wakeUp_ = true;
+  }
+  cond_.notify();
+}
+
+size_t AsyncLogging::pendingBytes() const
+{
+  muduo::MutexLockGuard lock(mutex_);
+  return pendingBytesLocked();
+}
+
+size_t AsyncLogging::pendingBytesLocked() const
+{
+  return buffers_.size() * muduo::detail::kLargeBuffer
+      + (currentBuffer_ ? static_cast<size_t>(currentBuffer_->length()) : 0);
+}
+
+// false if the line is to be dropped
+bool AsyncLogging::admitLocked(Logger::LogLevel level, int need)
+{
+  size_t pending = pendingBytesLocked();
+  if (level >= blockLevel_)
   {
+    bool blocked = false;
+    // something pending, or a budget smaller than one line would never admit it
+    while (running_ && pending > 0 && pending + static_cast<size_t>(need) > memoryBudget_)
+    {
+      if (!blocked)
+      {
+        blocked = true;
+        blockedLines_.increment();
+      }
+      wakeUp_ = true;
+      cond_.notify();
+      notFull_.wait();
+      pending = pendingBytesLocked();
+    }
+    return true;
+  }
+
+  size_t limit = memoryBudget_;
+  if (level <= Logger::DEBUG)
+  {
+    limit = memoryBudget_ / 2;
+  }
+  else if (level == Logger::INFO)
+  {
+    limit = memoryBudget_ / 4 * 3;
+  }
+  return pending == 0 || pending + static_cast<size_t>(need) <= limit;
+}
+
+// the staging ring is full, or the line is larger than it,
+// or an earlier line of the thread is still in currentBuffer_.
+void AsyncLogging::appendShared(Staging* staging, const char* logline, int len,
+                                Logger::LogLevel level)
+{
+  int need = static_cast<int>(sizeof(RecordHeader)) + len;
+  muduo::MutexLockGuard lock(mutex_);
+  if (!admitLocked(level, need))
+  {
+    droppedLines_[level].increment();
+    droppedBytes_[level].add(len);
+    ++droppedToReport_;
+    return;
+  }
+  // stamped under the lock and strictly increasing, so that the shared
+  // buffers read as one source in time order
+  int64_t now = Timestamp::now().microSecondsSinceEpoch();
+  lastSharedTime_ = std::max(now, std::max(lastSharedTime_, staging->lastTime()) + 1);
+  RecordHeader header = { lastSharedTime_, len, 0 };
+  staging->setLastTime(header.time);
+  staging->setSpilledRound(round_);
+  if (currentBuffer_->avail() > need)
+  {
+    currentBuffer_->append(reinterpret_cast<const char*>(&header), sizeof header);
     currentBuffer_->append(logline, len);
   }
   else
@@ -41,11 +428,20 @@ void AsyncLogging::append(const char* logline, int len)
     {
       currentBuffer_ = boost::ptr_container::move(nextBuffer_);
     }
+    else if (!freeBuffers_.empty())
+    {
+      currentBuffer_ = freeBuffers_.pop_back();
+    }
     else
     {
       currentBuffer_.reset(new Buffer); // Rarely happens
     }
-    currentBuffer_->append(logline, len);
+    if (currentBuffer_->avail() > need)
+    {
+      currentBuffer_->append(reinterpret_cast<const char*>(&header), sizeof header);
+      currentBuffer_->append(logline, len);
+    }
+    wakeUp_ = true;
     cond_.notify();
   }
 }
@@ -55,13 +451,27 @@ void AsyncLogging::threadFunc()
   assert(running_ == true);
   latch_.countDown();
   LogFile output(basename_, rollSize_, false);
+  if (backgroundRoll_)
+  {
+    output.startBackgroundRoll(compress_, maxFiles_, maxBytes_);
+  }
+  if (fileHeader_)
+  {
+    output.setHeader(fileHeader_);
+  }
   BufferPtr newBuffer1(new Buffer);
   BufferPtr newBuffer2(new Buffer);
   newBuffer1->bzero();
   newBuffer2->bzero();
   BufferVector buffersToWrite;
   buffersToWrite.reserve(16);
-  while (running_)
+  std::vector<Staging*> stagings;
+  std::vector<char> staged;
+  std::vector<size_t> stagedEnds;
+  std::vector<Source> sources;
+  int64_t dropped = 0;
+  bool running = true;
+  while (running)
   {
     assert(newBuffer1 && newBuffer1->length() == 0);
     assert(newBuffer2 && newBuffer2->length() == 0);
@@ -69,10 +479,13 @@ void AsyncLogging::threadFunc()
 
     {
       muduo::MutexLockGuard lock(mutex_);
-      if (buffers_.empty())  // unusual usage!
+      if (!wakeUp_ && running_)  // unusual usage!
       {
         cond_.waitForSeconds(flushInterval_);
       }
+      wakeUp_ = false;
+      running = running_;  // one more round after stop()
+      __atomic_store_n(&round_, round_ + 1, __ATOMIC_RELEASE);
       buffers_.push_back(currentBuffer_.release());
       currentBuffer_ = boost::ptr_container::move(newBuffer1);
       buffersToWrite.swap(buffers_);
@@ -80,31 +493,79 @@ void AsyncLogging::threadFunc()
       {
         nextBuffer_ = boost::ptr_container::move(newBuffer2);
       }
+      stagings = stagings_;
+      dropped = droppedToReport_;
+      droppedToReport_ = 0;
+      notFull_.notifyAll();
     }
 
     assert(!buffersToWrite.empty());
 
-    if (buffersToWrite.size() > 25)
+    if (dropped > 0)
     {
       char buf[256];
-      snprintf(buf, sizeof buf, "Dropped log messages at %s, %zd larger buffers\n",
-               Timestamp::now().toFormattedString().c_str(),
-               buffersToWrite.size()-2);
+      snprintf(buf, sizeof buf, "Dropped %lld log lines at %s, over memory budget\n",
+               static_cast<long long>(dropped),
+               Timestamp::now().toFormattedString().c_str());
       fputs(buf, stderr);
       output.append(buf, static_cast<int>(strlen(buf)));
-      buffersToWrite.erase(buffersToWrite.begin()+2, buffersToWrite.end());
     }
 
+    // lines are merged by time within a round, a line that goes to the
+    // shared buffer right after the swap above waits for the next round
+    staged.clear();
+    stagedEnds.clear();
+    for (size_t i = 0; i < stagings.size(); ++i)
+    {
+      bool closed = stagings[i]->closed();
+      stagings[i]->drainTo(&staged);
+      stagedEnds.push_back(staged.size());
+      if (closed)
+      {
+        muduo::MutexLockGuard lock(mutex_);
+        stagings_.erase(std::find(stagings_.begin(), stagings_.end(), stagings[i]));
+        if (stagings[i]->release())
+        {
+          delete stagings[i];
+        }
+      }
+    }
+
+    sources.clear();
+    size_t begin = 0;
+    for (size_t i = 0; i < stagedEnds.size(); ++i)
+    {
+      if (stagedEnds[i] > begin)
+      {
+        sources.push_back(Source(&staged[begin], &staged[0] + stagedEnds[i]));
+      }
+      begin = stagedEnds[i];
+    }
     for (size_t i = 0; i < buffersToWrite.size(); ++i)
     {
-      // FIXME: use unbuffered stdio FILE ? or use ::writev ?
-      output.append(buffersToWrite[i].data(), buffersToWrite[i].length());
+      if (buffersToWrite[i].length() > 0)
+      {
+        const char* data = buffersToWrite[i].data();
+        sources.push_back(Source(data, data + buffersToWrite[i].length()));
+      }
     }
 
-    if (buffersToWrite.size() > 2)
+    // merge by time
+    std::make_heap(sources.begin(), sources.end());
+    while (!sources.empty())
     {
-      // drop non-bzero-ed buffers, avoid trashing
-      buffersToWrite.resize(2);
+      std::pop_heap(sources.begin(), sources.end());
+      Source& source = sources.back();
+      // FIXME: use unbuffered stdio FILE ? or use ::writev ?
+      output.append(source.line(), source.len);
+      if (source.next())
+      {
+        std::push_heap(sources.begin(), sources.end());
+      }
+      else
+      {
+        sources.pop_back();
+      }
     }
 
     if (!newBuffer1)
@@ -121,9 +582,21 @@ void AsyncLogging::threadFunc()
       newBuffer2->reset();
     }
 
+    if (!buffersToWrite.empty())
+    {
+      // back to the free list, reset() but not bzero(), the pages are
+      // already mapped; what the list has no room for is freed
+      muduo::MutexLockGuard lock(mutex_);
+      while (!buffersToWrite.empty()
+             && freeBuffers_.size() < static_cast<size_t>(bufferPoolSize_))
+      {
+        BufferPtr buffer(buffersToWrite.pop_back());
+        buffer->reset();
+        freeBuffers_.push_back(buffer.release());
+      }
+    }
     buffersToWrite.clear();
     output.flush();
   }
   output.flush();
 }
-
@@ -1,22 +1,48 @@
 #ifndef MUDUO_BASE_ASYNCLOGGING_H
 #define MUDUO_BASE_ASYNCLOGGING_H
 
+#include <muduo/base/Atomic.h>
 #include <muduo/base/BlockingQueue.h>
 #include <muduo/base/BoundedBlockingQueue.h>
 #include <muduo/base/CountDownLatch.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/base/Thread.h>
+#include <muduo/base/ThreadLocal.h>
 
+#include <muduo/base/Logging.h>
 #include <muduo/base/LogStream.h>
 
 #include <boost/bind.hpp>
+#include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 
+#include <vector>
+
 namespace muduo
 {
 
+///
+/// Log file written by a background thread.
+///
+/// Each thread calling append() gets its own staging ring, which only it
+/// writes and only the logging thread reads, so appending takes no lock
+/// unless the ring is full.  Then the line goes to a shared buffer under
+/// mutex_, as it always did, and so do the thread's next lines until the
+/// logging thread has taken that buffer.  The logging thread merges all
+/// of them by the time append() was called, so the file keeps the order
+/// of calls.
+///
+/// The shared buffers are bounded by a memory budget.  When the logging
+/// thread falls behind, lines are shed by level as they fill up: TRACE and
+/// DEBUG past half of the budget, INFO past 3/4, WARN at the budget.
+/// Lines at or above the block level, ERROR by default, wait for room
+/// instead of being dropped.
+///
+/// The 4MB buffers come from a free list filled at start(), so a burst
+/// of logging does not allocate or page fault in the callers.
+///
 class AsyncLogging : boost::noncopyable
 {
  public:
@@ -25,18 +51,67 @@ class AsyncLogging : boost::noncopyable
                size_t rollSize,
                int flushInterval = 3);
 
-  ~AsyncLogging()
+  ~AsyncLogging();
+
+  /// Thread safe.
+  /// The level is read from the line as formatted by Logger, or from
+  /// a BinaryLogger record, lines in other formats count as WARN.
+  void append(const char* logline, int len);
+
+  /// Thread safe.
+  void append(const char* logline, int len, Logger::LogLevel level);
+
+  /// 100MB by default.  Call before start().
+  void setMemoryBudget(size_t bytes)
+  { memoryBudget_ = bytes; }
+
+  /// Logger::NUM_LOG_LEVELS never blocks.  Call before start().
+  void setBlockLevel(Logger::LogLevel level)
+  { blockLevel_ = level; }
+
+  /// Free buffers kept for reuse, allocated at start(), 4 by default.
+  /// Call before start().
+  void setBufferPoolSize(int n)
+  { bufferPoolSize_ = n; }
+
+  /// See LogFile::startBackgroundRoll().  Call before start().
+  void setBackgroundRoll(bool compress, int maxFiles = 0, int64_t maxBytes = 0)
   {
-    if (running_)
-    {
-      stop();
-    }
+    backgroundRoll_ = true;
+    compress_ = compress;
+    maxFiles_ = maxFiles;
+    maxBytes_ = maxBytes;
   }
 
-  void append(const char* logline, int len);
+  /// See LogFile::setHeader().  Call before start().
+  void setFileHeader(const boost::function<string ()>& header)
+  { fileHeader_ = header; }
+
+  size_t memoryBudget() const { return memoryBudget_; }
+  Logger::LogLevel blockLevel() const { return blockLevel_; }
+
+  /// Thread safe.  Bytes in the shared buffers not taken by the logging
+  /// thread yet; the batch it is writing does not count.
+  size_t pendingBytes() const;
+
+  /// Thread safe.
+  size_t numFreeBuffers() const;
+
+  /// Thread safe.
+  int64_t droppedLines(Logger::LogLevel level) const
+  { return droppedLines_[level].get(); }
+
+  /// Thread safe.
+  int64_t droppedBytes(Logger::LogLevel level) const
+  { return droppedBytes_[level].get(); }
+
+  /// Thread safe.  Lines that had to wait for room.
+  int64_t blockedLines() const
+  { return blockedLines_.get(); }
 
   void start()
   {
+    preallocate();
     running_ = true;
     thread_.start();
     latch_.wait();
@@ -46,6 +121,7 @@ class AsyncLogging : boost::noncopyable
   {
     running_ = false;
     cond_.notify();
+    notFull_.notifyAll();
     thread_.join();
   }
 
@@ -55,6 +131,18 @@ class AsyncLogging : boost::noncopyable
   AsyncLogging(const AsyncLogging&);  // ptr_container
   void operator=(const AsyncLogging&);  // ptr_container
 
+  class Staging;
+  struct StagingHandle;
+  struct Source;
+
+  Staging* stagingOfThisThread();
+  bool appendStaged(Staging* staging, const char* logline, int len);
+  void appendShared(Staging* staging, const char* logline, int len,
+                    Logger::LogLevel level);
+  size_t pendingBytesLocked() const;
+  bool admitLocked(Logger::LogLevel level, int need);
+  void wakeUp();
+  void preallocate();
   void threadFunc();
 
   typedef muduo::detail::FixedBuffer<muduo::detail::kLargeBuffer> Buffer;
@@ -65,13 +153,32 @@ class AsyncLogging : boost::noncopyable
   bool running_;
   string basename_;
   size_t rollSize_;
+  bool backgroundRoll_;
+  bool compress_;
+  int maxFiles_;
+  int64_t maxBytes_;
+  boost::function<string ()> fileHeader_;
   muduo::Thread thread_;
   muduo::CountDownLatch latch_;
-  muduo::MutexLock mutex_;
+  size_t memoryBudget_;
+  Logger::LogLevel blockLevel_;
+  int bufferPoolSize_;
+  mutable muduo::MutexLock mutex_;
   muduo::Condition cond_;
+  muduo::Condition notFull_;
+  bool wakeUp_;                      // @GuardedBy mutex_
+  int64_t droppedToReport_;          // @GuardedBy mutex_
+  int64_t lastSharedTime_;           // @GuardedBy mutex_
+  int64_t round_;                    // written under mutex_, read by append()
+  std::vector<Staging*> stagings_;   // @GuardedBy mutex_
+  ThreadLocal<StagingHandle> stagingOfThread_;
   BufferPtr currentBuffer_;
   BufferPtr nextBuffer_;
   BufferVector buffers_;
+  BufferVector freeBuffers_;         // @GuardedBy mutex_
+  mutable AtomicInt64 droppedLines_[Logger::NUM_LOG_LEVELS];
+  mutable AtomicInt64 droppedBytes_[Logger::NUM_LOG_LEVELS];
+  mutable AtomicInt64 blockedLines_;
 };
 
 }
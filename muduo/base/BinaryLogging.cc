@@ -0,0 +1,445 @@
+#include <muduo/base/BinaryLogging.h>
+#include <muduo/base/CurrentThread.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Timestamp.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+using namespace muduo;
+
+namespace
+{
+
+void defaultOutput(const char* msg, int len)
+{
+  fwrite(msg, 1, len, stdout);
+}
+
+Logger::OutputFunc g_binaryOutput = defaultOutput;
+
+MutexLock g_formatsMutex;
+std::vector<string> g_formats;  // @GuardedBy g_formatsMutex, format records by id - 1
+
+void appendRaw(string* out, const void* data, size_t len)
+{
+  out->append(static_cast<const char*>(data), len);
+}
+
+template<typename T>
+T readRaw(const char* p)
+{
+  T x;
+  memcpy(&x, p, sizeof x);
+  return x;
+}
+
+}
+
+BinaryLogger::BinaryLogger(Logger::LogLevel level, uint32_t formatId)
+  : length_(sizeof header_)
+{
+  header_.magic = kMagic;
+  header_.type = kLine;
+  header_.level = static_cast<unsigned char>(level);
+  header_.reserved = 0;
+  header_.length = 0;
+  header_.formatId = formatId;
+  header_.tid = CurrentThread::tid();
+  header_.time = Timestamp::now().microSecondsSinceEpoch();
+}
+
+BinaryLogger::~BinaryLogger()
+{
+  header_.length = static_cast<uint32_t>(length_);
+  memcpy(data_, &header_, sizeof header_);
+  g_binaryOutput(data_, static_cast<int>(length_));
+}
+
+// drops what does not fit, the decoder prints the missing conversions as is
+bool BinaryLogger::append(unsigned char type, const void* data, size_t len)
+{
+  if (length_ + 1 + len > sizeof data_)
+  {
+    return false;
+  }
+  data_[length_] = static_cast<char>(type);
+  memcpy(data_ + length_ + 1, data, len);
+  length_ += 1 + len;
+  return true;
+}
+
+BinaryLogger& BinaryLogger::appendInt(long long v)
+{
+  int64_t x = v;
+  append(kInt64, &x, sizeof x);
+  return *this;
+}
+
+BinaryLogger& BinaryLogger::appendUint(unsigned long long v)
+{
+  uint64_t x = v;
+  append(kUint64, &x, sizeof x);
+  return *this;
+}
+
+BinaryLogger& BinaryLogger::operator<<(double v)
+{
+  append(kDouble, &v, sizeof v);
+  return *this;
+}
+
+BinaryLogger& BinaryLogger::operator<<(char v)
+{
+  append(kChar, &v, sizeof v);
+  return *this;
+}
+
+BinaryLogger& BinaryLogger::operator<<(const void* p)
+{
+  uint64_t x = reinterpret_cast<uintptr_t>(p);
+  append(kPointer, &x, sizeof x);
+  return *this;
+}
+
+BinaryLogger& BinaryLogger::operator<<(const StringPiece& v)
+{
+  size_t room = sizeof data_ - length_;
+  if (room > 1 + sizeof(uint32_t))
+  {
+    uint32_t len = static_cast<uint32_t>(
+        std::min(static_cast<size_t>(v.size()), room - 1 - sizeof len));
+    data_[length_] = static_cast<char>(kString);
+    memcpy(data_ + length_ + 1, &len, sizeof len);
+    memcpy(data_ + length_ + 1 + sizeof len, v.data(), len);
+    length_ += 1 + sizeof len + len;
+  }
+  return *this;
+}
+
+uint32_t BinaryLogger::registerFormat(Logger::LogLevel level,
+                                      const char* file, int line,
+                                      const char* format)
+{
+  const char* slash = strrchr(file, '/');
+  if (slash)
+  {
+    file = slash + 1;
+  }
+  uint32_t fileLen = static_cast<uint32_t>(strlen(file));
+  uint32_t formatLen = static_cast<uint32_t>(strlen(format));
+  int32_t line32 = line;
+
+  Header header;
+  header.magic = kMagic;
+  header.type = kFormat;
+  header.level = static_cast<unsigned char>(level);
+  header.reserved = 0;
+  header.length = static_cast<uint32_t>(sizeof header + sizeof line32
+                                        + sizeof fileLen + fileLen
+                                        + sizeof formatLen + formatLen);
+  header.tid = CurrentThread::tid();
+  header.time = Timestamp::now().microSecondsSinceEpoch();
+
+  string record;
+  {
+  MutexLockGuard lock(g_formatsMutex);
+  header.formatId = static_cast<uint32_t>(g_formats.size() + 1);
+  appendRaw(&record, &header, sizeof header);
+  appendRaw(&record, &line32, sizeof line32);
+  appendRaw(&record, &fileLen, sizeof fileLen);
+  appendRaw(&record, file, fileLen);
+  appendRaw(&record, &formatLen, sizeof formatLen);
+  appendRaw(&record, format, formatLen);
+  g_formats.push_back(record);
+  }
+  // before the first line using it, stamps of a thread only go up
+  g_binaryOutput(record.data(), static_cast<int>(record.size()));
+  return header.formatId;
+}
+
+string BinaryLogger::formats()
+{
+  MutexLockGuard lock(g_formatsMutex);
+  string result;
+  for (size_t i = 0; i < g_formats.size(); ++i)
+  {
+    result += g_formats[i];
+  }
+  return result;
+}
+
+void BinaryLogger::setOutput(Logger::OutputFunc out)
+{
+  g_binaryOutput = out;
+}
+
+size_t BinaryLogDecoder::decode(const char* data, size_t len, string* out)
+{
+  size_t used = 0;
+  while (used < len)
+  {
+    const char* p = data + used;
+    size_t left = len - used;
+    if (static_cast<unsigned char>(*p) == BinaryLogger::kMagic)
+    {
+      BinaryLogger::Header header;
+      if (left < sizeof header)
+        break;
+      memcpy(&header, p, sizeof header);
+      if (header.length < sizeof header)
+      {
+        // corrupted, resync on the next line of text or record
+        out->append("<bad record>\n");
+        ++used;
+        continue;
+      }
+      if (left < header.length)
+        break;
+      const char* body = p + sizeof header;
+      size_t bodyLen = header.length - sizeof header;
+      if (header.type == BinaryLogger::kFormat)
+      {
+        addFormat(header, body, bodyLen);
+        std::map<uint32_t, std::vector<string> >::iterator it = held_.find(header.formatId);
+        if (it != held_.end() && formats_.count(header.formatId) > 0)
+        {
+          std::vector<string> records;
+          records.swap(it->second);
+          held_.erase(it);
+          for (size_t i = 0; i < records.size(); ++i)
+          {
+            decode(records[i].data(), records[i].size(), out);
+          }
+        }
+      }
+      else if (formats_.count(header.formatId) == 0)
+      {
+        held_[header.formatId].push_back(string(p, header.length));
+      }
+      else
+      {
+        formatLine(header, body, bodyLen, out);
+      }
+      used += header.length;
+    }
+    else
+    {
+      const char* eol = static_cast<const char*>(memchr(p, '\n', left));
+      if (eol == NULL)
+        break;
+      out->append(p, eol + 1);
+      used += eol + 1 - p;
+    }
+  }
+  return used;
+}
+
+void BinaryLogDecoder::finish(string* out)
+{
+  for (std::map<uint32_t, std::vector<string> >::const_iterator it = held_.begin();
+       it != held_.end();
+       ++it)
+  {
+    for (size_t i = 0; i < it->second.size(); ++i)
+    {
+      const string& record = it->second[i];
+      BinaryLogger::Header header;
+      memcpy(&header, record.data(), sizeof header);
+      formatLine(header, record.data() + sizeof header, record.size() - sizeof header, out);
+    }
+  }
+  held_.clear();
+}
+
+void BinaryLogDecoder::addFormat(const BinaryLogger::Header& header,
+                                 const char* body, size_t len)
+{
+  uint32_t fileLen = 0;
+  uint32_t formatLen = 0;
+  size_t need = sizeof(int32_t) + sizeof fileLen;
+  if (len < need)
+    return;
+  fileLen = readRaw<uint32_t>(body + sizeof(int32_t));
+  need += fileLen + sizeof formatLen;
+  if (len < need)
+    return;
+  formatLen = readRaw<uint32_t>(body + need - sizeof formatLen);
+  if (len < need + formatLen)
+    return;
+
+  Format& f = formats_[header.formatId];
+  f.level = static_cast<Logger::LogLevel>(header.level);
+  f.line = readRaw<int32_t>(body);
+  f.file.assign(body + sizeof(int32_t) + sizeof fileLen, fileLen);
+  f.format.assign(body + need, formatLen);
+}
+
+void BinaryLogDecoder::formatLine(const BinaryLogger::Header& header,
+                                  const char* body, size_t len,
+                                  string* out)
+{
+  char buf[64];
+  time_t seconds = static_cast<time_t>(header.time / 1000000);
+  struct tm tm_time;
+  ::gmtime_r(&seconds, &tm_time);
+  snprintf(buf, sizeof buf, "%4d%02d%02d %02d:%02d:%02d.%06dZ %5d ",
+           tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+           tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec,
+           static_cast<int>(header.time % 1000000), header.tid);
+  out->append(buf);
+  out->append(header.level < Logger::NUM_LOG_LEVELS
+              ? Logger::levelName(static_cast<Logger::LogLevel>(header.level))
+              : "?     ");
+
+  std::map<uint32_t, Format>::const_iterator it = formats_.find(header.formatId);
+  if (it == formats_.end())
+  {
+    snprintf(buf, sizeof buf, "<unknown format %u>\n", header.formatId);
+    out->append(buf);
+    return;
+  }
+  const Format& f = it->second;
+
+  const char* arg = body;
+  const char* end = body + len;
+  const string& format = f.format;
+  size_t i = 0;
+  while (i < format.size())
+  {
+    if (format[i] != '%')
+    {
+      out->push_back(format[i++]);
+      continue;
+    }
+    if (i + 1 < format.size() && format[i + 1] == '%')
+    {
+      out->push_back('%');
+      i += 2;
+      continue;
+    }
+
+    // %[flags][width][.precision][length]conversion, the length is dropped
+    size_t start = i++;
+    string spec("%");
+    while (i < format.size() && strchr("-+ #0", format[i]))
+      spec.push_back(format[i++]);
+    while (i < format.size() && (isdigit(static_cast<unsigned char>(format[i])) || format[i] == '.'))
+      spec.push_back(format[i++]);
+    while (i < format.size() && strchr("hlLqjzt", format[i]))
+      ++i;
+    char conv = i < format.size() ? format[i++] : 's';
+
+    if (arg >= end)
+    {
+      out->append(format, start, i - start);
+      continue;
+    }
+
+    char text[256];
+    unsigned char type = static_cast<unsigned char>(*arg++);
+    switch (type)
+    {
+      case BinaryLogger::kInt64:
+      case BinaryLogger::kUint64:
+      case BinaryLogger::kPointer:
+      {
+        if (end - arg < 8)
+        {
+          arg = end;
+          continue;
+        }
+        if (type == BinaryLogger::kPointer)
+        {
+          snprintf(text, sizeof text, "0x%llx", static_cast<unsigned long long>(readRaw<uint64_t>(arg)));
+        }
+        else if (conv == 'c')
+        {
+          snprintf(text, sizeof text, (spec + "c").c_str(), static_cast<int>(readRaw<int64_t>(arg)));
+        }
+        else if (strchr("ouxX", conv))
+        {
+          snprintf(text, sizeof text, (spec + "ll" + conv).c_str(),
+                   static_cast<unsigned long long>(readRaw<uint64_t>(arg)));
+        }
+        else if (type == BinaryLogger::kUint64)
+        {
+          snprintf(text, sizeof text, (spec + "llu").c_str(),
+                   static_cast<unsigned long long>(readRaw<uint64_t>(arg)));
+        }
+        else
+        {
+          snprintf(text, sizeof text, (spec + "lld").c_str(),
+                   static_cast<long long>(readRaw<int64_t>(arg)));
+        }
+        arg += 8;
+        out->append(text);
+        break;
+      }
+      case BinaryLogger::kDouble:
+      {
+        if (end - arg < 8)
+        {
+          arg = end;
+          continue;
+        }
+        snprintf(text, sizeof text, (spec + (strchr("eEfFgGaA", conv) ? conv : 'g')).c_str(),
+                 readRaw<double>(arg));
+        arg += 8;
+        out->append(text);
+        break;
+      }
+      case BinaryLogger::kChar:
+      {
+        if (end - arg < 1)
+        {
+          arg = end;
+          continue;
+        }
+        snprintf(text, sizeof text, (spec + "c").c_str(), *arg);
+        arg += 1;
+        out->append(text);
+        break;
+      }
+      case BinaryLogger::kString:
+      {
+        if (end - arg < 4)
+        {
+          arg = end;
+          continue;
+        }
+        uint32_t n = readRaw<uint32_t>(arg);
+        arg += 4;
+        if (static_cast<size_t>(end - arg) < n)
+        {
+          n = static_cast<uint32_t>(end - arg);
+        }
+        if (spec.size() == 1)
+        {
+          out->append(arg, n);
+        }
+        else
+        {
+          string s(arg, n);
+          snprintf(text, sizeof text, (spec + "s").c_str(), s.c_str());
+          out->append(text);
+        }
+        arg += n;
+        break;
+      }
+      default:
+        arg = end;  // unknown type, the rest cannot be read
+        break;
+    }
+  }
+  out->append(" - ");
+  out->append(f.file);
+  snprintf(buf, sizeof buf, ":%d\n", f.line);
+  out->append(buf);
+}
@@ -0,0 +1,162 @@
+#ifndef MUDUO_BASE_BINARYLOGGING_H
+#define MUDUO_BASE_BINARYLOGGING_H
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Types.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <map>
+#include <vector>
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+///
+/// Logging without formatting on the calling thread.  A record holds the id
+/// of its format string, the time, the thread id and the raw arguments,
+/// the text is made offline by muduo_logdecode or BinaryLogDecoder.
+///
+///   LOGB_INFO("accepted %s fd %d") << peer.toIpPort() << fd;
+///
+/// The format takes printf conversions, one per argument.  Length
+/// modifiers are ignored, the type comes from the argument.
+///
+/// A format is written as a format record before its first use, and
+/// formats() gives all of them for the top of a new file, see
+/// AsyncLogging::setFileHeader().  Records may share a file with text lines,
+/// they start with a byte that never starts a line of text.
+///
+class BinaryLogger : boost::noncopyable
+{
+ public:
+  static const unsigned char kMagic = 0xFE;
+  static const int kMaxRecordSize = 4000;
+
+  enum RecordType
+  {
+    kLine = 1,
+    kFormat,
+  };
+
+  enum ArgType
+  {
+    kInt64 = 1,
+    kUint64,
+    kDouble,
+    kChar,
+    kString,    // uint32_t length, then the bytes
+    kPointer,
+  };
+
+  // in front of every record, in host byte order
+  struct Header
+  {
+    unsigned char magic;
+    unsigned char type;
+    unsigned char level;
+    unsigned char reserved;
+    uint32_t length;   // of the whole record
+    uint32_t formatId;
+    int32_t tid;
+    int64_t time;      // microseconds since epoch
+  };
+
+  BinaryLogger(Logger::LogLevel level, uint32_t formatId);
+  ~BinaryLogger();
+
+  BinaryLogger& operator<<(bool v) { return appendInt(v); }
+  BinaryLogger& operator<<(short v) { return appendInt(v); }
+  BinaryLogger& operator<<(unsigned short v) { return appendUint(v); }
+  BinaryLogger& operator<<(int v) { return appendInt(v); }
+  BinaryLogger& operator<<(unsigned int v) { return appendUint(v); }
+  BinaryLogger& operator<<(long v) { return appendInt(v); }
+  BinaryLogger& operator<<(unsigned long v) { return appendUint(v); }
+  BinaryLogger& operator<<(long long v) { return appendInt(v); }
+  BinaryLogger& operator<<(unsigned long long v) { return appendUint(v); }
+  BinaryLogger& operator<<(float v) { return *this << static_cast<double>(v); }
+  BinaryLogger& operator<<(double v);
+  BinaryLogger& operator<<(char v);
+  BinaryLogger& operator<<(const void* p);
+  BinaryLogger& operator<<(const char* v) { return *this << StringPiece(v); }
+  BinaryLogger& operator<<(const string& v) { return *this << StringPiece(v); }
+#ifndef MUDUO_STD_STRING
+  BinaryLogger& operator<<(const std::string& v) { return *this << StringPiece(v); }
+#endif
+  BinaryLogger& operator<<(const StringPiece& v);
+
+  /// Thread safe.  Once per call site, by the LOGB_* macros.
+  static uint32_t registerFormat(Logger::LogLevel level,
+                                 const char* file, int line,
+                                 const char* format);
+
+  /// Thread safe.  Format records of all formats registered so far.
+  static string formats();
+
+  /// Same as Logger's, writes to stdout by default.
+  static void setOutput(Logger::OutputFunc);
+
+ private:
+  BinaryLogger& appendInt(long long v);
+  BinaryLogger& appendUint(unsigned long long v);
+  bool append(unsigned char type, const void* data, size_t len);
+
+  Header header_;
+  size_t length_;
+  char data_[kMaxRecordSize];
+};
+
+///
+/// Renders records as the text Logger would have written, and passes
+/// text lines through.  Not thread safe.
+///
+class BinaryLogDecoder : boost::noncopyable
+{
+ public:
+  /// Appends the text of the complete records and lines in data to *out,
+  /// returns the number of bytes used; the rest needs more data.
+  /// A record whose format has not come yet, as the logging thread may
+  /// write it after lines of other threads, is held back until it does.
+  size_t decode(const char* data, size_t len, string* out);
+
+  /// At the end of the input, appends the records still held back, as
+  /// "<unknown format N>".
+  void finish(string* out);
+
+ private:
+  struct Format
+  {
+    Logger::LogLevel level;
+    int line;
+    string file;
+    string format;
+  };
+
+  void addFormat(const BinaryLogger::Header& header, const char* body, size_t len);
+  void formatLine(const BinaryLogger::Header& header, const char* body, size_t len,
+                  string* out);
+
+  std::map<uint32_t, Format> formats_;
+  std::map<uint32_t, std::vector<string> > held_;  // whole records, by format id
+};
+
+}
+
+// A GNU statement expression gives each call site its own format id,
+// registered the first time it logs.
+#define MUDUO_LOGB(level, format) \
+  if (!MUDUO_LOG_ENABLED(level)) {} else \
+    muduo::BinaryLogger(level, ({ static const uint32_t muduo_logb_format_id = \
+      muduo::BinaryLogger::registerFormat(level, __FILE__, __LINE__, format); \
+      muduo_logb_format_id; }))
+
+#define LOGB_TRACE(format) MUDUO_LOGB(muduo::Logger::TRACE, format)
+#define LOGB_DEBUG(format) MUDUO_LOGB(muduo::Logger::DEBUG, format)
+#define LOGB_INFO(format) MUDUO_LOGB(muduo::Logger::INFO, format)
+#define LOGB_WARN(format) MUDUO_LOGB(muduo::Logger::WARN, format)
+#define LOGB_ERROR(format) MUDUO_LOGB(muduo::Logger::ERROR, format)
+
+#endif  // MUDUO_BASE_BINARYLOGGING_H
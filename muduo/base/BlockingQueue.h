@@ -8,6 +8,7 @@
 
 #include <muduo/base/Condition.h>
 #include <muduo/base/Mutex.h>
+#include <muduo/base/Timestamp.h>
 
 #include <boost/noncopyable.hpp>
 #include <deque>
@@ -29,11 +30,24 @@ class BlockingQueue : boost::noncopyable
 
   void put(const T& x)
   {
+    {
     MutexLockGuard lock(mutex_); // Զнб
     queue_.push_back(x);
-    notEmpty_.notify(); // TODO: move outside of lock ֪ͨȴ߳ ʵ߳ͬ
+    }
+    notEmpty_.notify(); // ֪ͨȴ߳ ʵ߳ͬ
   }
 
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+  void put(T&& x)
+  {
+    {
+    MutexLockGuard lock(mutex_);
+    queue_.push_back(std::move(x));
+    }
+    notEmpty_.notify();
+  }
+#endif
+
   T take()
   {
     MutexLockGuard lock(mutex_);
@@ -43,11 +57,76 @@ class BlockingQueue : boost::noncopyable
       notEmpty_.wait(); // Ϊ
     }
     assert(!queue_.empty());
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+    T front(std::move(queue_.front()));
+#else
     T front(queue_.front());
+#endif
     queue_.pop_front();
     return front;
   }
 
+  /// false if nothing came within seconds.
+  bool take(T* x, double seconds)
+  {
+    MutexLockGuard lock(mutex_);
+    if (!waitForNotEmpty(seconds))
+    {
+      return false;
+    }
+    *x = queue_.front();
+    queue_.pop_front();
+    return true;
+  }
+
+  /// Waits until the queue is not empty, then moves everything queued to
+  /// the back of *out; a swap when *out is empty.  One lock for the lot.
+  void takeAll(std::deque<T>* out)
+  {
+    MutexLockGuard lock(mutex_);
+    while (queue_.empty())
+    {
+      notEmpty_.wait();
+    }
+    moveAllTo(out);
+  }
+
+  /// false if nothing came within seconds.
+  bool takeAll(std::deque<T>* out, double seconds)
+  {
+    MutexLockGuard lock(mutex_);
+    if (!waitForNotEmpty(seconds))
+    {
+      return false;
+    }
+    moveAllTo(out);
+    return true;
+  }
+
+  /// Like takeAll(), but never waits.  Returns the number of items moved.
+  size_t drainTo(std::deque<T>* out)
+  {
+    MutexLockGuard lock(mutex_);
+    size_t n = queue_.size();
+    moveAllTo(out);
+    return n;
+  }
+
+  /// Moves at most maxItems, never waits.  Returns the number moved.
+  size_t tryTakeUpTo(std::deque<T>* out, size_t maxItems)
+  {
+    MutexLockGuard lock(mutex_);
+    if (queue_.size() <= maxItems)
+    {
+      size_t n = queue_.size();
+      moveAllTo(out);
+      return n;
+    }
+    out->insert(out->end(), queue_.begin(), queue_.begin() + maxItems);
+    queue_.erase(queue_.begin(), queue_.begin() + maxItems);
+    return maxItems;
+  }
+
   size_t size() const /* ж̷߳Ҫ */
   {
     MutexLockGuard lock(mutex_);
@@ -55,6 +134,36 @@ class BlockingQueue : boost::noncopyable
   }
 
  private:
+  // with mutex_ held
+  bool waitForNotEmpty(double seconds)
+  {
+    Timestamp deadline(addTime(Timestamp::now(), seconds));
+    while (queue_.empty())
+    {
+      double left = timeDifference(deadline, Timestamp::now());
+      if (left <= 0)
+      {
+        return false;
+      }
+      notEmpty_.waitForSeconds(left);
+    }
+    return true;
+  }
+
+  // with mutex_ held
+  void moveAllTo(std::deque<T>* out)
+  {
+    if (out->empty())
+    {
+      out->swap(queue_);
+    }
+    else
+    {
+      out->insert(out->end(), queue_.begin(), queue_.end());
+      queue_.clear();
+    }
+  }
+
   mutable MutexLock mutex_;    // Mutex mutable ΪЩԱҪͷ ı̬
   Condition         notEmpty_;  // 
   std::deque<T>     queue_;     // ʹ˱׼deque<T>˫˶
@@ -0,0 +1,37 @@
+#ifndef MUDUO_BASE_FUTEX_H
+#define MUDUO_BASE_FUTEX_H
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace muduo
+{
+namespace detail
+{
+
+// Sleeps while *addr == expected, or until woken.  Spurious returns
+// happen, callers recheck.
+inline void futexWait(int* addr, int expected)
+{
+  ::syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+inline void futexWake(int* addr, int n)
+{
+  ::syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __asm__ __volatile__("pause" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+}
+}
+
+#endif  // MUDUO_BASE_FUTEX_H
@@ -0,0 +1,119 @@
+#include <muduo/base/Histogram.h>
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace muduo;
+
+namespace
+{
+
+int bucketOf(int64_t us)
+{
+  if (us <= 0)
+    return 0;
+  int b = 64 - __builtin_clzll(static_cast<unsigned long long>(us));
+  return b < Histogram::kNumBuckets ? b : Histogram::kNumBuckets - 1;
+}
+
+int64_t load(const int64_t* p)
+{
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+}
+
+Histogram::Histogram()
+  : count_(0),
+    sum_(0),
+    max_(0)
+{
+  memset(buckets_, 0, sizeof buckets_);
+}
+
+void Histogram::add(int64_t microSeconds)
+{
+  __atomic_fetch_add(&buckets_[bucketOf(microSeconds)], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&count_, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&sum_, microSeconds, __ATOMIC_RELAXED);
+  int64_t old = load(&max_);
+  while (microSeconds > old
+         && !__atomic_compare_exchange_n(&max_, &old, microSeconds, true,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+  }
+}
+
+void Histogram::reset()
+{
+  for (int i = 0; i < kNumBuckets; ++i)
+  {
+    __atomic_store_n(&buckets_[i], 0, __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&count_, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&sum_, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&max_, 0, __ATOMIC_RELAXED);
+}
+
+int64_t Histogram::count() const
+{
+  return load(&count_);
+}
+
+int64_t Histogram::max() const
+{
+  return load(&max_);
+}
+
+double Histogram::mean() const
+{
+  int64_t n = count();
+  return n > 0 ? static_cast<double>(load(&sum_)) / static_cast<double>(n) : 0.0;
+}
+
+int64_t Histogram::percentile(double p) const
+{
+  int64_t total = 0;
+  int64_t counts[kNumBuckets];
+  for (int i = 0; i < kNumBuckets; ++i)
+  {
+    counts[i] = load(&buckets_[i]);
+    total += counts[i];
+  }
+  double wanted = static_cast<double>(total) * p / 100.0;
+  int64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i)
+  {
+    seen += counts[i];
+    if (counts[i] > 0 && static_cast<double>(seen) >= wanted)
+    {
+      return static_cast<int64_t>(1) << i;
+    }
+  }
+  return 0;
+}
+
+string Histogram::toString() const
+{
+  char buf[128];
+  snprintf(buf, sizeof buf, "count %lld mean %.1fus max %lldus\n",
+           static_cast<long long>(count()), mean(), static_cast<long long>(max()));
+  string result(buf);
+  snprintf(buf, sizeof buf, "p50 <%lldus p90 <%lldus p99 <%lldus p999 <%lldus\n",
+           static_cast<long long>(percentile(50)),
+           static_cast<long long>(percentile(90)),
+           static_cast<long long>(percentile(99)),
+           static_cast<long long>(percentile(99.9)));
+  result += buf;
+  for (int i = 0; i < kNumBuckets; ++i)
+  {
+    int64_t n = load(&buckets_[i]);
+    if (n > 0)
+    {
+      snprintf(buf, sizeof buf, "<%lldus\t%lld\n",
+               static_cast<long long>(1) << i, static_cast<long long>(n));
+      result += buf;
+    }
+  }
+  return result;
+}
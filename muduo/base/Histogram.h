@@ -0,0 +1,48 @@
+#ifndef MUDUO_BASE_HISTOGRAM_H
+#define MUDUO_BASE_HISTOGRAM_H
+
+#include <muduo/base/Types.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+///
+/// Latency histogram in power-of-two microsecond buckets,
+/// bucket i counts samples below 2^i us.
+///
+/// add() is lock free, cheap enough for every task or request.
+/// Thread safe, readers see a slightly inconsistent snapshot at worst.
+///
+class Histogram : boost::noncopyable
+{
+ public:
+  static const int kNumBuckets = 32;
+
+  Histogram();
+
+  void add(int64_t microSeconds);
+  void reset();
+
+  int64_t count() const;
+  int64_t max() const;
+  double mean() const;
+  /// Upper bound in us of the bucket holding the p-th percentile, p in (0, 100].
+  int64_t percentile(double p) const;
+
+  /// count, mean, max, p50/p90/p99/p999 and the non-empty buckets.
+  string toString() const;
+
+ private:
+  int64_t buckets_[kNumBuckets];
+  int64_t count_;
+  int64_t sum_;
+  int64_t max_;
+};
+
+}
+
+#endif  // MUDUO_BASE_HISTOGRAM_H
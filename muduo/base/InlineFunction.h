@@ -0,0 +1,377 @@
+#ifndef MUDUO_BASE_INLINEFUNCTION_H
+#define MUDUO_BASE_INLINEFUNCTION_H
+
+#include <boost/function.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+#include <assert.h>
+#include <stddef.h>
+#include <new>
+
+namespace muduo
+{
+
+namespace detail
+{
+
+// How an InlineFunction keeps a callable of type F.
+template<typename F, bool kInline>
+struct InlineFunctionStorage;
+
+// in place
+template<typename F>
+struct InlineFunctionStorage<F, true>
+{
+  static F* get(void* storage)
+  { return static_cast<F*>(storage); }
+
+  static void create(void* storage, const F& f)
+  { new (storage) F(f); }
+
+  static void copy(void* dst, const void* src)
+  { new (dst) F(*static_cast<const F*>(src)); }
+
+  static void destroy(void* storage)
+  { static_cast<F*>(storage)->~F(); }
+};
+
+// too big or over-aligned, on heap
+template<typename F>
+struct InlineFunctionStorage<F, false>
+{
+  static F* get(void* storage)
+  { return *static_cast<F**>(storage); }
+
+  static void create(void* storage, const F& f)
+  { *static_cast<F**>(storage) = new F(f); }
+
+  static void copy(void* dst, const void* src)
+  { *static_cast<F**>(dst) = new F(**static_cast<F* const*>(src)); }
+
+  static void destroy(void* storage)
+  { delete *static_cast<F**>(storage); }
+};
+
+template<typename Invoker, size_t kInlineSize>
+class InlineFunctionBase
+{
+ public:
+  typedef const void* InlineFunctionBase::*SafeBool;
+
+  bool empty() const { return ops_ == NULL; }
+  operator SafeBool() const { return ops_ ? &InlineFunctionBase::ops_ : NULL; }
+
+ protected:
+  struct Ops
+  {
+    Invoker invoke;
+    void (*copy)(void* dst, const void* src);
+    void (*destroy)(void* storage);
+  };
+
+  union Storage
+  {
+    char bytes[kInlineSize];
+    void* pointer;
+    void (*function)();
+    double number;
+    long long integer;
+  };
+
+  template<typename F>
+  struct Holder
+  {
+    static const bool kInline = sizeof(F) <= sizeof(Storage)
+        && boost::alignment_of<F>::value <= boost::alignment_of<Storage>::value;
+    typedef InlineFunctionStorage<F, kInline> Type;
+  };
+
+  InlineFunctionBase()
+    : ops_(NULL)
+  {
+  }
+
+  InlineFunctionBase(const InlineFunctionBase& rhs)
+    : ops_(NULL)
+  {
+    copyFrom(rhs);
+  }
+
+  ~InlineFunctionBase()
+  {
+    clear();
+  }
+
+  InlineFunctionBase& operator=(const InlineFunctionBase& rhs)
+  {
+    if (this != &rhs)
+    {
+      clear();
+      copyFrom(rhs);
+    }
+    return *this;
+  }
+
+  template<typename F>
+  void create(const F& f, const Ops* ops)
+  {
+    Holder<F>::Type::create(&storage_, f);
+    ops_ = ops;
+  }
+
+  const Ops* ops() const { return static_cast<const Ops*>(ops_); }
+  void* storage() const { return &storage_; }
+
+ private:
+  void copyFrom(const InlineFunctionBase& rhs)
+  {
+    if (rhs.ops_)
+    {
+      rhs.ops()->copy(&storage_, &rhs.storage_);
+      ops_ = rhs.ops_;
+    }
+  }
+
+  void clear()
+  {
+    if (ops_)
+    {
+      const Ops* ops = this->ops();
+      ops_ = NULL;
+      ops->destroy(&storage_);
+    }
+  }
+
+  const void* ops_;  // const Ops*, one per callable type
+  mutable Storage storage_;
+};
+
+}  // namespace detail
+
+///
+/// Type-erased callable like boost::function, which keeps callables of up
+/// to @c kInlineSize bytes, e.g. a boost::bind of a member function with a
+/// few arguments, inside the object instead of on the heap.  Copying it
+/// copies the callable in place as well.
+///
+/// Calling is one indirect call, calling an empty one is undefined.
+///
+template<typename Signature, size_t kInlineSize = 7 * sizeof(void*)>
+class InlineFunction;
+
+template<typename R, size_t kInlineSize>
+class InlineFunction<R(), kInlineSize>
+  : public detail::InlineFunctionBase<R (*)(void*), kInlineSize>
+{
+  typedef detail::InlineFunctionBase<R (*)(void*), kInlineSize> Base;
+
+ public:
+  typedef R result_type;
+
+  InlineFunction()
+  {
+  }
+
+  template<typename F>
+  InlineFunction(const F& f)
+  {
+    init(f);
+  }
+
+  InlineFunction(R (*f)())
+  {
+    if (f)
+      init(f);
+  }
+
+  // an empty boost::function stays empty
+  InlineFunction(const boost::function<R()>& f)
+  {
+    if (f)
+      init(f);
+  }
+
+  R operator()() const
+  {
+    assert(!this->empty());
+    return this->ops()->invoke(this->storage());
+  }
+
+ private:
+  template<typename F>
+  void init(const F& f)
+  {
+    typedef typename Base::template Holder<F>::Type Store;
+    static const typename Base::Ops ops = { &invoke<F>, &Store::copy, &Store::destroy };
+    this->create(f, &ops);
+  }
+
+  template<typename F>
+  static R invoke(void* storage)
+  {
+    return (*Base::template Holder<F>::Type::get(storage))();
+  }
+};
+
+template<typename R, typename A1, size_t kInlineSize>
+class InlineFunction<R(A1), kInlineSize>
+  : public detail::InlineFunctionBase<R (*)(void*, A1), kInlineSize>
+{
+  typedef detail::InlineFunctionBase<R (*)(void*, A1), kInlineSize> Base;
+
+ public:
+  typedef R result_type;
+
+  InlineFunction()
+  {
+  }
+
+  template<typename F>
+  InlineFunction(const F& f)
+  {
+    init(f);
+  }
+
+  InlineFunction(R (*f)(A1))
+  {
+    if (f)
+      init(f);
+  }
+
+  InlineFunction(const boost::function<R(A1)>& f)
+  {
+    if (f)
+      init(f);
+  }
+
+  R operator()(A1 a1) const
+  {
+    assert(!this->empty());
+    return this->ops()->invoke(this->storage(), a1);
+  }
+
+ private:
+  template<typename F>
+  void init(const F& f)
+  {
+    typedef typename Base::template Holder<F>::Type Store;
+    static const typename Base::Ops ops = { &invoke<F>, &Store::copy, &Store::destroy };
+    this->create(f, &ops);
+  }
+
+  template<typename F>
+  static R invoke(void* storage, A1 a1)
+  {
+    return (*Base::template Holder<F>::Type::get(storage))(a1);
+  }
+};
+
+template<typename R, typename A1, typename A2, size_t kInlineSize>
+class InlineFunction<R(A1, A2), kInlineSize>
+  : public detail::InlineFunctionBase<R (*)(void*, A1, A2), kInlineSize>
+{
+  typedef detail::InlineFunctionBase<R (*)(void*, A1, A2), kInlineSize> Base;
+
+ public:
+  typedef R result_type;
+
+  InlineFunction()
+  {
+  }
+
+  template<typename F>
+  InlineFunction(const F& f)
+  {
+    init(f);
+  }
+
+  InlineFunction(R (*f)(A1, A2))
+  {
+    if (f)
+      init(f);
+  }
+
+  InlineFunction(const boost::function<R(A1, A2)>& f)
+  {
+    if (f)
+      init(f);
+  }
+
+  R operator()(A1 a1, A2 a2) const
+  {
+    assert(!this->empty());
+    return this->ops()->invoke(this->storage(), a1, a2);
+  }
+
+ private:
+  template<typename F>
+  void init(const F& f)
+  {
+    typedef typename Base::template Holder<F>::Type Store;
+    static const typename Base::Ops ops = { &invoke<F>, &Store::copy, &Store::destroy };
+    this->create(f, &ops);
+  }
+
+  template<typename F>
+  static R invoke(void* storage, A1 a1, A2 a2)
+  {
+    return (*Base::template Holder<F>::Type::get(storage))(a1, a2);
+  }
+};
+
+template<typename R, typename A1, typename A2, typename A3, size_t kInlineSize>
+class InlineFunction<R(A1, A2, A3), kInlineSize>
+  : public detail::InlineFunctionBase<R (*)(void*, A1, A2, A3), kInlineSize>
+{
+  typedef detail::InlineFunctionBase<R (*)(void*, A1, A2, A3), kInlineSize> Base;
+
+ public:
+  typedef R result_type;
+
+  InlineFunction()
+  {
+  }
+
+  template<typename F>
+  InlineFunction(const F& f)
+  {
+    init(f);
+  }
+
+  InlineFunction(R (*f)(A1, A2, A3))
+  {
+    if (f)
+      init(f);
+  }
+
+  InlineFunction(const boost::function<R(A1, A2, A3)>& f)
+  {
+    if (f)
+      init(f);
+  }
+
+  R operator()(A1 a1, A2 a2, A3 a3) const
+  {
+    assert(!this->empty());
+    return this->ops()->invoke(this->storage(), a1, a2, a3);
+  }
+
+ private:
+  template<typename F>
+  void init(const F& f)
+  {
+    typedef typename Base::template Holder<F>::Type Store;
+    static const typename Base::Ops ops = { &invoke<F>, &Store::copy, &Store::destroy };
+    this->create(f, &ops);
+  }
+
+  template<typename F>
+  static R invoke(void* storage, A1 a1, A2 a2, A3 a3)
+  {
+    return (*Base::template Holder<F>::Type::get(storage))(a1, a2, a3);
+  }
+};
+
+}
+
+#endif  // MUDUO_BASE_INLINEFUNCTION_H
@@ -0,0 +1,72 @@
+// muduo_logdecode: prints log files written by BinaryLogger as text.
+// Text lines pass through, gzip'ed files are read as they are.
+//
+// usage: muduo_logdecode [file...], stdin if none
+
+#include <muduo/base/BinaryLogging.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+// formats seen in one file are kept for the next, files rolled by
+// LogFile start with them anyway; so are the records waiting for theirs
+bool decodeFile(muduo::BinaryLogDecoder* decoder, gzFile in, const char* name)
+{
+  muduo::string pending;
+  muduo::string text;
+  char buf[64*1024];
+  int n = 0;
+  while ((n = ::gzread(in, buf, sizeof buf)) > 0)
+  {
+    pending.append(buf, n);
+    text.clear();
+    size_t used = decoder->decode(pending.data(), pending.size(), &text);
+    pending.erase(0, used);
+    fwrite(text.data(), 1, text.size(), stdout);
+  }
+  if (n < 0)
+  {
+    int err = 0;
+    fprintf(stderr, "muduo_logdecode: %s: %s\n", name, ::gzerror(in, &err));
+    return false;
+  }
+  if (!pending.empty())
+  {
+    fprintf(stderr, "muduo_logdecode: %s: %zu bytes of a truncated record\n",
+            name, pending.size());
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  muduo::BinaryLogDecoder decoder;
+  bool ok = true;
+  if (argc < 2)
+  {
+    gzFile in = ::gzdopen(STDIN_FILENO, "rb");
+    ok = in != NULL && decodeFile(&decoder, in, "stdin");
+    if (in)
+    {
+      ::gzclose(in);
+    }
+  }
+  for (int i = 1; i < argc; ++i)
+  {
+    gzFile in = ::gzopen(argv[i], "rb");
+    if (in == NULL)
+    {
+      fprintf(stderr, "muduo_logdecode: cannot open %s\n", argv[i]);
+      ok = false;
+      continue;
+    }
+    ok = decodeFile(&decoder, in, argv[i]) && ok;
+    ::gzclose(in);
+  }
+  muduo::string text;
+  decoder.finish(&text);
+  fwrite(text.data(), 1, text.size(), stdout);
+  return ok ? 0 : 1;
+}
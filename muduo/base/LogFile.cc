@@ -1,10 +1,27 @@
 #include <muduo/base/LogFile.h>
 #include <muduo/base/Logging.h> // strerror_tl
+#include <muduo/base/BlockingQueue.h>
 #include <muduo/base/ProcessInfo.h>
+#include <muduo/base/Thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <vector>
 
 #include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
+#include <zlib.h>
 
 using namespace muduo;
 
@@ -14,7 +31,8 @@ class LogFile::File : boost::noncopyable       		// 
  public:
   explicit File(const string& filename)        		// ļ ļ
     : fp_(::fopen(filename.data(), "ae")),
-      writtenBytes_(0)
+      writtenBytes_(0),
+      preallocated_(false)
   {
     assert(fp_);
     ::setbuffer(fp_, buffer_, sizeof buffer_); 		// ļ Ҫдļ
@@ -23,6 +41,10 @@ class LogFile::File : boost::noncopyable       		// 
 
   ~File()
   {
+    if (preallocated_)
+    {
+      trim();
+    }
     ::fclose(fp_);                             		// رļ
   }
 
@@ -54,10 +76,33 @@ class LogFile::File : boost::noncopyable       		// 
     ::fflush(fp_);
   }
 
+  // reserves blocks without changing the size, so that appends do not
+  // allocate them one by one; not every file system supports it
+  void preallocate(size_t bytes)
+  {
+    preallocated_ =
+        ::fallocate(::fileno(fp_), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes)) == 0;
+  }
+
   size_t writtenBytes() const { return writtenBytes_; }
 
  private:
 
+  // gives back the blocks reserved past the end, a truncate to the same
+  // size frees them on ext4 and xfs
+  void trim()
+  {
+    ::fflush(fp_);
+    struct stat st;
+    if (::fstat(::fileno(fp_), &st) == 0)
+    {
+      if (::ftruncate(::fileno(fp_), st.st_size) < 0)
+      {
+        fprintf(stderr, "LogFile::File::trim() failed %s\n", strerror_tl(errno));
+      }
+    }
+  }
+
   size_t write(const char* logline, size_t len)     // д־ݵļ
   {
 #undef fwrite_unlocked
@@ -67,6 +112,225 @@ class LogFile::File : boost::noncopyable       		// 
   FILE* fp_;
   char buffer_[64*1024]; // 64K Զflushļ
   size_t writtenBytes_;
+  bool preallocated_;
+};
+
+// Opens, closes, compresses and removes files in its own thread, so the
+// writer never waits for the file system when rolling.
+class LogFile::Roller : boost::noncopyable
+{
+ public:
+  Roller(const string& basename, size_t rollSize,
+         bool compress, int maxFiles, int64_t maxBytes)
+    : basename_(basename),
+      rollSize_(rollSize),
+      compress_(compress),
+      maxFiles_(maxFiles),
+      maxBytes_(maxBytes),
+      nextName_("." + basename + ".next." + ProcessInfo::pidString() + ".log"),
+      thread_(boost::bind(&Roller::threadFunc, this), "LogRoller")
+  {
+    thread_.start();
+    queue_.put(boost::bind(&Roller::prepareNext, this));
+  }
+
+  ~Roller()
+  {
+    queue_.put(Task());
+    thread_.join();
+    if (next_)
+    {
+      next_.reset();
+      ::unlink(nextName_.c_str());
+    }
+  }
+
+  // by the writer, puts the file opened ahead for filename in *file,
+  // and closes the rolled one, oldName, in the background
+  void roll(boost::scoped_ptr<File>* file, const string& oldName, const string& filename)
+  {
+    boost::shared_ptr<Rolled> rolled(new Rolled);
+    rolled->filename = oldName;
+    {
+    MutexLockGuard lock(mutex_);
+    rolled->file.swap(next_);
+    }
+    bool ready = rolled->file != NULL;
+    if (!ready)
+    {
+      rolled->file.reset(new File(filename));  // the roller thread is behind
+    }
+    file->swap(rolled->file);
+    if (ready)
+    {
+      queue_.put(boost::bind(&Roller::rename, this, filename));
+    }
+    queue_.put(boost::bind(&Roller::finish, this, rolled, filename));
+  }
+
+ private:
+  typedef boost::function<void ()> Task;
+
+  struct Rolled
+  {
+    boost::scoped_ptr<File> file;
+    string filename;
+  };
+
+  void threadFunc()
+  {
+    Task task;
+    while ((task = queue_.take()))
+    {
+      task();
+    }
+  }
+
+  void prepareNext()
+  {
+    boost::scoped_ptr<File> file(new File(nextName_));
+    file->preallocate(rollSize_);
+    MutexLockGuard lock(mutex_);
+    next_.swap(file);
+  }
+
+  void rename(const string& filename)
+  {
+    if (::rename(nextName_.c_str(), filename.c_str()) < 0)
+    {
+      fprintf(stderr, "LogFile::Roller rename %s failed %s\n",
+              filename.c_str(), strerror_tl(errno));
+    }
+    prepareNext();
+  }
+
+  void finish(const boost::shared_ptr<Rolled>& rolled, const string& current)
+  {
+    rolled->file.reset();  // flushes and closes
+    if (compress_)
+    {
+      gzip(rolled->filename);
+    }
+    if (maxFiles_ > 0 || maxBytes_ > 0)
+    {
+      removeOld(current);
+    }
+  }
+
+  void gzip(const string& filename)
+  {
+    string gzName = filename + ".gz";
+    string tmpName = gzName + ".tmp";
+    FILE* in = ::fopen(filename.c_str(), "re");
+    gzFile out = in ? ::gzopen(tmpName.c_str(), "wb") : NULL;
+    bool ok = out != NULL;
+    char buf[64*1024];
+    size_t n = 0;
+    while (ok && (n = ::fread(buf, 1, sizeof buf, in)) > 0)
+    {
+      ok = ::gzwrite(out, buf, static_cast<unsigned>(n)) == static_cast<int>(n);
+    }
+    ok = ok && !::ferror(in);
+    if (out && ::gzclose(out) != Z_OK)
+    {
+      ok = false;
+    }
+    if (in)
+    {
+      ::fclose(in);
+    }
+    if (ok && ::rename(tmpName.c_str(), gzName.c_str()) == 0)
+    {
+      ::unlink(filename.c_str());
+    }
+    else
+    {
+      fprintf(stderr, "LogFile::Roller gzip %s failed\n", filename.c_str());
+      ::unlink(tmpName.c_str());
+    }
+  }
+
+  // rolled files of basename, oldest first, but those of other running
+  // processes, which may still be writing them;
+  // the time after basename makes names sort by age
+  void removeOld(const string& current)
+  {
+    std::vector<string> names;
+    string prefix = basename_ + ".";
+    DIR* dir = ::opendir(".");
+    if (dir == NULL)
+    {
+      return;
+    }
+    while (struct dirent* ent = ::readdir(dir))
+    {
+      string name(ent->d_name);
+      if (name.compare(0, prefix.size(), prefix) == 0 && name != current
+          && (endsWith(name, ".log") || endsWith(name, ".log.gz"))
+          && !ofOtherProcess(name))
+      {
+        names.push_back(name);
+      }
+    }
+    ::closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    int64_t totalBytes = 0;
+    std::vector<int64_t> sizes(names.size());
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+      struct stat st;
+      sizes[i] = ::stat(names[i].c_str(), &st) == 0 ? st.st_size : 0;
+      totalBytes += sizes[i];
+    }
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+      size_t left = names.size() - i;
+      bool tooMany = maxFiles_ > 0 && left > static_cast<size_t>(maxFiles_);
+      bool tooLarge = maxBytes_ > 0 && totalBytes > maxBytes_;
+      if (!tooMany && !tooLarge)
+      {
+        break;
+      }
+      ::unlink(names[i].c_str());
+      totalBytes -= sizes[i];
+    }
+  }
+
+  // basename.time.host.pid.log[.gz], pid running and not ours
+  static bool ofOtherProcess(const string& name)
+  {
+    size_t end = name.rfind(".log");
+    if (end == string::npos || end == 0)
+    {
+      return false;
+    }
+    size_t dot = name.rfind('.', end - 1);
+    if (dot == string::npos)
+    {
+      return false;
+    }
+    pid_t pid = static_cast<pid_t>(::atoi(name.c_str() + dot + 1));
+    return pid > 0 && pid != ProcessInfo::pid()
+        && (::kill(pid, 0) == 0 || errno == EPERM);
+  }
+
+  static bool endsWith(const string& s, const char* suffix)
+  {
+    size_t n = ::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+  }
+
+  const string basename_;
+  const size_t rollSize_;
+  const bool compress_;
+  const int maxFiles_;
+  const int64_t maxBytes_;
+  const string nextName_;
+  MutexLock mutex_;
+  boost::scoped_ptr<File> next_;  // @GuardedBy mutex_
+  BlockingQueue<Task> queue_;
+  Thread thread_;
 };
 
 LogFile::LogFile(const string& basename,
@@ -90,6 +354,19 @@ LogFile::~LogFile()
 {
 }
 
+void LogFile::setHeader(const boost::function<string ()>& header)
+{
+  header_ = header;
+  string h = header_();
+  file_->append(h.data(), h.size());
+}
+
+void LogFile::startBackgroundRoll(bool compress, int maxFiles, int64_t maxBytes)
+{
+  assert(!roller_);
+  roller_.reset(new Roller(basename_, rollSize_, compress, maxFiles, maxBytes));
+}
+
 void LogFile::append(const char* logline, int len)
 {
   if (mutex_)
@@ -161,7 +438,20 @@ void LogFile::rollFile() // д
     lastRoll_ = now;
     lastFlush_ = now;
     startOfPeriod_ = start;
-    file_.reset(new File(filename));
+    if (roller_)
+    {
+      roller_->roll(&file_, fileName_, filename);
+    }
+    else
+    {
+      file_.reset(new File(filename));
+    }
+    fileName_ = filename;
+    if (header_)
+    {
+      string h = header_();
+      file_->append(h.data(), h.size());
+    }
   }
 }
 
@@ -4,6 +4,7 @@
 #include <muduo/base/Mutex.h>
 #include <muduo/base/Types.h>
 
+#include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 
@@ -20,6 +21,19 @@ class LogFile : boost::noncopyable
   ~LogFile();
 
   void append(const char* logline, int len); // ־
+  /// Moves rolling to a background thread, which opens and fallocate()s
+  /// the next file ahead of time and closes the rolled one.  Rolled files
+  /// are gzip'ed if compress, then the oldest rolled files of basename are
+  /// removed beyond maxFiles or maxBytes, 0 for no limit, but not those
+  /// of other running processes.
+  /// Not thread safe, call before the first append().
+  void startBackgroundRoll(bool compress, int maxFiles = 0, int64_t maxBytes = 0);
+
+  /// Written at the top of every file, and now to the current one,
+  /// such as BinaryLogger::formats().
+  /// Not thread safe, call before the first append().
+  void setHeader(const boost::function<string ()>& header);
+
   void flush(); // дļ
 
  private:
@@ -40,8 +54,13 @@ class LogFile : boost::noncopyable
   time_t lastRoll_;      						// һι־ļʱ
   time_t lastFlush_;	 						// һд־ļʱ
   class File;
+  class Roller;
+  string fileName_;
+  boost::function<string ()> header_;
   boost::scoped_ptr<File> file_; // File
 
+  boost::scoped_ptr<Roller> roller_;  // after file_, it closes files in flight first
+
   const static int kCheckTimeRoll_ = 1024;      // count_Сﵽֵ͹
   const static int kRollPerSeconds_ = 60*60*24; // ÿһ µһ ÿ
 };
@@ -4,7 +4,10 @@
 #include <limits>
 #include <boost/static_assert.hpp>
 #include <boost/type_traits/is_arithmetic.hpp>
+#include <boost/type_traits/make_unsigned.hpp>
 #include <assert.h>
+#include <float.h>
+#include <math.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -18,35 +21,58 @@ namespace muduo
 {
 namespace detail 
 {
-const char digits[] = "9876543210123456789";
-const char* zero = digits + 9;
-BOOST_STATIC_ASSERT(sizeof(digits) == 20);
+const char digitPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+BOOST_STATIC_ASSERT(sizeof digitPairs == 201);
 
 const char digitsHex[] = "0123456789ABCDEF";
 BOOST_STATIC_ASSERT(sizeof digitsHex == 17);
 
-// Efficient Integer to String Conversions, by Matthew Wilson.
+// Two digits per division, after Andrei Alexandrescu's
+// "Three Optimization Tips for C++".
 template<typename T>
 size_t convert(char buf[], T value) // T(ʮ)תstring
 {
-  T i = value;
-  char* p = buf;
+  typedef typename boost::make_unsigned<T>::type U;
+  U i = value < 0 ? static_cast<U>(U(0) - static_cast<U>(value)) : static_cast<U>(value);
+  char tmp[24];
+  char* const end = tmp + sizeof tmp;
+  char* p = end;
 
-  do
+  while (i >= 100)
   {
-    int lsd = static_cast<int>(i % 10);
-    i /= 10;
-    *p++ = zero[lsd];
-  } while (i != 0);
+    size_t r = static_cast<size_t>(i % 100);
+    i /= 100;
+    p -= 2;
+    memcpy(p, digitPairs + 2 * r, 2);
+  }
+  if (i >= 10)
+  {
+    p -= 2;
+    memcpy(p, digitPairs + 2 * static_cast<size_t>(i), 2);
+  }
+  else
+  {
+    *--p = static_cast<char>('0' + i);
+  }
 
   if (value < 0)
   {
-    *p++ = '-';
+    *--p = '-';
   }
-  *p = '\0';
-  std::reverse(buf, p);
-
-  return p - buf;
+  size_t len = end - p;
+  memcpy(buf, p, len);
+  buf[len] = '\0';
+  return len;
 }
 // T(ʮ)תstring
 size_t convertHex(char buf[], uintptr_t value)
@@ -70,6 +96,442 @@ size_t convertHex(char buf[], uintptr_t value)
 }
 }
 
+namespace
+{
+
+// Grisu2, after "Printing Floating-Point Numbers Quickly and Accurately with
+// Integers" by Florian Loitsch, and Milo Yip's dtoa.
+
+struct DiyFp
+{
+  DiyFp() : f(0), e(0) {}
+  DiyFp(uint64_t fp, int exp) : f(fp), e(exp) {}
+
+  explicit DiyFp(double d)
+  {
+    uint64_t u;
+    memcpy(&u, &d, sizeof u);
+    int biasedE = static_cast<int>((u & kExponentMask) >> kSignificandSize);
+    uint64_t significand = u & kSignificandMask;
+    if (biasedE != 0)
+    {
+      f = significand + kHiddenBit;
+      e = biasedE - kExponentBias;
+    }
+    else
+    {
+      f = significand;
+      e = 1 - kExponentBias;
+    }
+  }
+
+  DiyFp operator-(const DiyFp& rhs) const
+  {
+    return DiyFp(f - rhs.f, e);
+  }
+
+  DiyFp operator*(const DiyFp& rhs) const
+  {
+    unsigned __int128 p = static_cast<unsigned __int128>(f) * rhs.f;
+    uint64_t h = static_cast<uint64_t>(p >> 64);
+    uint64_t l = static_cast<uint64_t>(p);
+    if (l & (static_cast<uint64_t>(1) << 63))  // rounding
+      h++;
+    return DiyFp(h, e + rhs.e + 64);
+  }
+
+  DiyFp normalize() const
+  {
+    int s = __builtin_clzll(f);
+    return DiyFp(f << s, e - s);
+  }
+
+  DiyFp normalizeBoundary() const
+  {
+    DiyFp res = *this;
+    while (!(res.f & (kHiddenBit << 1)))
+    {
+      res.f <<= 1;
+      res.e--;
+    }
+    res.f <<= (kDiySignificandSize - kSignificandSize - 2);
+    res.e = res.e - (kDiySignificandSize - kSignificandSize - 2);
+    return res;
+  }
+
+  void normalizedBoundaries(DiyFp* minus, DiyFp* plus) const
+  {
+    DiyFp pl = DiyFp((f << 1) + 1, e - 1).normalizeBoundary();
+    DiyFp mi = (f == kHiddenBit) ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *plus = pl;
+    *minus = mi;
+  }
+
+  static const int kDiySignificandSize = 64;
+  static const int kSignificandSize = 52;
+  static const int kExponentBias = 0x3FF + kSignificandSize;
+  static const uint64_t kExponentMask = 0x7FF0000000000000ULL;
+  static const uint64_t kSignificandMask = 0x000FFFFFFFFFFFFFULL;
+  static const uint64_t kHiddenBit = 0x0010000000000000ULL;
+
+  uint64_t f;
+  int e;
+};
+
+// 10^k for k = -348, -340, ..., 340, normalized
+const uint64_t kCachedPowersF[] =
+{
+  0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+  0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+  0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+  0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+  0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+  0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+  0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+  0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+  0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+  0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+  0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+  0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+  0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+  0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+  0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+  0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+  0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+  0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+  0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+  0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+  0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+  0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+const int16_t kCachedPowersE[] =
+{
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+  -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+  -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+  -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+  -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+  109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+  375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+  641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+  907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+DiyFp getCachedPower(int e, int* K)
+{
+  double dk = (-61 - e) * 0.30102999566398114 + 347;  // dk must be positive
+  int k = static_cast<int>(dk);
+  if (dk - k > 0.0)
+    k++;
+  int index = (k >> 3) + 1;
+  *K = -(-348 + index * 8);  // decimal exponent, no need for a table
+  return DiyFp(kCachedPowersF[index], kCachedPowersE[index]);
+}
+
+const uint64_t kPow10[] =
+{
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+  100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL,
+  1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+  1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+  1000000000000000000ULL, 10000000000000000000ULL
+};
+
+int countDecimalDigit32(uint32_t n)
+{
+  int d = 1;
+  while (d < 10 && n >= kPow10[d])
+    ++d;
+  return d;
+}
+
+void grisuRound(char* buffer, int len, uint64_t delta, uint64_t rest,
+                uint64_t tenKappa, uint64_t wpw)
+{
+  while (rest < wpw && delta - rest >= tenKappa &&
+         (rest + tenKappa < wpw ||  // closer
+          wpw - rest > rest + tenKappa - wpw))
+  {
+    buffer[len - 1]--;
+    rest += tenKappa;
+  }
+}
+
+void digitGen(const DiyFp& W, const DiyFp& Mp, uint64_t delta,
+              char* buffer, int* len, int* K)
+{
+  const DiyFp one(static_cast<uint64_t>(1) << -Mp.e, Mp.e);
+  const DiyFp wpw = Mp - W;
+  uint32_t p1 = static_cast<uint32_t>(Mp.f >> -one.e);
+  uint64_t p2 = Mp.f & (one.f - 1);
+  int kappa = countDecimalDigit32(p1);
+  *len = 0;
+
+  while (kappa > 0)
+  {
+    uint32_t d = p1 / static_cast<uint32_t>(kPow10[kappa - 1]);
+    p1 %= static_cast<uint32_t>(kPow10[kappa - 1]);
+    if (d || *len)
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    kappa--;
+    uint64_t tmp = (static_cast<uint64_t>(p1) << -one.e) + p2;
+    if (tmp <= delta)
+    {
+      *K += kappa;
+      grisuRound(buffer, *len, delta, tmp, kPow10[kappa] << -one.e, wpw.f);
+      return;
+    }
+  }
+
+  for (;;)
+  {
+    p2 *= 10;
+    delta *= 10;
+    char d = static_cast<char>(p2 >> -one.e);
+    if (d || *len)
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta)
+    {
+      *K += kappa;
+      int index = -kappa;
+      grisuRound(buffer, *len, delta, p2, one.f, wpw.f * (index < 20 ? kPow10[index] : 0));
+      return;
+    }
+  }
+}
+
+// v > 0, at most 17 digits in buffer, v = digits * 10^K
+void grisu2(double v, char* buffer, int* len, int* K)
+{
+  const DiyFp dv(v);
+  DiyFp wm, wp;
+  dv.normalizedBoundaries(&wm, &wp);
+  const DiyFp cmk = getCachedPower(wp.e, K);
+  const DiyFp W = dv.normalize() * cmk;
+  DiyFp Wp = wp * cmk;
+  DiyFp Wm = wm * cmk;
+  Wm.f++;
+  Wp.f--;
+  digitGen(W, Wp, Wp.f - Wm.f, buffer, len, K);
+}
+
+#if LDBL_MANT_DIG >= 64
+// all exact in a 64-bit mantissa
+const long double kPow10L[] =
+{
+  1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L,
+  1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L
+};
+
+// floor(x) rounded up if its fraction is over a half, false if the fraction
+// is too close to a half to trust, the product that made x was rounded
+bool roundScaled(long double x, uint64_t* n)
+{
+  long double fl = floorl(x);
+  long double frac = x - fl;
+  if (fabsl(frac - 0.5L) < 1e-6L)
+    return false;
+  *n = static_cast<uint64_t>(fl) + (frac > 0.5L ? 1 : 0);
+  return true;
+}
+#endif
+
+// "%.12g" where it prints fixed notation and long double rounds right,
+// 0 if snprintf must do it
+size_t formatGeneral(char* buf, double v)
+{
+#if LDBL_MANT_DIG >= 64
+  if (v == 0)
+  {
+    if (signbit(v))
+    {
+      memcpy(buf, "-0", 2);
+      return 2;
+    }
+    buf[0] = '0';
+    return 1;
+  }
+  if (v - v != 0)  // inf or nan
+    return 0;
+
+  bool negative = v < 0;
+  long double x = negative ? -v : v;
+  int e2 = 0;
+  frexp(v, &e2);
+  int exp10 = ((e2 - 1) * 1233) >> 12;  // floor(log10(x)), may be one off
+  if (exp10 < -5 || exp10 > 11)
+    return 0;
+  long double scaled = x * kPow10L[11 - exp10];
+  if (scaled >= 1e12L)
+  {
+    if (++exp10 > 11)
+      return 0;
+    scaled = x * kPow10L[11 - exp10];
+  }
+  else if (scaled < 1e11L)
+  {
+    if (--exp10 < -4)
+      return 0;
+    scaled = x * kPow10L[11 - exp10];
+  }
+  if (exp10 < -4)
+    return 0;
+
+  uint64_t n = 0;
+  if (!roundScaled(scaled, &n))
+    return 0;
+  if (n == 1000000000000ULL)
+  {
+    n = 100000000000ULL;
+    if (++exp10 > 11)
+      return 0;
+  }
+
+  char digits[24];
+  detail::convert(digits, n);
+  int nd = 12;
+  while (nd > 1 && digits[nd - 1] == '0')
+    --nd;
+
+  char* p = buf;
+  if (negative)
+    *p++ = '-';
+  if (exp10 >= 0)
+  {
+    memcpy(p, digits, exp10 + 1);
+    p += exp10 + 1;
+    if (nd > exp10 + 1)
+    {
+      *p++ = '.';
+      memcpy(p, digits + exp10 + 1, nd - exp10 - 1);
+      p += nd - exp10 - 1;
+    }
+  }
+  else
+  {
+    *p++ = '0';
+    *p++ = '.';
+    for (int i = 0; i < -exp10 - 1; ++i)
+      *p++ = '0';
+    memcpy(p, digits, nd);
+    p += nd;
+  }
+  return p - buf;
+#else
+  return 0;
+#endif
+}
+
+// "%.*f" for precision in [0, 9] and |v| * 10^precision below 1e13,
+// 0 if snprintf must do it
+size_t formatFixed(char* buf, double v, int precision)
+{
+#if LDBL_MANT_DIG >= 64
+  if (precision < 0 || precision > 9 || v - v != 0)
+    return 0;
+  bool negative = signbit(v);
+  long double scaled = (negative ? -v : v) * kPow10L[precision];
+  uint64_t n = 0;
+  if (!(scaled < 1e13L) || !roundScaled(scaled, &n))
+    return 0;
+
+  char* p = buf;
+  if (negative)
+    *p++ = '-';
+  uint64_t unit = static_cast<uint64_t>(kPow10L[precision]);
+  p += detail::convert(p, n / unit);
+  if (precision > 0)
+  {
+    char digits[24];
+    size_t len = detail::convert(digits, n % unit);
+    *p++ = '.';
+    size_t zeros = static_cast<size_t>(precision) - len;
+    memset(p, '0', zeros);
+    memcpy(p + zeros, digits, len);
+    p += precision;
+  }
+  return p - buf;
+#else
+  return 0;
+#endif
+}
+
+// %g style, with as many digits as it takes to read back the same value
+size_t formatRoundTrip(char* buf, double v)
+{
+  if (v - v != 0)  // inf or nan
+    return static_cast<size_t>(snprintf(buf, 32, "%g", v));
+
+  char* p = buf;
+  if (signbit(v))
+  {
+    *p++ = '-';
+    v = -v;
+  }
+  if (v == 0)
+  {
+    *p++ = '0';
+    return p - buf;
+  }
+
+  char digits[24];
+  int len = 0;
+  int K = 0;
+  grisu2(v, digits, &len, &K);
+  int exp10 = len + K - 1;
+  if (exp10 < -4 || exp10 >= 17)
+  {
+    *p++ = digits[0];
+    if (len > 1)
+    {
+      *p++ = '.';
+      memcpy(p, digits + 1, len - 1);
+      p += len - 1;
+    }
+    *p++ = 'e';
+    *p++ = exp10 < 0 ? '-' : '+';
+    int e = exp10 < 0 ? -exp10 : exp10;
+    if (e >= 100)
+      *p++ = static_cast<char>('0' + e / 100);
+    *p++ = static_cast<char>('0' + e / 10 % 10);
+    *p++ = static_cast<char>('0' + e % 10);
+  }
+  else if (exp10 >= 0)
+  {
+    if (len <= exp10 + 1)
+    {
+      memcpy(p, digits, len);
+      memset(p + len, '0', exp10 + 1 - len);
+      p += exp10 + 1;
+    }
+    else
+    {
+      memcpy(p, digits, exp10 + 1);
+      p += exp10 + 1;
+      *p++ = '.';
+      memcpy(p, digits + exp10 + 1, len - exp10 - 1);
+      p += len - exp10 - 1;
+    }
+  }
+  else
+  {
+    *p++ = '0';
+    *p++ = '.';
+    memset(p, '0', -exp10 - 1);
+    p += -exp10 - 1;
+    memcpy(p, digits, len);
+    p += len;
+  }
+  return p - buf;
+}
+
+}
+
 template<int SIZE>
 const char* FixedBuffer<SIZE>::debugString()
 {
@@ -173,12 +635,15 @@ LogStream& LogStream::operator<<(const void* p) // д
   return *this;
 }
 
-// FIXME: replace this with Grisu3 by Florian Loitsch.
 LogStream& LogStream::operator<<(double v)
 {
   if (buffer_.avail() >= kMaxNumericSize)
   {
-    int len = snprintf(buffer_.current(), kMaxNumericSize, "%.12g", v);
+    size_t len = formatGeneral(buffer_.current(), v);
+    if (len == 0)
+    {
+      len = static_cast<size_t>(snprintf(buffer_.current(), kMaxNumericSize, "%.12g", v));
+    }
     buffer_.add(len);
   }
   return *this;
@@ -208,3 +673,20 @@ template Fmt::Fmt(const char* fmt, unsigned long long);
 
 template Fmt::Fmt(const char* fmt, float);
 template Fmt::Fmt(const char* fmt, double);
+
+RoundTrip::RoundTrip(double v)
+{
+  length_ = static_cast<int>(formatRoundTrip(buf_, v));
+  assert(static_cast<size_t>(length_) < sizeof buf_);
+}
+
+Fixed::Fixed(double v, int precision)
+{
+  size_t len = formatFixed(buf_, v, precision);
+  if (len == 0)
+  {
+    len = static_cast<size_t>(snprintf(buf_, sizeof buf_, "%.*f", precision, v));
+    len = std::min(len, sizeof buf_ - 1);
+  }
+  length_ = static_cast<int>(len);
+}
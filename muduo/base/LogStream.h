@@ -179,6 +179,50 @@ inline LogStream& operator<<(LogStream& s, const Fmt& fmt)
   return s;
 }
 
+/// Text that reads back as the same double (round-trip, not guaranteed
+/// shortest), in the style of %g, by Grisu2 (F. Loitsch, 2010).  It may
+/// have a digit more than the shortest in rare cases.
+/// operator<<(double) prints %.12g.
+class RoundTrip
+{
+ public:
+  explicit RoundTrip(double v);
+
+  const char* data() const { return buf_; }
+  int length() const { return length_; }
+
+ private:
+  char buf_[32];
+  int length_;
+};
+
+inline LogStream& operator<<(LogStream& s, const RoundTrip& v)
+{
+  s.append(v.data(), v.length());
+  return s;
+}
+
+/// Same as snprintf "%.*f", without snprintf for precision up to 9 when
+/// v * 10^precision is below 1e13.  At most 47 characters, longer ones are cut.
+class Fixed
+{
+ public:
+  Fixed(double v, int precision);
+
+  const char* data() const { return buf_; }
+  int length() const { return length_; }
+
+ private:
+  char buf_[48];
+  int length_;
+};
+
+inline LogStream& operator<<(LogStream& s, const Fixed& v)
+{
+  s.append(v.data(), v.length());
+  return s;
+}
+
 }// end namespace muduo
 #endif  // MUDUO_BASE_LOGSTREAM_H
 
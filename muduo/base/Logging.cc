@@ -1,6 +1,7 @@
 #include <muduo/base/Logging.h>
 
 #include <muduo/base/CurrentThread.h>
+#include <muduo/base/Mutex.h>
 #include <muduo/base/StringPiece.h>
 #include <muduo/base/Timestamp.h>
 
@@ -8,6 +9,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <map>
 #include <sstream>
 
 namespace muduo
@@ -89,6 +91,60 @@ void defaultFlush()
 Logger::OutputFunc g_output = defaultOutput; // Ĭϵ Ĭϵˢ»
 Logger::FlushFunc g_flush = defaultFlush;
 
+MutexLock g_sitesMutex;
+Logger::Site* g_sites = NULL;  // @GuardedBy g_sitesMutex
+std::map<string, Logger::LogLevel> g_moduleLevels;  // @GuardedBy g_sitesMutex
+
+Logger::LogLevel levelOfFile(const char* file)
+{
+  if (g_moduleLevels.empty())
+    return g_logLevel;
+
+  // the file name, then its directories from the deepest up
+  const char* end = file + strlen(file);
+  const char* slash = strrchr(file, '/');
+  const char* begin = slash ? slash + 1 : file;
+  while (true)
+  {
+    std::map<string, Logger::LogLevel>::const_iterator it =
+        g_moduleLevels.find(string(begin, end));
+    if (it != g_moduleLevels.end())
+      return it->second;
+    if (begin == file)
+      break;
+    end = begin - 1;
+    begin = end;
+    while (begin > file && begin[-1] != '/')
+      --begin;
+  }
+  return g_logLevel;
+}
+
+void setSiteState(Logger::Site* site)
+{
+  int state = site->level >= levelOfFile(site->file) ? 1 : 0;
+  __atomic_store_n(&site->state, state, __ATOMIC_RELAXED);
+}
+
+void updateSites()
+{
+  g_sitesMutex.assertLocked();
+  for (Logger::Site* site = g_sites; site != NULL; site = site->next)
+  {
+    setSiteState(site);
+  }
+}
+
+bool refreshEarlySites()
+{
+  MutexLockGuard lock(g_sitesMutex);
+  updateSites();
+  return true;
+}
+
+// sites resolved by static initializers of other files, before g_logLevel
+bool g_earlySitesRefreshed = refreshEarlySites();
+
 }
 // ----------------------- ʵ ----------------------
 using namespace muduo;
@@ -174,7 +230,57 @@ Logger::~Logger()
 
 void Logger::setLogLevel(Logger::LogLevel level)
 {
+  MutexLockGuard lock(g_sitesMutex);
   g_logLevel = level;
+  updateSites();
+}
+
+bool Logger::resolve(Site* site)
+{
+  MutexLockGuard lock(g_sitesMutex);
+  if (site->state < 0)
+  {
+    site->next = g_sites;
+    g_sites = site;
+    setSiteState(site);
+  }
+  return site->state > 0;
+}
+
+void Logger::setModuleLogLevel(const string& module, LogLevel level)
+{
+  MutexLockGuard lock(g_sitesMutex);
+  g_moduleLevels[module] = level;
+  updateSites();
+}
+
+void Logger::resetModuleLogLevel(const string& module)
+{
+  MutexLockGuard lock(g_sitesMutex);
+  g_moduleLevels.erase(module);
+  updateSites();
+}
+
+const char* Logger::levelName(LogLevel level)
+{
+  return LogLevelName[level];
+}
+
+string Logger::moduleLogLevels()
+{
+  MutexLockGuard lock(g_sitesMutex);
+  string result;
+  for (std::map<string, LogLevel>::const_iterator it = g_moduleLevels.begin();
+       it != g_moduleLevels.end();
+       ++it)
+  {
+    const char* name = LogLevelName[it->second];
+    result += it->first;
+    result += ' ';
+    result.append(name, strcspn(name, " "));
+    result += '\n';
+  }
+  return result;
 }
 
 void Logger::setOutput(OutputFunc out) // ֻҪ Ϊļм
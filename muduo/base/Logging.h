@@ -4,6 +4,12 @@
 #include <muduo/base/LogStream.h>
 #include <muduo/base/Timestamp.h>
 
+// Call sites below this level are compiled out, e.g. -DMUDUO_LOG_MIN_LEVEL=2
+// keeps INFO and above.  LOG_FATAL and LOG_SYSFATAL are always kept.
+#ifndef MUDUO_LOG_MIN_LEVEL
+#define MUDUO_LOG_MIN_LEVEL 0
+#endif
+
 namespace muduo
 {
 
@@ -64,9 +70,33 @@ class Logger
   LogStream& stream() { return impl_.stream_; } 
   // stream()һstream ˿Ե<<д뻺
 
+  // One per LOG_* call site, a static made by the macros.
+  struct Site
+  {
+    const char* file;   // __FILE__
+    LogLevel level;
+    int state;          // 1 enabled, 0 disabled, -1 not seen yet
+    Site* next;         // all seen sites, for level changes
+  };
+
+  /// A load and a branch when the site is disabled.
+  static bool enabled(Site* site);
+
   static LogLevel logLevel();
+  /// "TRACE " to "FATAL ", padded to six characters as in each line.
+  static const char* levelName(LogLevel level);
+  /// Thread safe.  The level of sites in no module.
   static void setLogLevel(LogLevel level);
 
+  /// Thread safe.  A module is a source file name, "TcpConnection.cc", or a
+  /// directory in its path, "net".  A file name wins over a directory, and a
+  /// deeper directory over its parents.  Changes apply to running code.
+  static void setModuleLogLevel(const string& module, LogLevel level);
+  /// Thread safe.  Back to setLogLevel()'s level.
+  static void resetModuleLogLevel(const string& module);
+  /// Thread safe.  "module LEVEL" per line.
+  static string moduleLogLevels();
+
   typedef void (*OutputFunc)(const char* msg, int len); 
   typedef void (*FlushFunc)();  
   
@@ -91,6 +121,8 @@ class Impl 	//Ƕ
   SourceFile basename_; // 
 };
 
+  static bool resolve(Site* site);
+
   Impl impl_; // LoggerһImpl
 
 };
@@ -102,20 +134,37 @@ inline Logger::LogLevel Logger::logLevel()
   return g_logLevel;
 }
 
+inline bool Logger::enabled(Site* site)
+{
+  int state = __atomic_load_n(&site->state, __ATOMIC_RELAXED);
+  return __builtin_expect(state != 0, 0) && (state > 0 || resolve(site));
+}
+
+// A GNU statement expression gives each call site its own static Site,
+// constant initialized, so no guard on the fast path.
+#define MUDUO_LOG_ENABLED(level) \
+  (MUDUO_LOG_MIN_LEVEL <= level && ({ \
+    static muduo::Logger::Site muduo_log_site = { __FILE__, level, -1, NULL }; \
+    muduo::Logger::enabled(&muduo_log_site); }))
+
 // ⲿʹõ⼸ ־
-#define LOG_TRACE if (muduo::Logger::logLevel() <= muduo::Logger::TRACE) \
+// if-else, so that an else after "if (x) LOG_INFO << y;" stays with that if
+#define LOG_TRACE if (!MUDUO_LOG_ENABLED(muduo::Logger::TRACE)) {} else \
   muduo::Logger(__FILE__, __LINE__, muduo::Logger::TRACE, __func__).stream()
 
-#define LOG_DEBUG if (muduo::Logger::logLevel() <= muduo::Logger::DEBUG) \
+#define LOG_DEBUG if (!MUDUO_LOG_ENABLED(muduo::Logger::DEBUG)) {} else \
   muduo::Logger(__FILE__, __LINE__, muduo::Logger::DEBUG, __func__).stream()
 
-#define LOG_INFO if (muduo::Logger::logLevel() <= muduo::Logger::INFO) \
+#define LOG_INFO if (!MUDUO_LOG_ENABLED(muduo::Logger::INFO)) {} else \
   muduo::Logger(__FILE__, __LINE__).stream()
 
-#define LOG_WARN muduo::Logger(__FILE__, __LINE__, muduo::Logger::WARN).stream()
-#define LOG_ERROR muduo::Logger(__FILE__, __LINE__, muduo::Logger::ERROR).stream()
+#define LOG_WARN if (!MUDUO_LOG_ENABLED(muduo::Logger::WARN)) {} else \
+  muduo::Logger(__FILE__, __LINE__, muduo::Logger::WARN).stream()
+#define LOG_ERROR if (!MUDUO_LOG_ENABLED(muduo::Logger::ERROR)) {} else \
+  muduo::Logger(__FILE__, __LINE__, muduo::Logger::ERROR).stream()
 #define LOG_FATAL muduo::Logger(__FILE__, __LINE__, muduo::Logger::FATAL).stream()
-#define LOG_SYSERR muduo::Logger(__FILE__, __LINE__, false).stream()
+#define LOG_SYSERR if (!MUDUO_LOG_ENABLED(muduo::Logger::ERROR)) {} else \
+  muduo::Logger(__FILE__, __LINE__, false).stream()
 #define LOG_SYSFATAL muduo::Logger(__FILE__, __LINE__, true).stream()
 
 const char* strerror_tl(int savedErrno);
@@ -0,0 +1,318 @@
+#ifndef MUDUO_BASE_MPMCQUEUE_H
+#define MUDUO_BASE_MPMCQUEUE_H
+
+#include <muduo/base/Futex.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <assert.h>
+#include <limits.h>
+#include <stddef.h>
+
+namespace muduo
+{
+
+///
+/// Bounded multi-producer multi-consumer queue on a ring, D. Vyukov's
+/// algorithm: one CAS per put or take and a sequence number per slot,
+/// no lock.
+///
+/// tryPut() and tryTake() never block.  put() and take() spin a little,
+/// then sleep on a futex; waking costs a syscall only if someone sleeps.
+///
+/// T must be default constructible, a taken slot is swapped with a
+/// default T, so the queue holds no references to taken items.
+///
+template<typename T>
+class MpmcQueue : boost::noncopyable
+{
+ public:
+  /// capacity is rounded up to a power of 2.
+  explicit MpmcQueue(size_t capacity)
+    : mask_(roundUp(capacity) - 1),
+      cells_(new Cell[mask_ + 1]),
+      putPos_(0),
+      takePos_(0),
+      notEmpty_(),
+      notFull_()
+  {
+    for (size_t i = 0; i <= mask_; ++i)
+    {
+      cells_[i].seq = i;
+    }
+  }
+
+  ~MpmcQueue()
+  {
+    delete[] cells_;
+  }
+
+  /// false if full.
+  bool tryPut(const T& x)
+  {
+    if (!push(x))
+      return false;
+    wake(&notEmpty_, 1);
+    return true;
+  }
+
+  /// false if empty.
+  bool tryTake(T* x)
+  {
+    if (!pop(x))
+      return false;
+    wake(&notFull_, 1);
+    return true;
+  }
+
+  void put(const T& x)
+  {
+    if (!push(x))
+    {
+      do
+      {
+        wait(&MpmcQueue::notFull, &notFull_);
+      } while (!push(x));
+      // pass the wakeup on if there is more room
+      if (notFull())
+        wake(&notFull_, 1);
+    }
+    wake(&notEmpty_, 1);
+  }
+
+  T take()
+  {
+    T x;
+    if (!pop(&x))
+    {
+      do
+      {
+        wait(&MpmcQueue::notEmpty, &notEmpty_);
+      } while (!pop(&x));
+      if (notEmpty())
+        wake(&notEmpty_, 1);
+    }
+    wake(&notFull_, 1);
+    return x;
+  }
+
+  /// Puts all n items, in order unless other producers interleave.
+  /// Wakes consumers once per run of puts instead of once per item.
+  void put(const T* items, size_t n)
+  {
+    size_t done = 0;
+    while (done < n)
+    {
+      size_t run = 0;
+      while (done < n && push(items[done]))
+      {
+        ++done;
+        ++run;
+      }
+      if (run > 0)
+      {
+        wake(&notEmpty_, static_cast<int>(std::min<size_t>(run, INT_MAX)));
+      }
+      if (done < n)
+      {
+        wait(&MpmcQueue::notFull, &notFull_);
+      }
+    }
+    if (notFull())
+    {
+      wake(&notFull_, 1);
+    }
+  }
+
+  /// Blocks until there is something, then appends what is there,
+  /// at most capacity() items, to *out.  Returns the number taken.
+  size_t takeAll(std::vector<T>* out)
+  {
+    size_t n = 0;
+    T x;
+    while (n == 0)
+    {
+      while (n <= mask_ && pop(&x))
+      {
+        out->push_back(x);
+        ++n;
+      }
+      if (n == 0)
+      {
+        wait(&MpmcQueue::notEmpty, &notEmpty_);
+      }
+    }
+    if (notEmpty())
+    {
+      wake(&notEmpty_, 1);
+    }
+    wake(&notFull_, INT_MAX);
+    return n;
+  }
+
+  /// A snapshot, may be stale by the time it returns.
+  size_t size() const
+  {
+    size_t take = __atomic_load_n(&takePos_, __ATOMIC_RELAXED);
+    size_t put = __atomic_load_n(&putPos_, __ATOMIC_RELAXED);
+    return put > take ? put - take : 0;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  static const int kSpins = 100;
+
+  struct Cell
+  {
+    size_t seq;
+    T data;
+  };
+
+  // One side of the queue sleeping on a futex.  pending limits wakeups to
+  // one in flight: a burst of puts makes one syscall, not one per item,
+  // while the woken thread is not scheduled yet; it wakes the next one.
+  struct WaitGroup
+  {
+    WaitGroup() : seq(0), waiters(0), pending(0) { }
+    int seq;      // futex word
+    int waiters;
+    int pending;
+  };
+
+  static size_t roundUp(size_t n)
+  {
+    size_t c = 2;
+    while (c < n)
+      c <<= 1;
+    return c;
+  }
+
+  bool push(const T& x)
+  {
+    Cell* cell;
+    size_t pos = __atomic_load_n(&putPos_, __ATOMIC_RELAXED);
+    for (;;)
+    {
+      cell = &cells_[pos & mask_];
+      size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+      ptrdiff_t diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos);
+      if (diff == 0)
+      {
+        if (__atomic_compare_exchange_n(&putPos_, &pos, pos + 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+          break;
+      }
+      else if (diff < 0)
+      {
+        return false;  // full
+      }
+      else
+      {
+        pos = __atomic_load_n(&putPos_, __ATOMIC_RELAXED);
+      }
+    }
+    cell->data = x;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  bool pop(T* x)
+  {
+    Cell* cell;
+    size_t pos = __atomic_load_n(&takePos_, __ATOMIC_RELAXED);
+    for (;;)
+    {
+      cell = &cells_[pos & mask_];
+      size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+      ptrdiff_t diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos + 1);
+      if (diff == 0)
+      {
+        if (__atomic_compare_exchange_n(&takePos_, &pos, pos + 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+          break;
+      }
+      else if (diff < 0)
+      {
+        return false;  // empty
+      }
+      else
+      {
+        pos = __atomic_load_n(&takePos_, __ATOMIC_RELAXED);
+      }
+    }
+    using std::swap;
+    T empty;
+    swap(cell->data, empty);
+    swap(*x, empty);
+    __atomic_store_n(&cell->seq, pos + mask_ + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  // hints for the waiters, the slot may still be in the middle of a put or take
+  bool notEmpty() const
+  {
+    return __atomic_load_n(&putPos_, __ATOMIC_SEQ_CST)
+        != __atomic_load_n(&takePos_, __ATOMIC_SEQ_CST);
+  }
+
+  bool notFull() const
+  {
+    return __atomic_load_n(&putPos_, __ATOMIC_SEQ_CST)
+        - __atomic_load_n(&takePos_, __ATOMIC_SEQ_CST) <= mask_;
+  }
+
+  void wait(bool (MpmcQueue::*ready)() const, WaitGroup* group)
+  {
+    for (int i = 0; i < kSpins; ++i)
+    {
+      if ((this->*ready)())
+        return;
+      detail::cpuRelax();
+    }
+    __atomic_add_fetch(&group->waiters, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    __atomic_store_n(&group->pending, 0, __ATOMIC_RELEASE);
+    int s = __atomic_load_n(&group->seq, __ATOMIC_SEQ_CST);
+    if (!(this->*ready)())
+    {
+      detail::futexWait(&group->seq, s);
+    }
+    __atomic_sub_fetch(&group->waiters, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&group->pending, 0, __ATOMIC_RELEASE);
+  }
+
+  void wake(WaitGroup* group, int n)
+  {
+    // pairs with the fence in wait(): either the waiter sees the change,
+    // or we see the waiter
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&group->waiters, __ATOMIC_RELAXED) > 0
+        && __atomic_exchange_n(&group->pending, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+      __atomic_add_fetch(&group->seq, 1, __ATOMIC_SEQ_CST);
+      detail::futexWake(&group->seq, n);
+    }
+  }
+
+  // positions and wait words written by different sides,
+  // each on its own cache line
+  const size_t mask_;
+  Cell* const cells_;
+  char pad0_[64];
+  size_t putPos_;
+  char pad1_[64 - sizeof(size_t)];
+  size_t takePos_;
+  char pad2_[64 - sizeof(size_t)];
+  WaitGroup notEmpty_;
+  char pad3_[64 - sizeof(WaitGroup)];
+  WaitGroup notFull_;
+  char pad4_[64 - sizeof(WaitGroup)];
+};
+
+}
+
+#endif  // MUDUO_BASE_MPMCQUEUE_H
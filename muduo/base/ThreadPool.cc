@@ -16,8 +16,11 @@ using namespace muduo;
 ThreadPool::ThreadPool(const string& name)
   : mutex_(),
     cond_(mutex_),
+    notFull_(mutex_),
     name_(name),
-    running_(false)
+    running_(false),
+    maxQueueSize_(0),
+    rejectPolicy_(kBlock)
 {
 }
 
@@ -51,6 +54,7 @@ void ThreadPool::stop()
   MutexLockGuard lock(mutex_);
   running_ = false;
   cond_.notifyAll(); // ֪ͨеĵȴ߳ 
+  notFull_.notifyAll();
   }
   for_each(threads_.begin(),
            threads_.end(),
@@ -65,12 +69,66 @@ void ThreadPool::run(const Task& task) // 
   }
   else
   {
+    bool accepted = true;
+    Task dropped;
+    {
     MutexLockGuard lock(mutex_);// ӵ֪ͨеĵȴ߳
-    queue_.push_back(task); 
-    cond_.notify(); // ֪ͨtask ȡִ ʵ̼߳ͬ
+    if (isFull())
+    {
+      switch (rejectPolicy_)
+      {
+        case kBlock:
+          while (isFull() && running_)
+          {
+            notFull_.wait();
+          }
+          accepted = running_;  // stop() woke us up
+          break;
+        case kCallerRuns:
+        case kReject:
+          accepted = false;
+          break;
+        case kDropOldest:
+          dropped.swap(queue_.front().task);
+          queue_.pop_front();
+          break;
+      }
+    }
+    if (accepted)
+    {
+      queue_.push_back(Entry(task, Timestamp::now()));
+      cond_.notify(); // ֪ͨtask ȡִ ʵ̼߳ͬ
+    }
+    }
+
+    if (!accepted && rejectPolicy_ == kCallerRuns)
+    {
+      rejected_.increment();
+      task();
+    }
+    else if (!accepted || dropped)
+    {
+      rejected_.increment();
+      if (rejectCallback_)
+      {
+        rejectCallback_(accepted ? dropped : task);
+      }
+    }
   }
 }
 
+size_t ThreadPool::queueSize() const
+{
+  MutexLockGuard lock(mutex_);
+  return queue_.size();
+}
+
+bool ThreadPool::isFull() const
+{
+  // mutex_ held, but Condition::wait() leaves holder_ stale
+  return maxQueueSize_ > 0 && queue_.size() >= static_cast<size_t>(maxQueueSize_);
+}
+
 ThreadPool::Task ThreadPool::take()
 {
   MutexLockGuard lock(mutex_);
@@ -84,8 +142,15 @@ ThreadPool::Task ThreadPool::take()
   Task task;
   if(!queue_.empty())
   {
-    task = queue_.front(); 	   // ȡ
+    Entry& front = queue_.front(); 	   // ȡ
+    task.swap(front.task);
+    queueTime_.add(Timestamp::now().microSecondsSinceEpoch()
+                   - front.enqueued.microSecondsSinceEpoch());
     queue_.pop_front();
+    if (maxQueueSize_ > 0)
+    {
+      notFull_.notify();
+    }
   }
   return task;
 }
@@ -99,7 +164,10 @@ void ThreadPool::runInThread() // 
       Task task(take());    // ȡ ûtake
       if (task)             // ǿ ִ
       {
+        Timestamp start(Timestamp::now());
         task();
+        runTime_.add(Timestamp::now().microSecondsSinceEpoch()
+                     - start.microSecondsSinceEpoch());
       }
     }
   }
@@ -6,9 +6,12 @@
 #ifndef MUDUO_BASE_THREADPOOL_H
 #define MUDUO_BASE_THREADPOOL_H
 
+#include <muduo/base/Atomic.h>
 #include <muduo/base/Condition.h>
+#include <muduo/base/Histogram.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
 #include <muduo/base/Types.h>
 
 #include <boost/function.hpp>
@@ -20,29 +23,83 @@
 namespace muduo
 {
 
+///
+/// Fixed-size thread pool.
+///
+/// The queue is unbounded unless setMaxQueueSize() is called, then run()
+/// on a full queue follows the RejectPolicy.  Queue time and run time of
+/// every task are kept in histograms, see ThreadPoolInspector.
+///
 class ThreadPool : boost::noncopyable
 {
  public:
   typedef boost::function<void ()> Task; // 
 
+  typedef boost::function<void (const Task&)> RejectCallback;
+
+  /// What run() does when the queue is full.
+  enum RejectPolicy
+  {
+    kBlock,       // wait for room, the default, rejected if stopped meanwhile
+    kCallerRuns,  // run the task in the calling thread
+    kReject,      // pass the task to the reject callback
+    kDropOldest,  // pass the oldest queued task to the reject callback
+  };
+
   explicit ThreadPool(const string& name = string());
   ~ThreadPool();
 
+  /// 0 (default) is unbounded.  Must be called before start().
+  void setMaxQueueSize(int maxSize) { maxQueueSize_ = maxSize; }
+  void setRejectPolicy(RejectPolicy policy) { rejectPolicy_ = policy; }
+  /// Called in the thread calling run(), without any lock held.
+  /// Let the task go out of scope to release what it holds.
+  void setRejectCallback(const RejectCallback& cb) { rejectCallback_ = cb; }
+
   void start(int numThreads); // ʵֵΪ̶̳߳
   void stop();
 
+  /// Thread safe.
   void run(const Task& f); // 
 
+  const string& name() const { return name_; }
+  size_t queueSize() const;
+  int maxQueueSize() const { return maxQueueSize_; }
+  /// Tasks not queued because the queue was full, caller-runs included.
+  /// With kBlock, tasks of callers woken up by stop().
+  int64_t numRejected() const { return rejected_.get(); }
+  /// From run() until a thread picks the task up, in us.
+  const Histogram& queueTime() const { return queueTime_; }
+  const Histogram& runTime() const { return runTime_; }
+
  private:
+  struct Entry
+  {
+    Entry(const Task& t, Timestamp e)
+      : task(t), enqueued(e)
+    { }
+
+    Task task;
+    Timestamp enqueued;
+  };
+
+  bool isFull() const;
   void runInThread();
   Task take();
 
-  MutexLock mutex_;
+  mutable MutexLock mutex_;
   Condition cond_;
+  Condition notFull_;
   string name_;
   boost::ptr_vector<muduo::Thread> threads_; // ߳
-  std::deque<Task> queue_;   //  
+  std::deque<Entry> queue_;   //  
   bool running_;
+  int maxQueueSize_;
+  RejectPolicy rejectPolicy_;
+  RejectCallback rejectCallback_;
+  mutable AtomicInt64 rejected_;
+  Histogram queueTime_;
+  Histogram runTime_;
 };
 
 }
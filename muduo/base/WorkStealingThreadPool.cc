@@ -0,0 +1,410 @@
+#include <muduo/base/WorkStealingThreadPool.h>
+
+#include <muduo/base/Exception.h>
+#include <muduo/base/Futex.h>
+
+#include <boost/bind.hpp>
+
+#include <vector>
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+
+using namespace muduo;
+using muduo::detail::futexWait;
+using muduo::detail::futexWake;
+
+namespace
+{
+
+__thread const void* t_pool = NULL;  // pool of the current worker thread
+__thread void* t_worker = NULL;
+
+const size_t kMaxSharedBatch = 32;
+
+// Chase-Lev deque of T*, as in "Correct and Efficient Work-Stealing for
+// Weak Memory Models", Le et al., PPoPP 2013.
+// push() and take() by the owner only, steal() by any thread.
+template<typename T>
+class WorkStealingDeque : boost::noncopyable
+{
+ public:
+  WorkStealingDeque()
+    : top_(0),
+      bottom_(0),
+      array_(new Array(kInitialCapacity))
+  {
+  }
+
+  ~WorkStealingDeque()
+  {
+    delete array_;
+    for (size_t i = 0; i < retired_.size(); ++i)
+    {
+      delete retired_[i];
+    }
+  }
+
+  void push(T* x)
+  {
+    int64_t b = __atomic_load_n(&bottom_, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&top_, __ATOMIC_ACQUIRE);
+    Array* a = __atomic_load_n(&array_, __ATOMIC_RELAXED);
+    if (b - t > a->capacity - 1)
+    {
+      a = grow(a, b, t);
+    }
+    a->put(b, x);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&bottom_, b + 1, __ATOMIC_RELAXED);
+  }
+
+  // LIFO, NULL when empty
+  T* take()
+  {
+    int64_t b = __atomic_load_n(&bottom_, __ATOMIC_RELAXED) - 1;
+    Array* a = __atomic_load_n(&array_, __ATOMIC_RELAXED);
+    __atomic_store_n(&bottom_, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = __atomic_load_n(&top_, __ATOMIC_RELAXED);
+    T* x = NULL;
+    if (t <= b)
+    {
+      x = a->get(b);
+      if (t == b)
+      {
+        // the last one, thieves may want it too
+        if (!__atomic_compare_exchange_n(&top_, &t, t + 1, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        {
+          x = NULL;
+        }
+        __atomic_store_n(&bottom_, b + 1, __ATOMIC_RELAXED);
+      }
+    }
+    else
+    {
+      __atomic_store_n(&bottom_, b + 1, __ATOMIC_RELAXED);
+    }
+    return x;
+  }
+
+  // FIFO, NULL when empty or another thread got it first
+  T* steal()
+  {
+    int64_t t = __atomic_load_n(&top_, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&bottom_, __ATOMIC_ACQUIRE);
+    T* x = NULL;
+    if (t < b)
+    {
+      Array* a = __atomic_load_n(&array_, __ATOMIC_ACQUIRE);
+      x = a->get(t);
+      if (!__atomic_compare_exchange_n(&top_, &t, t + 1, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+      {
+        x = NULL;
+      }
+    }
+    return x;
+  }
+
+  // a hint unless called by the owner
+  bool empty() const
+  {
+    int64_t b = __atomic_load_n(&bottom_, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&top_, __ATOMIC_RELAXED);
+    return b <= t;
+  }
+
+ private:
+  static const int64_t kInitialCapacity = 256;  // power of 2
+
+  struct Array : boost::noncopyable
+  {
+    explicit Array(int64_t cap)
+      : capacity(cap),
+        slots(new T*[cap])
+    {
+    }
+
+    ~Array()
+    {
+      delete[] slots;
+    }
+
+    T* get(int64_t i) const
+    { return __atomic_load_n(&slots[i & (capacity - 1)], __ATOMIC_RELAXED); }
+
+    void put(int64_t i, T* x)
+    { __atomic_store_n(&slots[i & (capacity - 1)], x, __ATOMIC_RELAXED); }
+
+    const int64_t capacity;
+    T** const slots;
+  };
+
+  Array* grow(Array* a, int64_t b, int64_t t)
+  {
+    Array* bigger = new Array(2 * a->capacity);
+    for (int64_t i = t; i < b; ++i)
+    {
+      bigger->put(i, a->get(i));
+    }
+    // thieves may still be reading the old one
+    retired_.push_back(a);
+    __atomic_store_n(&array_, bigger, __ATOMIC_RELEASE);
+    return bigger;
+  }
+
+  int64_t top_;
+  char pad_[64];  // top_ is written by thieves, bottom_ by the owner
+  int64_t bottom_;
+  Array* array_;
+  std::vector<Array*> retired_;
+};
+
+}
+
+class WorkStealingThreadPool::Worker : boost::noncopyable
+{
+ public:
+  explicit Worker(int index)
+    : seed_(static_cast<uint32_t>(index) * 2654435761u + 1)
+  {
+  }
+
+  // xorshift
+  uint32_t nextRandom()
+  {
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return seed_;
+  }
+
+  WorkStealingDeque<Task> deque;
+
+ private:
+  uint32_t seed_;
+};
+
+WorkStealingThreadPool::WorkStealingThreadPool(const string& name)
+  : name_(name),
+    sharedSize_(0),
+    wakeups_(0),
+    sleeping_(0),
+    wakePending_(0),
+    running_(0)
+{
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool()
+{
+  if (running_)
+  {
+    stop();
+  }
+}
+
+void WorkStealingThreadPool::start(int numThreads)
+{
+  assert(threads_.empty());
+  running_ = 1;
+
+  // every deque exists before any thread may steal from it
+  workers_.reserve(numThreads);
+  for (int i = 0; i < numThreads; ++i)
+  {
+    workers_.push_back(new Worker(i));
+  }
+  threads_.reserve(numThreads);
+  for (int i = 0; i < numThreads; ++i)
+  {
+    char id[32];
+    snprintf(id, sizeof id, "%d", i);
+    threads_.push_back(new muduo::Thread(
+          boost::bind(&WorkStealingThreadPool::runInThread, this, i), name_+id));
+    threads_[i].start();
+  }
+}
+
+void WorkStealingThreadPool::stop()
+{
+  __atomic_store_n(&running_, 0, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&wakeups_, 1, __ATOMIC_SEQ_CST);
+  futexWake(&wakeups_, INT_MAX);
+  for_each(threads_.begin(),
+           threads_.end(),
+           boost::bind(&muduo::Thread::join, _1));
+
+  // workers are gone, what is left is dropped
+  for (size_t i = 0; i < workers_.size(); ++i)
+  {
+    while (Task* task = workers_[i].deque.take())
+    {
+      delete task;
+    }
+  }
+  MutexLockGuard lock(mutex_);
+  for (size_t i = 0; i < sharedQueue_.size(); ++i)
+  {
+    delete sharedQueue_[i];
+  }
+  sharedQueue_.clear();
+  sharedSize_ = 0;
+}
+
+void WorkStealingThreadPool::run(const Task& task)
+{
+  if (threads_.empty())
+  {
+    task();
+    return;
+  }
+
+  Task* t = new Task(task);
+  if (t_pool == this)
+  {
+    static_cast<Worker*>(t_worker)->deque.push(t);
+  }
+  else
+  {
+    MutexLockGuard lock(mutex_);
+    sharedQueue_.push_back(t);
+    __atomic_store_n(&sharedSize_, static_cast<int>(sharedQueue_.size()), __ATOMIC_RELAXED);
+  }
+  wakeOne();
+}
+
+void WorkStealingThreadPool::wakeOne()
+{
+  // pairs with the fence in runInThread(): either a sleeper sees the
+  // new task, or we see the sleeper.  While a woken worker has not yet
+  // come back, a burst of run() makes no more syscalls; it wakes the
+  // next one itself if there is more work.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&sleeping_, __ATOMIC_RELAXED) > 0
+      && __atomic_exchange_n(&wakePending_, 1, __ATOMIC_ACQ_REL) == 0)
+  {
+    __atomic_add_fetch(&wakeups_, 1, __ATOMIC_SEQ_CST);
+    futexWake(&wakeups_, 1);
+  }
+}
+
+WorkStealingThreadPool::Task* WorkStealingThreadPool::takeShared()
+{
+  if (__atomic_load_n(&sharedSize_, __ATOMIC_RELAXED) == 0)
+  {
+    return NULL;
+  }
+
+  Worker* self = static_cast<Worker*>(t_worker);
+  Task* task = NULL;
+  {
+  MutexLockGuard lock(mutex_);
+  if (!sharedQueue_.empty())
+  {
+    task = sharedQueue_.front();
+    sharedQueue_.pop_front();
+    // take a fair share along, so others steal instead of locking
+    size_t batch = std::min(sharedQueue_.size() / workers_.size(), kMaxSharedBatch);
+    for (size_t i = 0; i < batch; ++i)
+    {
+      self->deque.push(sharedQueue_.front());
+      sharedQueue_.pop_front();
+    }
+    __atomic_store_n(&sharedSize_, static_cast<int>(sharedQueue_.size()), __ATOMIC_RELAXED);
+  }
+  }
+  if (task && (!self->deque.empty() || sharedSize_ > 0))
+  {
+    wakeOne();
+  }
+  return task;
+}
+
+WorkStealingThreadPool::Task* WorkStealingThreadPool::findTask(Worker* self)
+{
+  Task* task = self->deque.take();
+  if (task == NULL)
+  {
+    task = takeShared();
+  }
+  if (task == NULL)
+  {
+    const uint32_t n = static_cast<uint32_t>(workers_.size());
+    const uint32_t start = self->nextRandom() % n;
+    for (uint32_t i = 0; i < n && task == NULL; ++i)
+    {
+      Worker& victim = workers_[(start + i) % n];
+      while (&victim != self && task == NULL && !victim.deque.empty())
+      {
+        task = victim.deque.steal();
+      }
+    }
+    if (task)
+    {
+      steals_.increment();
+      // where there was one, there may be more
+      wakeOne();
+    }
+  }
+  return task;
+}
+
+void WorkStealingThreadPool::execute(Task* task)
+{
+  (*task)();
+  delete task;
+}
+
+void WorkStealingThreadPool::runInThread(int index)
+{
+  Worker* self = &workers_[index];
+  t_pool = this;
+  t_worker = self;
+  try
+  {
+    while (__atomic_load_n(&running_, __ATOMIC_ACQUIRE))
+    {
+      Task* task = findTask(self);
+      if (task == NULL)
+      {
+        __atomic_add_fetch(&sleeping_, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        __atomic_store_n(&wakePending_, 0, __ATOMIC_RELEASE);
+        int wakeups = __atomic_load_n(&wakeups_, __ATOMIC_SEQ_CST);
+        task = findTask(self);
+        if (task == NULL && __atomic_load_n(&running_, __ATOMIC_SEQ_CST))
+        {
+          futexWait(&wakeups_, wakeups);
+        }
+        __atomic_sub_fetch(&sleeping_, 1, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&wakePending_, 0, __ATOMIC_RELEASE);
+      }
+      if (task)
+      {
+        execute(task);
+      }
+    }
+  }
+  catch (const Exception& ex)
+  {
+    fprintf(stderr, "exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    fprintf(stderr, "reason: %s\n", ex.what());
+    fprintf(stderr, "stack trace: %s\n", ex.stackTrace());
+    abort();
+  }
+  catch (const std::exception& ex)
+  {
+    fprintf(stderr, "exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    fprintf(stderr, "reason: %s\n", ex.what());
+    abort();
+  }
+  catch (...)
+  {
+    fprintf(stderr, "unknown exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    throw; // rethrow
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
+#define MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Types.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <deque>
+
+namespace muduo
+{
+
+///
+/// Fixed-size thread pool, one task deque per worker.
+///
+/// A task run() by a worker goes to the bottom of the worker's own deque,
+/// which the worker takes back from without locking.  Idle workers steal
+/// from the top of a random other deque (Chase-Lev).  Tasks from other
+/// threads go through one shared queue.  Idle workers sleep on a futex.
+///
+/// Drop-in for ThreadPool where tasks spawn tasks, e.g. divide and conquer.
+///
+class WorkStealingThreadPool : boost::noncopyable
+{
+ public:
+  typedef boost::function<void ()> Task;
+
+  explicit WorkStealingThreadPool(const string& name = string());
+  ~WorkStealingThreadPool();
+
+  void start(int numThreads);
+  /// Tasks not yet started are dropped, like ThreadPool.
+  void stop();
+
+  /// Runs f in the calling thread if the pool has no thread.
+  /// Thread safe.
+  void run(const Task& f);
+
+  /// Tasks a worker took from another one's deque.
+  int64_t steals() const { return steals_.get(); }
+
+ private:
+  class Worker;
+
+  void runInThread(int index);
+  Task* findTask(Worker* self);
+  Task* takeShared();
+  void wakeOne();
+  void execute(Task* task);
+
+  string name_;
+  boost::ptr_vector<Worker> workers_;
+  boost::ptr_vector<muduo::Thread> threads_;
+  MutexLock mutex_;
+  std::deque<Task*> sharedQueue_;  // @GuardedBy mutex_
+  int sharedSize_;                 // atomic, peeked without locking
+  int wakeups_;                    // futex word, bumped to wake sleepers
+  int sleeping_;                   // atomic
+  int wakePending_;                // atomic, one futex wake in flight at most
+  int running_;                    // atomic
+  mutable AtomicInt64 steals_;
+};
+
+}
+
+#endif  // MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
@@ -0,0 +1,85 @@
+// Front-end throughput of AsyncLogging with many threads logging at once.
+//
+// With a small memory budget, shows what the overload policy drops.
+//
+// usage: asynclogging_bench [max threads] [lines per thread] [memory budget MB]
+
+#include <muduo/base/AsyncLogging.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+muduo::AsyncLogging* g_asyncLog = NULL;
+
+void asyncOutput(const char* msg, int len)
+{
+  g_asyncLog->append(msg, len);
+}
+
+void logInThread(int lines, muduo::CountDownLatch* ready, muduo::CountDownLatch* go)
+{
+  ready->countDown();
+  go->wait();
+  for (int i = 0; i < lines; ++i)
+  {
+    if (i % 100 == 0)
+    {
+      LOG_ERROR << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i;
+    }
+    else
+    {
+      LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i;
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int maxThreads = argc > 1 ? atoi(argv[1]) : 32;
+  int lines = argc > 2 ? atoi(argv[2]) : 20000;
+  int budget = argc > 3 ? atoi(argv[3]) : 100;
+
+  char name[256];
+  strncpy(name, argv[0], sizeof name - 1);
+  name[sizeof name - 1] = '\0';
+  muduo::AsyncLogging log(::basename(name), 500*1000*1000);
+  log.setMemoryBudget(static_cast<size_t>(budget) * 1000 * 1000);
+  log.start();
+  g_asyncLog = &log;
+  muduo::Logger::setOutput(asyncOutput);
+
+  for (int threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    muduo::CountDownLatch ready(threads);
+    muduo::CountDownLatch go(1);
+    boost::ptr_vector<muduo::Thread> workers;
+    for (int i = 0; i < threads; ++i)
+    {
+      workers.push_back(new muduo::Thread(boost::bind(logInThread, lines, &ready, &go)));
+      workers.back().start();
+    }
+    ready.wait();
+    muduo::Timestamp start(muduo::Timestamp::now());
+    go.countDown();
+    for_each(workers.begin(), workers.end(), boost::bind(&muduo::Thread::join, _1));
+    double seconds = timeDifference(muduo::Timestamp::now(), start);
+    int64_t total = static_cast<int64_t>(threads) * lines;
+    printf("%2d threads %8.0f ns/line %6.2f M lines/s"
+           "  dropped INFO %lld ERROR %lld blocked %lld\n",
+           threads, seconds * 1e9 / static_cast<double>(total),
+           static_cast<double>(total) / seconds / 1e6,
+           static_cast<long long>(log.droppedLines(muduo::Logger::INFO)),
+           static_cast<long long>(log.droppedLines(muduo::Logger::ERROR)),
+           static_cast<long long>(log.blockedLines()));
+    // let the logging thread catch up before the next round
+    struct timespec ts = { 0, 300*1000*1000 };
+    nanosleep(&ts, NULL);
+  }
+}
@@ -0,0 +1,114 @@
+#include <muduo/base/AsyncLogging.h>
+#include <muduo/base/FileUtil.h>
+#include <muduo/base/ProcessInfo.h>
+#include <muduo/base/Thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Lines of one thread come out in the order it wrote them, even when
+// small ones fit the staging ring while large ones spill over to the
+// shared buffer.
+
+const char* kBasename = "asynclogging_unittest";
+const int kThreads = 16;
+const int kLines = 2000;
+
+muduo::AsyncLogging* g_asyncLog = NULL;
+
+// mostly small, some larger than the ring of 128KB, some to fill it up
+int lineSize(int i)
+{
+  if (i % 20 == 19)
+    return 130 * 1024;
+  if (i % 3 == 0)
+    return 8 * 1024;
+  return 100;
+}
+
+void logFrom(int thread)
+{
+  muduo::string line;
+  for (int i = 0; i < kLines; ++i)
+  {
+    char head[32];
+    snprintf(head, sizeof head, "%d %d ", thread, i);
+    line = head;
+    line.append(static_cast<size_t>(lineSize(i)), 'x');
+    line.push_back('\n');
+    // ERROR is never dropped
+    g_asyncLog->append(line.data(), static_cast<int>(line.size()), muduo::Logger::ERROR);
+  }
+}
+
+int main()
+{
+  {
+    muduo::AsyncLogging log(kBasename, 500*1000*1000);
+    g_asyncLog = &log;
+    log.start();
+    boost::ptr_vector<muduo::Thread> threads;
+    for (int i = 0; i < kThreads; ++i)
+    {
+      threads.push_back(new muduo::Thread(boost::bind(logFrom, i)));
+      threads.back().start();
+    }
+    for (int i = 0; i < kThreads; ++i)
+    {
+      threads[i].join();
+    }
+    log.stop();
+    g_asyncLog = NULL;
+  }
+
+  char suffix[32];
+  snprintf(suffix, sizeof suffix, ".%d.log", muduo::ProcessInfo::pid());
+  size_t suffixLen = strlen(suffix);
+  muduo::string file;
+  DIR* dir = ::opendir(".");
+  assert(dir);
+  while (struct dirent* ent = ::readdir(dir))
+  {
+    muduo::string name(ent->d_name);
+    if (name.find(kBasename) == 0 && name.size() > suffixLen
+        && name.compare(name.size() - suffixLen, suffixLen, suffix) == 0)
+    {
+      int err = muduo::FileUtil::readFile(name, 1024*1024*1024, &file);
+      assert(err == 0);
+      (void) err;
+      ::unlink(name.c_str());
+    }
+  }
+  ::closedir(dir);
+
+  int next[kThreads] = { 0 };
+  int lines = 0;
+  for (size_t pos = 0; pos < file.size(); )
+  {
+    size_t end = file.find('\n', pos);
+    assert(end != muduo::string::npos);
+    // not sscanf(), which would strlen() the rest of the file every line
+    char* space = NULL;
+    long thread = strtol(file.c_str() + pos, &space, 10);
+    long i = strtol(space, NULL, 10);
+    assert(thread >= 0 && thread < kThreads);
+    if (i != next[thread])
+    {
+      fprintf(stderr, "thread %ld: line %ld after %d\n", thread, i, next[thread] - 1);
+      abort();
+    }
+    ++next[thread];
+    ++lines;
+    pos = end + 1;
+  }
+  printf("%d lines\n", lines);
+  assert(lines == kThreads * kLines);
+  puts("OK");
+}
@@ -0,0 +1,97 @@
+// Cost of a log line on the calling thread, text against binary, with the
+// line of Logging_test's bench plus a double.  Output is dropped, or
+// written to /dev/null with stdio.  Also how fast muduo_logdecode renders.
+//
+// usage: binarylogging_bench [lines]
+
+#include <muduo/base/BinaryLogging.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Timestamp.h>
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int64_t g_total;
+FILE* g_file;
+muduo::string* g_keep;
+
+void output(const char* msg, int len)
+{
+  g_total += len;
+  if (g_file)
+  {
+    fwrite(msg, 1, len, g_file);
+  }
+  if (g_keep)
+  {
+    g_keep->append(msg, len);
+  }
+}
+
+void report(const char* type, int n, muduo::Timestamp start)
+{
+  double seconds = timeDifference(muduo::Timestamp::now(), start);
+  printf("%-20s %6.1f ns/line %6.1f bytes/line %8.2f MiB/s\n",
+         type, seconds * 1e9 / n, static_cast<double>(g_total) / n,
+         static_cast<double>(g_total) / seconds / (1024 * 1024));
+}
+
+void benchText(const char* type, int n)
+{
+  muduo::Logger::setOutput(output);
+  g_total = 0;
+  muduo::Timestamp start(muduo::Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i << ' ' << i * 0.5;
+  }
+  report(type, n, start);
+}
+
+void benchBinary(const char* type, int n)
+{
+  muduo::BinaryLogger::setOutput(output);
+  g_total = 0;
+  muduo::Timestamp start(muduo::Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    LOGB_INFO("Hello 0123456789 abcdefghijklmnopqrstuvwxyz %d %g") << i << i * 0.5;
+  }
+  report(type, n, start);
+}
+
+int main(int argc, char* argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000*1000;
+
+  benchText("text nop", n);
+  benchBinary("binary nop", n);
+
+  char buffer[64*1024];
+  g_file = fopen("/dev/null", "w");
+  setbuffer(g_file, buffer, sizeof buffer);
+  benchText("text /dev/null", n);
+  benchBinary("binary /dev/null", n);
+  fclose(g_file);
+  g_file = NULL;
+
+  muduo::string records;
+  g_keep = &records;
+  benchBinary("binary to memory", n);
+  g_keep = NULL;
+
+  muduo::BinaryLogDecoder decoder;
+  muduo::string text;
+  muduo::Timestamp start(muduo::Timestamp::now());
+  size_t used = 0;
+  while (used < records.size())
+  {
+    text.clear();
+    size_t len = std::min<size_t>(records.size() - used, 64*1024);
+    used += decoder.decode(records.data() + used, len, &text);
+  }
+  g_total = static_cast<int64_t>(records.size());  // bytes read
+  report("decode", n, start);
+}
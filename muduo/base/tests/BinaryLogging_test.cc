@@ -0,0 +1,192 @@
+#include <muduo/base/BinaryLogging.h>
+#include <muduo/base/AsyncLogging.h>
+#include <muduo/base/FileUtil.h>
+#include <muduo/base/ProcessInfo.h>
+#include <muduo/base/Thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+muduo::string g_records;
+muduo::AsyncLogging* g_asyncLog = NULL;
+
+void output(const char* msg, int len)
+{
+  g_records.append(msg, len);
+}
+
+void asyncOutput(const char* msg, int len)
+{
+  g_asyncLog->append(msg, len);
+}
+
+void logSome(int i)
+{
+  LOGB_INFO("Hello %d %s %.2f %c %x%%") << i << "world" << 3.14159 << 'z' << 255;
+  LOGB_WARN("unsigned %u long %lld") << 42u << -1234567890123LL;
+  LOGB_ERROR("missing %d %d") << 1;
+  LOGB_INFO("extra none") << 1;
+  LOGB_DEBUG("not logged %d") << i;
+}
+
+bool contains(const muduo::string& text, const char* s)
+{
+  return text.find(s) != muduo::string::npos;
+}
+
+int count(const muduo::string& text, const char* s)
+{
+  int n = 0;
+  for (size_t pos = text.find(s); pos != muduo::string::npos; pos = text.find(s, pos + 1))
+  {
+    ++n;
+  }
+  return n;
+}
+
+// a call site, with its own format, per instance
+template<int kSite>
+void logAt(int thread, int i)
+{
+  LOGB_INFO("site %d thread %d line %d") << kSite << thread << i;
+}
+
+const int kSites = 8;
+const int kThreads = 8;
+const int kLines = 2000;
+void (*const g_sites[kSites])(int, int) =
+{
+  logAt<0>, logAt<1>, logAt<2>, logAt<3>, logAt<4>, logAt<5>, logAt<6>, logAt<7>,
+};
+
+// every thread starts at another site, so that each format is first
+// written by one thread while others race to use it
+void logFrom(int thread)
+{
+  for (int i = 0; i < kLines; ++i)
+  {
+    g_sites[(thread + i) % kSites](thread, i);
+  }
+}
+
+// records of many threads merged by AsyncLogging decode without a miss
+void testAsyncLogging()
+{
+  const char* basename = "binarylogging_test_async";
+  {
+    muduo::AsyncLogging log(basename, 500*1000*1000);
+    log.setFileHeader(muduo::BinaryLogger::formats);
+    g_asyncLog = &log;
+    muduo::BinaryLogger::setOutput(asyncOutput);
+    log.start();
+    boost::ptr_vector<muduo::Thread> threads;
+    for (int i = 0; i < kThreads; ++i)
+    {
+      threads.push_back(new muduo::Thread(boost::bind(logFrom, i)));
+      threads.back().start();
+    }
+    for (int i = 0; i < kThreads; ++i)
+    {
+      threads[i].join();
+    }
+    log.stop();
+    muduo::BinaryLogger::setOutput(output);
+    g_asyncLog = NULL;
+  }
+
+  char suffix[32];
+  snprintf(suffix, sizeof suffix, ".%d.log", muduo::ProcessInfo::pid());
+  size_t suffixLen = strlen(suffix);
+  muduo::string decoded;
+  muduo::BinaryLogDecoder decoder;
+  DIR* dir = ::opendir(".");
+  assert(dir);
+  while (struct dirent* ent = ::readdir(dir))
+  {
+    muduo::string name(ent->d_name);
+    if (name.find(basename) == 0 && name.size() > suffixLen
+        && name.compare(name.size() - suffixLen, suffixLen, suffix) == 0)
+    {
+      muduo::string file;
+      int err = muduo::FileUtil::readFile(name, 1024*1024*1024, &file);
+      size_t used = decoder.decode(file.data(), file.size(), &decoded);
+      assert(err == 0 && used == file.size());
+      (void) err; (void) used;
+      ::unlink(name.c_str());
+    }
+  }
+  ::closedir(dir);
+  decoder.finish(&decoded);
+
+  printf("%d lines decoded from %d threads\n", count(decoded, " thread "), kThreads);
+  assert(!contains(decoded, "<unknown format"));
+  assert(count(decoded, " thread ") == kThreads * kLines);
+  assert(contains(decoded, "site 6 thread 7 line 1999 - "));
+}
+
+int main()
+{
+  muduo::BinaryLogger::setOutput(output);
+  for (int i = 0; i < 3; ++i)
+  {
+    logSome(i);
+  }
+  // text lines may share the file
+  muduo::string text("a line of text\n");
+  g_records += text;
+  logSome(3);
+
+  // byte by byte, so that every record is split somewhere
+  muduo::BinaryLogDecoder decoder;
+  muduo::string decoded;
+  size_t used = 0;
+  for (size_t end = 1; end <= g_records.size(); ++end)
+  {
+    used += decoder.decode(g_records.data() + used, end - used, &decoded);
+  }
+  assert(used == g_records.size());
+  decoder.finish(&decoded);
+  printf("%zu bytes\n%s", g_records.size(), decoded.c_str());
+
+  assert(contains(decoded, "INFO  Hello 2 world 3.14 z ff% - BinaryLogging_test.cc:31\n"));
+  assert(contains(decoded, "WARN  unsigned 42 long -1234567890123 - BinaryLogging_test.cc:32\n"));
+  assert(contains(decoded, "ERROR missing 1 %d - "));
+  assert(contains(decoded, "INFO  extra none - "));
+  assert(contains(decoded, text.c_str()));
+  assert(!contains(decoded, "not logged"));
+
+  // a rolled file has no format records of its own, only the header
+  g_records.clear();
+  logSome(4);
+  muduo::string file = muduo::BinaryLogger::formats() + g_records;
+  muduo::BinaryLogDecoder another;
+  muduo::string again;
+  assert(another.decode(file.data(), file.size(), &again) == file.size());
+  assert(contains(again, "Hello 4 world"));
+
+  // lines ahead of their formats wait for them
+  muduo::string reordered = g_records + muduo::BinaryLogger::formats();
+  muduo::BinaryLogDecoder late;
+  muduo::string held;
+  assert(late.decode(reordered.data(), reordered.size(), &held) == reordered.size());
+  late.finish(&held);
+  assert(contains(held, "Hello 4 world"));
+  assert(!contains(held, "<unknown format"));
+
+  // and are reported at the end if they never come
+  muduo::BinaryLogDecoder missing;
+  muduo::string unknown;
+  assert(missing.decode(g_records.data(), g_records.size(), &unknown) == g_records.size());
+  assert(unknown.empty());
+  missing.finish(&unknown);
+  assert(count(unknown, "<unknown format") == 4);
+
+  testAsyncLogging();
+  puts("OK");
+}
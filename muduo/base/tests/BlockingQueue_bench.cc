@@ -1,101 +1,225 @@
+#include <muduo/base/Atomic.h>
 #include <muduo/base/BlockingQueue.h>
+#include <muduo/base/BoundedBlockingQueue.h>
 #include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Histogram.h>
+#include <muduo/base/MpmcQueue.h>
 #include <muduo/base/Thread.h>
 #include <muduo/base/Timestamp.h>
 
 #include <boost/bind.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
-#include <map>
-#include <string>
+#include <vector>
 #include <stdio.h>
+#include <stdlib.h>
 
-class Bench
+// Throughput and put-to-take latency of the queues in base, for some
+// producer/consumer counts.  Producers put timestamps as fast as they
+// can, so the latency includes time spent in a full queue.
+// items/take is how many items a consumer gets per lock or CAS round.
+//
+// usage: blockingqueue_bench [items per producer] [queue capacity]
+
+const int kBatch = 64;
+
+template<typename Queue>
+Queue* newQueue(int capacity)
 {
- public:
-  Bench(int numThreads)
-    : latch_(numThreads),
-      threads_(numThreads)
+  return new Queue(capacity);
+}
+
+template<>
+muduo::BlockingQueue<muduo::Timestamp>* newQueue<muduo::BlockingQueue<muduo::Timestamp> >(int)
+{
+  return new muduo::BlockingQueue<muduo::Timestamp>;
+}
+
+template<typename Queue>
+void putMany(Queue* queue, const std::vector<muduo::Timestamp>& items, bool)
+{
+  for (size_t i = 0; i < items.size(); ++i)
   {
-    for (int i = 0; i < numThreads; ++i)
-    {
-      char name[32];
-      snprintf(name, sizeof name, "work thread %d", i);
-      threads_.push_back(new muduo::Thread(
-            boost::bind(&Bench::threadFunc, this), muduo::string(name)));
-    }
-    for_each(threads_.begin(), threads_.end(), boost::bind(&muduo::Thread::start, _1));
+    queue->put(items[i]);
   }
+}
 
-  void run(int times)
+void putMany(muduo::MpmcQueue<muduo::Timestamp>* queue,
+             const std::vector<muduo::Timestamp>& items, bool batch)
+{
+  if (batch)
   {
-    printf("waiting for count down latch\n");
-    latch_.wait();
-    printf("all threads started\n");
-    for (int i = 0; i < times; ++i)
+    queue->put(&items[0], items.size());
+  }
+  else
+  {
+    for (size_t i = 0; i < items.size(); ++i)
     {
-      muduo::Timestamp now(muduo::Timestamp::now());
-      queue_.put(now);
-      usleep(1000);
+      queue->put(items[i]);
     }
   }
+}
+
+template<typename Queue>
+void takeSome(Queue* queue, std::vector<muduo::Timestamp>* items, bool)
+{
+  items->push_back(queue->take());
+}
+
+void takeSome(muduo::BlockingQueue<muduo::Timestamp>* queue,
+              std::vector<muduo::Timestamp>* items, bool batch)
+{
+  if (batch)
+  {
+    std::deque<muduo::Timestamp> all;
+    queue->takeAll(&all);
+    items->assign(all.begin(), all.end());
+  }
+  else
+  {
+    items->push_back(queue->take());
+  }
+}
+
+void takeSome(muduo::MpmcQueue<muduo::Timestamp>* queue,
+              std::vector<muduo::Timestamp>* items, bool batch)
+{
+  if (batch)
+  {
+    queue->takeAll(items);
+  }
+  else
+  {
+    items->push_back(queue->take());
+  }
+}
 
-  void joinAll()
+template<typename Queue>
+class Bench
+{
+ public:
+  Bench(int producers, int consumers, int capacity, bool batch)
+    : queue_(newQueue<Queue>(capacity)),
+      producers_(producers),
+      consumers_(consumers),
+      batch_(batch),
+      latch_(producers + consumers)
   {
-    for (size_t i = 0; i < threads_.size(); ++i)
+  }
+
+  ~Bench()
+  {
+    delete queue_;
+  }
+
+  void run(const char* name, int items)
+  {
+    boost::ptr_vector<muduo::Thread> threads;
+    for (int i = 0; i < consumers_; ++i)
+    {
+      threads.push_back(new muduo::Thread(boost::bind(&Bench::consume, this)));
+      threads.back().start();
+    }
+    for (int i = 0; i < producers_; ++i)
+    {
+      threads.push_back(new muduo::Thread(boost::bind(&Bench::produce, this, items)));
+      threads.back().start();
+    }
+    latch_.wait();
+    muduo::Timestamp start(muduo::Timestamp::now());
+    for (int i = 0; i < producers_; ++i)
+    {
+      threads[consumers_ + i].join();
+    }
+    std::vector<muduo::Timestamp> stops(consumers_, muduo::Timestamp::invalid());
+    putMany(queue_, stops, false);
+    for (int i = 0; i < consumers_; ++i)
     {
-      queue_.put(muduo::Timestamp::invalid());
+      threads[i].join();
     }
+    double seconds = timeDifference(muduo::Timestamp::now(), start);
 
-    for_each(threads_.begin(), threads_.end(), boost::bind(&muduo::Thread::join, _1));
+    printf("%-22s %2dP %2dC %8.2f Mitems/s %7.1f items/take"
+           "  latency p50 <%lldus p99 <%lldus max %lldus\n",
+           name, producers_, consumers_,
+           static_cast<double>(items) * producers_ / seconds / 1e6,
+           static_cast<double>(items) * producers_ / static_cast<double>(takes_.get()),
+           static_cast<long long>(latency_.percentile(50)),
+           static_cast<long long>(latency_.percentile(99)),
+           static_cast<long long>(latency_.max()));
   }
 
  private:
-
-  void threadFunc()
+  void produce(int items)
   {
-    printf("tid=%d, %s started\n",
-           muduo::CurrentThread::tid(),
-           muduo::CurrentThread::name());
-
-    std::map<int, int> delays;
     latch_.countDown();
-    bool running = true;
-    while (running)
+    latch_.wait();
+    std::vector<muduo::Timestamp> batch;
+    batch.reserve(kBatch);
+    for (int i = 0; i < items; i += kBatch)
     {
-      muduo::Timestamp t(queue_.take());
+      batch.clear();
       muduo::Timestamp now(muduo::Timestamp::now());
-      if (t.valid())
+      for (int j = i; j < items && j < i + kBatch; ++j)
       {
-        int delay = static_cast<int>(timeDifference(now, t) * 1000000);
-        // printf("tid=%d, latency = %d us\n",
-        //        muduo::CurrentThread::tid(), delay);
-        ++delays[delay];
+        batch.push_back(now);
       }
-      running = t.valid();
+      putMany(queue_, batch, batch_);
     }
+  }
 
-    printf("tid=%d, %s stopped\n",
-           muduo::CurrentThread::tid(),
-           muduo::CurrentThread::name());
-    for (std::map<int, int>::iterator it = delays.begin();
-        it != delays.end(); ++it)
+  void consume()
+  {
+    latch_.countDown();
+    std::vector<muduo::Timestamp> items;
+    bool running = true;
+    while (running)
     {
-      printf("tid = %d, delay = %d, count = %d\n",
-             muduo::CurrentThread::tid(),
-             it->first, it->second);
+      items.clear();
+      takeSome(queue_, &items, batch_);
+      takes_.increment();
+      muduo::Timestamp now(muduo::Timestamp::now());
+      for (size_t i = 0; i < items.size(); ++i)
+      {
+        if (!items[i].valid())
+        {
+          // the rest are stops for the other consumers
+          std::vector<muduo::Timestamp> rest(items.begin() + i + 1, items.end());
+          putMany(queue_, rest, false);
+          running = false;
+          break;
+        }
+        latency_.add(now.microSecondsSinceEpoch() - items[i].microSecondsSinceEpoch());
+      }
     }
   }
 
-  muduo::BlockingQueue<muduo::Timestamp> queue_;
+  Queue* queue_;
+  const int producers_;
+  const int consumers_;
+  const bool batch_;
   muduo::CountDownLatch latch_;
-  boost::ptr_vector<muduo::Thread> threads_;
+  muduo::Histogram latency_;
+  muduo::AtomicInt64 takes_;
 };
 
 int main(int argc, char* argv[])
 {
-  int threads = argc > 1 ? atoi(argv[1]) : 1;
+  int items = argc > 1 ? atoi(argv[1]) : 200000;
+  int capacity = argc > 2 ? atoi(argv[2]) : 1024;
+
+  typedef muduo::BlockingQueue<muduo::Timestamp> Unbounded;
+  typedef muduo::BoundedBlockingQueue<muduo::Timestamp> Bounded;
+  typedef muduo::MpmcQueue<muduo::Timestamp> Mpmc;
 
-  Bench t(threads);
-  t.run(10000);
-  t.joinAll();
+  const int counts[][2] = { { 1, 1 }, { 1, 4 }, { 4, 1 }, { 4, 4 } };
+  for (size_t i = 0; i < sizeof counts / sizeof counts[0]; ++i)
+  {
+    int p = counts[i][0];
+    int c = counts[i][1];
+    Bench<Unbounded>(p, c, capacity, false).run("BlockingQueue", items);
+    Bench<Unbounded>(p, c, capacity, true).run("BlockingQueue takeAll", items);
+    Bench<Bounded>(p, c, capacity, false).run("BoundedBlockingQueue", items);
+    Bench<Mpmc>(p, c, capacity, false).run("MpmcQueue", items);
+    Bench<Mpmc>(p, c, capacity, true).run("MpmcQueue batch", items);
+  }
 }
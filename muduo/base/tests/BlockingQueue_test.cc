@@ -75,8 +75,37 @@ class Test
   boost::ptr_vector<muduo::Thread> threads_;
 };
 
+void testDrain()
+{
+  muduo::BlockingQueue<int> queue;
+  int x = 0;
+  muduo::Timestamp start(muduo::Timestamp::now());
+  assert(!queue.take(&x, 0.05));
+  assert(timeDifference(muduo::Timestamp::now(), start) >= 0.05);
+
+  for (int i = 0; i < 10; ++i)
+  {
+    queue.put(i);
+  }
+  std::deque<int> out;
+  assert(queue.tryTakeUpTo(&out, 3) == 3);
+  assert(out.size() == 3 && out.back() == 2);
+  queue.takeAll(&out);
+  assert(out.size() == 10 && out.back() == 9);
+  assert(queue.size() == 0);
+  assert(!queue.takeAll(&out, 0.01));
+  assert(queue.drainTo(&out) == 0);
+
+  queue.put(10);
+  out.clear();
+  assert(queue.take(&x, 0.01) && x == 10);
+  (void) x;
+  printf("testDrain passed\n");
+}
+
 int main()
 {
+  testDrain();
   printf("pid=%d, tid=%d\n", ::getpid(), muduo::CurrentThread::tid());
   Test t(5);
   t.run(100);
@@ -0,0 +1,174 @@
+#include <muduo/base/InlineFunction.h>
+
+#include <boost/bind.hpp>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+int g_allocs = 0;
+
+void* operator new(size_t size)
+{
+  ++g_allocs;
+  void* p = malloc(size ? size : 1);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) throw()
+{
+  free(p);
+}
+
+int g_live = 0;
+
+template<int kWords>
+class Adder
+{
+ public:
+  explicit Adder(int n)
+    : n_(n)
+  {
+    ++g_live;
+  }
+
+  Adder(const Adder& rhs)
+    : n_(rhs.n_)
+  {
+    ++g_live;
+  }
+
+  ~Adder()
+  {
+    --g_live;
+  }
+
+  int operator()(int x) const { return x + n_; }
+  void set(int n) { n_ = n; }
+
+ private:
+  int n_;
+  void* padding_[kWords];
+};
+
+typedef muduo::InlineFunction<int(int), 4 * sizeof(void*)> Function;
+typedef Adder<1> Small;
+typedef Adder<8> Large;
+
+int twice(int x)
+{
+  return 2 * x;
+}
+
+int sum3(int a, long b, short c)
+{
+  return a + static_cast<int>(b) + c;
+}
+
+struct Counter
+{
+  int calls;
+  void hit(int n) { calls += n; }
+};
+
+void testEmpty()
+{
+  Function f;
+  assert(f.empty());
+  assert(!f);
+
+  int (*null)(int) = NULL;
+  Function g(null);
+  assert(g.empty());
+
+  boost::function<int(int)> none;
+  Function h(none);
+  assert(h.empty());
+
+  Function copy(f);
+  assert(copy.empty());
+  copy = Function(twice);
+  assert(copy && copy(21) == 42);
+  copy = f;
+  assert(copy.empty());
+}
+
+void testInline()
+{
+  int allocs = g_allocs;
+  {
+    Function f = Small(1);
+    assert(g_live == 1);
+    assert(f(1) == 2);
+
+    Function g(f);
+    assert(g_live == 2);
+    assert(g(2) == 3);
+
+    Function h(twice);
+    assert(h(5) == 10);
+    h = g;
+    assert(g_live == 3);
+    assert(h(3) == 4);
+  }
+  assert(g_live == 0);
+  assert(g_allocs == allocs);
+  (void) allocs;
+}
+
+void testHeap()
+{
+  int allocs = g_allocs;
+  {
+    Function f = Large(1);
+    assert(g_allocs == allocs + 1);
+    assert(g_live == 1);
+    assert(f(1) == 2);
+
+    // copies are deep, each owns its callable
+    Function g(f);
+    assert(g_allocs == allocs + 2);
+    assert(g_live == 2);
+
+    Large other(10);
+    g = other;
+    assert(g_live == 3);
+    assert(f(1) == 2);
+    assert(g(1) == 11);
+
+    f = Small(5);
+    assert(g_live == 3);
+    assert(f(1) == 6);
+  }
+  assert(g_live == 0);
+  (void) allocs;
+}
+
+void testArguments()
+{
+  Counter counter = { 0 };
+  muduo::InlineFunction<void(int), 3 * sizeof(void*)> hit =
+      boost::bind(&Counter::hit, &counter, _1);
+  hit(2);
+  hit(3);
+  assert(counter.calls == 5);
+
+  muduo::InlineFunction<int(int, long, short)> add(sum3);
+  assert(add(1, 2, 3) == 6);
+
+  boost::function<int(int, long, short)> bound(sum3);
+  muduo::InlineFunction<int(int, long, short)> wrapped(bound);
+  assert(wrapped(4, 5, 6) == 15);
+}
+
+int main()
+{
+  testEmpty();
+  testInline();
+  testHeap();
+  testArguments();
+  printf("OK\n");
+}
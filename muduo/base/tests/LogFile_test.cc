@@ -18,6 +18,11 @@ int main(int argc, char* argv[])
   char name[256];
   strncpy(name, argv[0], 256);
   g_logFile.reset(new muduo::LogFile(::basename(name), 200*1000));
+  if (argc > 1)
+  {
+    // gzip rolled files, keep the last 3
+    g_logFile->startBackgroundRoll(true, 3);
+  }
 
   
   // ֻҪLoggerΪļɽ־д뵽ļ
@@ -55,6 +55,57 @@ void benchLogStream()
   printf("benchLogStream %f\n", timeDifference(end, start));
 }
 
+// measured values rather than integers, most of them need all the digits
+void benchRealDoubles()
+{
+  char buf[32];
+  Timestamp start(Timestamp::now());
+  for (size_t i = 0; i < N; ++i)
+    snprintf(buf, sizeof buf, "%.12g", 0.5 + (double)(i) * 0.001);
+  Timestamp end(Timestamp::now());
+  printf("benchPrintf %%.12g %f\n", timeDifference(end, start));
+
+  LogStream os;
+  start = Timestamp::now();
+  for (size_t i = 0; i < N; ++i)
+  {
+    os << 0.5 + (double)(i) * 0.001;
+    os.resetBuffer();
+  }
+  end = Timestamp::now();
+  printf("benchLogStream %f\n", timeDifference(end, start));
+
+  start = Timestamp::now();
+  for (size_t i = 0; i < N; ++i)
+    snprintf(buf, sizeof buf, "%.17g", 0.5 + (double)(i) * 0.001);
+  end = Timestamp::now();
+  printf("benchPrintf %%.17g %f\n", timeDifference(end, start));
+
+  start = Timestamp::now();
+  for (size_t i = 0; i < N; ++i)
+  {
+    os << RoundTrip(0.5 + (double)(i) * 0.001);
+    os.resetBuffer();
+  }
+  end = Timestamp::now();
+  printf("benchLogStream RoundTrip %f\n", timeDifference(end, start));
+
+  start = Timestamp::now();
+  for (size_t i = 0; i < N; ++i)
+    snprintf(buf, sizeof buf, "%.3f", 0.5 + (double)(i) * 0.001);
+  end = Timestamp::now();
+  printf("benchPrintf %%.3f %f\n", timeDifference(end, start));
+
+  start = Timestamp::now();
+  for (size_t i = 0; i < N; ++i)
+  {
+    os << Fixed(0.5 + (double)(i) * 0.001, 3);
+    os.resetBuffer();
+  }
+  end = Timestamp::now();
+  printf("benchLogStream Fixed %f\n", timeDifference(end, start));
+}
+
 int main()
 {
   benchPrintf<int>("%d");
@@ -69,6 +120,9 @@ int main()
   benchStringStream<double>();
   benchLogStream<double>();
 
+  puts("real double");
+  benchRealDoubles();
+
   puts("int64_t");
   benchPrintf<int64_t>("%" PRId64);
   benchStringStream<int64_t>();
@@ -1,7 +1,11 @@
 #include <muduo/base/LogStream.h>
 
 #include <limits>
+#include <math.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 //#define BOOST_TEST_MODULE LogStreamTest
 #define BOOST_TEST_MAIN
@@ -10,6 +14,34 @@
 
 using muduo::string;
 
+namespace
+{
+
+uint64_t g_random = 88172645463325252ULL;
+
+// xorshift, the same sequence on every run
+uint64_t nextRandom()
+{
+  g_random ^= g_random << 13;
+  g_random ^= g_random >> 7;
+  g_random ^= g_random << 17;
+  return g_random;
+}
+
+// any finite double, from its bit pattern
+double randomDouble()
+{
+  double d = 0;
+  do
+  {
+    uint64_t bits = nextRandom();
+    memcpy(&d, &bits, sizeof d);
+  } while (d - d != 0);
+  return d;
+}
+
+}
+
 BOOST_AUTO_TEST_CASE(testLogStreamBooleans)
 {
   muduo::LogStream os;
@@ -169,6 +201,162 @@ BOOST_AUTO_TEST_CASE(testLogStreamFloats)
   os.resetBuffer();
 }
 
+BOOST_AUTO_TEST_CASE(testLogStreamIntegersLikePrintf)
+{
+  muduo::LogStream os;
+  const muduo::LogStream::Buffer& buf = os.buffer();
+  char expected[64];
+
+  for (int i = -32768; i <= 65535; ++i)
+  {
+    os << i << ' ' << static_cast<short>(i) << ' ' << static_cast<unsigned short>(i);
+    snprintf(expected, sizeof expected, "%d %hd %hu", i, static_cast<short>(i),
+             static_cast<unsigned short>(i));
+    BOOST_REQUIRE_EQUAL(buf.asString(), string(expected));
+    os.resetBuffer();
+  }
+
+  for (int i = 0; i < 100000; ++i)
+  {
+    uint64_t x = nextRandom() >> (i % 64);
+    os << static_cast<long long>(x) << ' ' << static_cast<unsigned long long>(x);
+    snprintf(expected, sizeof expected, "%lld %llu", static_cast<long long>(x),
+             static_cast<unsigned long long>(x));
+    BOOST_REQUIRE_EQUAL(buf.asString(), string(expected));
+    os.resetBuffer();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testLogStreamFloatsLikePrintf)
+{
+  muduo::LogStream os;
+  const muduo::LogStream::Buffer& buf = os.buffer();
+  char expected[32];
+
+  for (int i = 0; i < 1000000; ++i)
+  {
+    double d = 0;
+    switch (i % 4)
+    {
+      case 0:
+        d = randomDouble();
+        break;
+      case 1:
+        d = static_cast<double>(static_cast<int64_t>(nextRandom())) / 1e15;
+        break;
+      case 2:
+        d = static_cast<double>(nextRandom() % 100000000) * pow(10.0, i % 20 - 12);
+        break;
+      case 3:
+        d = i * 0.001 + 0.5;
+        break;
+    }
+    os << d;
+    snprintf(expected, sizeof expected, "%.12g", d);
+    BOOST_REQUIRE_EQUAL(buf.asString(), string(expected));
+    os.resetBuffer();
+  }
+
+  os << -0.0;
+  BOOST_CHECK_EQUAL(buf.asString(), string("-0"));
+  os.resetBuffer();
+
+  os << 1e12 - 0.5;
+  BOOST_CHECK_EQUAL(buf.asString(), string("1e+12"));
+  os.resetBuffer();
+
+  os << 0.0001;
+  BOOST_CHECK_EQUAL(buf.asString(), string("0.0001"));
+  os.resetBuffer();
+
+  os << 0.00001;
+  BOOST_CHECK_EQUAL(buf.asString(), string("1e-05"));
+  os.resetBuffer();
+}
+
+BOOST_AUTO_TEST_CASE(testLogStreamRoundTrip)
+{
+  muduo::LogStream os;
+  const muduo::LogStream::Buffer& buf = os.buffer();
+
+  const struct
+  {
+    double value;
+    const char* text;
+  } cases[] =
+  {
+    { 0.0, "0" },
+    { -0.0, "-0" },
+    { 1.0, "1" },
+    { 0.1, "0.1" },
+    { 0.1 + 0.2, "0.30000000000000004" },
+    { -123.456, "-123.456" },
+    { 1e16, "10000000000000000" },
+    { 1e17, "1e+17" },
+    { 1e21, "1e+21" },
+    { 0.0001, "0.0001" },
+    { 1e-7, "1e-07" },
+    { 5e-324, "5e-324" },
+    { 1.7976931348623157e308, "1.7976931348623157e+308" },
+    { HUGE_VAL, "inf" },
+  };
+  for (size_t i = 0; i < sizeof cases / sizeof cases[0]; ++i)
+  {
+    os << muduo::RoundTrip(cases[i].value);
+    BOOST_CHECK_EQUAL(buf.asString(), string(cases[i].text));
+    os.resetBuffer();
+  }
+
+  for (int i = 0; i < 300000; ++i)
+  {
+    double d = randomDouble();
+    os << muduo::RoundTrip(d);
+    BOOST_REQUIRE_EQUAL(strtod(buf.asString().c_str(), NULL), d);
+    os.resetBuffer();
+  }
+
+  // every 8th float in [1, 2) reads back as the same double
+  for (float f = 1.0f; f < 2.0f; f += ldexpf(1.0f, -20))
+  {
+    os << muduo::RoundTrip(f);
+    BOOST_REQUIRE_EQUAL(strtod(buf.asString().c_str(), NULL), static_cast<double>(f));
+    os.resetBuffer();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testLogStreamFixed)
+{
+  muduo::LogStream os;
+  const muduo::LogStream::Buffer& buf = os.buffer();
+  char expected[64];
+
+  for (int i = 0; i < 1000000; ++i)
+  {
+    double d = 0;
+    if (i % 2)
+      d = static_cast<double>(static_cast<int64_t>(nextRandom() >> (i % 64))) / 1e6;
+    else
+      d = i * 0.0005 - 100;
+    int precision = i % 10;
+    os << muduo::Fixed(d, precision);
+    snprintf(expected, sizeof expected, "%.*f", precision, d);
+    BOOST_REQUIRE_EQUAL(buf.asString(), string(expected));
+    os.resetBuffer();
+  }
+
+  os << muduo::Fixed(-0.0, 3);
+  BOOST_CHECK_EQUAL(buf.asString(), string("-0.000"));
+  os.resetBuffer();
+
+  os << muduo::Fixed(2.5, 0) << ' ' << muduo::Fixed(0.125, 2);
+  BOOST_CHECK_EQUAL(buf.asString(), string("2 0.12"));
+  os.resetBuffer();
+
+  os << muduo::Fixed(1e300, 2);
+  BOOST_CHECK_EQUAL(buf.asString().size(), 47u);
+  os.resetBuffer();
+}
+
 BOOST_AUTO_TEST_CASE(testLogStreamVoid)
 {
   muduo::LogStream os;
@@ -2,6 +2,7 @@
 #include <muduo/base/LogFile.h>
 #include <muduo/base/ThreadPool.h>
 
+#include <assert.h>
 #include <stdio.h>
 
 int g_total;
@@ -44,6 +45,86 @@ void bench(const char* type)
          type, seconds, g_total, n / seconds, g_total / seconds / (1024 * 1024));
 }
 
+// cost of a call site below the level
+void benchDisabled()
+{
+  int n = 100*1000*1000;
+  muduo::Timestamp start(muduo::Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    LOG_DEBUG << "Hello 0123456789" << i;
+  }
+  double seconds = timeDifference(muduo::Timestamp::now(), start);
+  printf("%12s: %.2f ns per LOG_DEBUG\n", "disabled", seconds * 1e9 / n);
+}
+
+// as made by the macros, with the paths of other files
+muduo::Logger::Site g_httpSite = { "/src/muduo/net/http/HttpServer.cc", muduo::Logger::DEBUG, -1, NULL };
+muduo::Logger::Site g_netSite = { "/src/muduo/net/TcpServer.cc", muduo::Logger::DEBUG, -1, NULL };
+muduo::Logger::Site g_baseSite = { "/src/muduo/base/Thread.cc", muduo::Logger::DEBUG, -1, NULL };
+// seen by a static initializer, maybe before g_logLevel is
+muduo::Logger::Site g_earlySite = { "/src/early/Early.cc", muduo::Logger::DEBUG, -1, NULL };
+bool g_earlyEnabled = muduo::Logger::enabled(&g_earlySite);
+
+bool enabled(muduo::Logger::Site* site)
+{
+  return muduo::Logger::enabled(site);
+}
+
+void testModules()
+{
+  using muduo::Logger;
+  Logger::setLogLevel(Logger::INFO);
+  assert(!enabled(&g_earlySite));
+
+  // sites seen before the first module level follow it
+  assert(!enabled(&g_httpSite) && !enabled(&g_netSite) && !enabled(&g_baseSite));
+  Logger::setModuleLogLevel("net", Logger::DEBUG);
+  assert(enabled(&g_httpSite) && enabled(&g_netSite) && !enabled(&g_baseSite));
+  Logger::setModuleLogLevel("early", Logger::DEBUG);
+  assert(enabled(&g_earlySite));
+
+  // a deeper directory wins over its parent
+  Logger::setModuleLogLevel("http", Logger::WARN);
+  assert(!enabled(&g_httpSite) && enabled(&g_netSite));
+
+  // a file wins over any directory
+  Logger::setModuleLogLevel("HttpServer.cc", Logger::TRACE);
+  Logger::setModuleLogLevel("TcpServer.cc", Logger::ERROR);
+  assert(enabled(&g_httpSite) && !enabled(&g_netSite));
+  assert(Logger::moduleLogLevels() ==
+         "HttpServer.cc TRACE\nTcpServer.cc ERROR\nearly DEBUG\nhttp WARN\nnet DEBUG\n");
+
+  Logger::resetModuleLogLevel("HttpServer.cc");
+  assert(!enabled(&g_httpSite));
+  Logger::resetModuleLogLevel("http");
+  assert(enabled(&g_httpSite));
+  Logger::resetModuleLogLevel("TcpServer.cc");
+  Logger::resetModuleLogLevel("net");
+  Logger::resetModuleLogLevel("early");
+  assert(!enabled(&g_httpSite) && !enabled(&g_netSite) && !enabled(&g_earlySite));
+  assert(Logger::moduleLogLevels().empty());
+
+  // the macros, for this file
+  Logger::setOutput(dummyOutput);
+  g_total = 0;
+  LOG_DEBUG << "off";
+  assert(g_total == 0);
+  Logger::setModuleLogLevel("Logging_test.cc", Logger::DEBUG);
+  LOG_DEBUG << "on";
+  assert(g_total > 0);
+  Logger::resetModuleLogLevel("Logging_test.cc");
+
+  // an else goes with the if in front of the macro
+  g_total = 0;
+  if (g_total != 0)
+    LOG_WARN << "not taken";
+  else
+    LOG_WARN << "taken";
+  assert(g_total > 0);
+  (void) g_earlyEnabled;
+}
+
 void logInThread()
 {
   LOG_INFO << "logInThread";
@@ -73,7 +154,16 @@ int main()
   LOG_INFO << sizeof(muduo::Fmt);
   LOG_INFO << sizeof(muduo::LogStream::Buffer);
 
+  muduo::Logger::setModuleLogLevel("Logging_test.cc", muduo::Logger::TRACE);
+  LOG_TRACE << "trace, on for this file";
+  printf("%s", muduo::Logger::moduleLogLevels().c_str());
+  muduo::Logger::resetModuleLogLevel("Logging_test.cc");
+  LOG_TRACE << "trace, off again";
+
+  testModules();
+
   sleep(1);
+  benchDisabled();
   bench("nop");
 
   char buffer[64*1024];
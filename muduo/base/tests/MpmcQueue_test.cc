@@ -0,0 +1,141 @@
+#include <muduo/base/MpmcQueue.h>
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <assert.h>
+#include <stdio.h>
+
+// A small queue, so that both sides block often.
+class Test
+{
+ public:
+  Test(int producers, int consumers, bool batch)
+    : queue_(8),
+      producers_(producers),
+      consumers_(consumers),
+      batch_(batch)
+  {
+  }
+
+  void run(int times)
+  {
+    boost::ptr_vector<muduo::Thread> consumers;
+    for (int i = 0; i < consumers_; ++i)
+    {
+      consumers.push_back(new muduo::Thread(boost::bind(&Test::consume, this)));
+      consumers.back().start();
+    }
+    boost::ptr_vector<muduo::Thread> producers;
+    for (int i = 0; i < producers_; ++i)
+    {
+      producers.push_back(new muduo::Thread(boost::bind(&Test::produce, this, times)));
+      producers.back().start();
+    }
+    for_each(producers.begin(), producers.end(), boost::bind(&muduo::Thread::join, _1));
+    for (int i = 0; i < consumers_; ++i)
+    {
+      queue_.put(-1);
+    }
+    for_each(consumers.begin(), consumers.end(), boost::bind(&muduo::Thread::join, _1));
+
+    int64_t expected = static_cast<int64_t>(times) * (times - 1) / 2 * producers_;
+    printf("producers %d consumers %d batch %d: taken %lld sum %lld expected %lld\n",
+           producers_, consumers_, batch_,
+           static_cast<long long>(taken_.get()),
+           static_cast<long long>(sum_.get()),
+           static_cast<long long>(expected));
+    assert(taken_.get() == static_cast<int64_t>(times) * producers_);
+    assert(sum_.get() == expected);
+    assert(queue_.size() == 0);
+  }
+
+ private:
+  void produce(int times)
+  {
+    if (batch_)
+    {
+      std::vector<int> items;
+      for (int i = 0; i < times; ++i)
+      {
+        items.push_back(i);
+        if (items.size() == 5 || i == times - 1)
+        {
+          queue_.put(&items[0], items.size());
+          items.clear();
+        }
+      }
+    }
+    else
+    {
+      for (int i = 0; i < times; ++i)
+      {
+        queue_.put(i);
+      }
+    }
+  }
+
+  void consume()
+  {
+    bool running = true;
+    std::vector<int> items;
+    while (running)
+    {
+      items.clear();
+      if (batch_)
+      {
+        queue_.takeAll(&items);
+      }
+      else
+      {
+        items.push_back(queue_.take());
+      }
+      for (size_t i = 0; i < items.size(); ++i)
+      {
+        if (items[i] < 0)
+        {
+          // what came after the stop belongs to the other consumers
+          for (size_t j = i + 1; j < items.size(); ++j)
+          {
+            queue_.put(items[j]);
+          }
+          running = false;
+          break;
+        }
+        taken_.increment();
+        sum_.add(items[i]);
+      }
+    }
+  }
+
+  muduo::MpmcQueue<int> queue_;
+  const int producers_;
+  const int consumers_;
+  const bool batch_;
+  muduo::AtomicInt64 taken_;
+  muduo::AtomicInt64 sum_;
+};
+
+int main()
+{
+  muduo::MpmcQueue<int> q(5);
+  assert(q.capacity() == 8);
+  int x = 0;
+  assert(!q.tryTake(&x));
+  for (int i = 0; i < 8; ++i)
+  {
+    assert(q.tryPut(i));
+  }
+  assert(!q.tryPut(8));
+  assert(q.tryTake(&x) && x == 0);
+  assert(q.size() == 7);
+
+  for (int batch = 0; batch < 2; ++batch)
+  {
+    Test(1, 1, batch).run(100000);
+    Test(1, 4, batch).run(100000);
+    Test(4, 1, batch).run(100000);
+    Test(4, 4, batch).run(100000);
+  }
+}
@@ -0,0 +1,120 @@
+// ThreadPool vs WorkStealingThreadPool, 1 to N threads.
+//
+// flat:  the main thread submits all tasks.
+// split: each task splits in two until depth 0, so tasks come from workers.
+//
+// usage: threadpool_bench [max threads] [tasks] [work per task]
+
+#include <muduo/base/ThreadPool.h>
+#include <muduo/base/WorkStealingThreadPool.h>
+#include <muduo/base/Atomic.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+int g_work = 1000;
+volatile int g_sink;
+
+struct Done
+{
+  explicit Done(int64_t n)
+    : latch(1)
+  {
+    pending.getAndSet(n);
+  }
+
+  void finishOne()
+  {
+    if (pending.decrementAndGet() == 0)
+      latch.countDown();
+  }
+
+  AtomicInt64 pending;
+  CountDownLatch latch;
+};
+
+void work(Done* done)
+{
+  int x = 0;
+  for (int i = 0; i < g_work; ++i)
+  {
+    x += i * i;
+  }
+  g_sink = x;
+  done->finishOne();
+}
+
+template<typename Pool>
+void split(Pool* pool, int depth, Done* done)
+{
+  if (depth == 0)
+  {
+    work(done);
+  }
+  else
+  {
+    pool->run(boost::bind(&split<Pool>, pool, depth - 1, done));
+    pool->run(boost::bind(&split<Pool>, pool, depth - 1, done));
+  }
+}
+
+template<typename Pool>
+double flatBench(int numThreads, int numTasks)
+{
+  Pool pool("flat");
+  pool.start(numThreads);
+  Done done(numTasks);
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < numTasks; ++i)
+  {
+    pool.run(boost::bind(work, &done));
+  }
+  done.latch.wait();
+  double seconds = timeDifference(Timestamp::now(), start);
+  pool.stop();
+  return seconds;
+}
+
+template<typename Pool>
+double splitBench(int numThreads, int depth)
+{
+  Pool pool("split");
+  pool.start(numThreads);
+  Done done(1 << depth);
+  Timestamp start(Timestamp::now());
+  pool.run(boost::bind(&split<Pool>, &pool, depth, &done));
+  done.latch.wait();
+  double seconds = timeDifference(Timestamp::now(), start);
+  pool.stop();
+  return seconds;
+}
+
+int main(int argc, char* argv[])
+{
+  int cpus = static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN));
+  int maxThreads = argc > 1 ? atoi(argv[1]) : (cpus > 8 ? cpus : 8);
+  int numTasks = argc > 2 ? atoi(argv[2]) : 200000;
+  g_work = argc > 3 ? atoi(argv[3]) : 1000;
+  int depth = 0;
+  while ((2 << depth) <= numTasks)
+    ++depth;
+
+  printf("%d cpus, %d tasks, work %d\n", cpus, numTasks, g_work);
+  printf("threads  flat ThreadPool  flat WorkStealing  split ThreadPool  split WorkStealing\n");
+  for (int threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    double flat1 = flatBench<ThreadPool>(threads, numTasks);
+    double flat2 = flatBench<WorkStealingThreadPool>(threads, numTasks);
+    double split1 = splitBench<ThreadPool>(threads, depth);
+    double split2 = splitBench<WorkStealingThreadPool>(threads, depth);
+    printf("%7d  %14.3fs  %16.3fs  %15.3fs  %17.3fs\n",
+           threads, flat1, flat2, split1, split2);
+  }
+}
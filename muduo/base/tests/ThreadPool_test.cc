@@ -1,9 +1,11 @@
 #include <muduo/base/ThreadPool.h>
 #include <muduo/base/CountDownLatch.h>
 #include <muduo/base/CurrentThread.h>
+#include <muduo/base/Thread.h>
 
 #include <boost/bind.hpp>
 #include <stdio.h>
+#include <unistd.h>
 
 void print()
 {
@@ -15,8 +17,121 @@ void printString(const std::string& str)
   printf("tid=%d, str=%s\n", muduo::CurrentThread::tid(), str.c_str());
 }
 
+void blockOn(muduo::CountDownLatch* started, muduo::CountDownLatch* gate)
+{
+  started->countDown();
+  gate->wait();
+}
+
+void count(muduo::AtomicInt32* ran)
+{
+  ran->increment();
+}
+
+void onReject(int* rejected, const muduo::ThreadPool::Task&)
+{
+  ++*rejected;
+}
+
+void openGate(muduo::CountDownLatch* gate)
+{
+  usleep(100 * 1000);
+  gate->countDown();
+}
+
+// one thread held busy, room for 2 in the queue, 5 more tasks
+void testBounded(muduo::ThreadPool::RejectPolicy policy,
+                 int expectRan, int expectRejected)
+{
+  muduo::ThreadPool pool("BoundedThreadPool");
+  pool.setMaxQueueSize(2);
+  pool.setRejectPolicy(policy);
+  int rejected = 0;
+  pool.setRejectCallback(boost::bind(onReject, &rejected, _1));
+  pool.start(1);
+
+  muduo::CountDownLatch started(1);
+  muduo::CountDownLatch gate(1);
+  pool.run(boost::bind(blockOn, &started, &gate));
+  started.wait();
+
+  muduo::Thread opener(boost::bind(openGate, &gate));
+  if (policy == muduo::ThreadPool::kBlock)
+  {
+    opener.start();
+  }
+  muduo::AtomicInt32 ran;
+  for (int i = 0; i < 5; ++i)
+  {
+    pool.run(boost::bind(count, &ran));
+  }
+  assert(pool.queueSize() <= 2);
+  if (policy != muduo::ThreadPool::kBlock)
+  {
+    gate.countDown();
+  }
+  while (ran.get() < expectRan)
+  {
+    usleep(1000);
+  }
+  usleep(10 * 1000);
+  printf("policy %d: ran %d, rejected %d, numRejected %lld\n%s",
+         policy, ran.get(), rejected,
+         static_cast<long long>(pool.numRejected()),
+         pool.queueTime().toString().c_str());
+  assert(ran.get() == expectRan);
+  assert(rejected == expectRejected);
+  pool.stop();
+  if (opener.started())
+  {
+    opener.join();
+  }
+}
+
+void runOne(muduo::ThreadPool* pool, muduo::AtomicInt32* ran)
+{
+  pool->run(boost::bind(count, ran));
+}
+
+// a caller blocked on a full queue is rejected by stop()
+void testStopWhileBlocked()
+{
+  muduo::ThreadPool pool("StoppedThreadPool");
+  pool.setMaxQueueSize(1);
+  int rejected = 0;
+  pool.setRejectCallback(boost::bind(onReject, &rejected, _1));
+  pool.start(1);
+
+  muduo::CountDownLatch started(1);
+  muduo::CountDownLatch gate(1);
+  pool.run(boost::bind(blockOn, &started, &gate));
+  started.wait();
+  muduo::AtomicInt32 ran;
+  pool.run(boost::bind(count, &ran));
+
+  muduo::Thread caller(boost::bind(runOne, &pool, &ran));
+  caller.start();
+  usleep(50 * 1000);
+  assert(pool.queueSize() == 1);
+
+  muduo::Thread stopper(boost::bind(&muduo::ThreadPool::stop, &pool));
+  stopper.start();
+  caller.join();
+  assert(rejected == 1);
+  assert(pool.numRejected() == 1);
+  assert(pool.queueSize() == 1);
+  gate.countDown();
+  stopper.join();
+}
+
 int main()
 {
+  testBounded(muduo::ThreadPool::kBlock, 5, 0);
+  testBounded(muduo::ThreadPool::kCallerRuns, 5, 0);
+  testBounded(muduo::ThreadPool::kReject, 2, 3);
+  testBounded(muduo::ThreadPool::kDropOldest, 2, 3);
+  testStopWhileBlocked();
+
   muduo::ThreadPool pool("MainThreadPool");
   pool.start(5);
 
@@ -19,7 +19,10 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr)
     acceptSocket_(sockets::createNonblockingOrDie()),
     acceptChannel_(loop, acceptSocket_.fd()),
     listenning_(false),
-    idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
+    idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+    acceptBudget_(1),
+    paused_(false),
+    stopped_(false)
 {
   assert(idleFd_ >= 0);
   acceptSocket_.setReuseAddr(true);     // õַظ
@@ -28,6 +31,21 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr)
       boost::bind(&Acceptor::handleRead, this));
 }
 
+Acceptor::Acceptor(EventLoop* loop, int listenfd)
+  : loop_(loop),
+    acceptSocket_(listenfd),
+    acceptChannel_(loop, acceptSocket_.fd()),
+    listenning_(false),
+    idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+    acceptBudget_(1),
+    paused_(false),
+    stopped_(false)
+{
+  assert(idleFd_ >= 0);
+  acceptChannel_.setReadCallback(
+      boost::bind(&Acceptor::handleRead, this));
+}
+
 Acceptor::~Acceptor()
 {
   acceptChannel_.disableAll();
@@ -40,14 +58,62 @@ void Acceptor::listen()
   loop_->assertInLoopThread();
   listenning_ = true;
   acceptSocket_.listen();
-  acceptChannel_.enableReading();
+  if (!paused_)
+  {
+    acceptChannel_.enableReading();
+  }
+}
+
+void Acceptor::pause()
+{
+  loop_->assertInLoopThread();
+  if (!paused_)
+  {
+    paused_ = true;
+    if (listenning_)
+    {
+      acceptChannel_.disableReading();
+    }
+  }
+}
+
+void Acceptor::resume()
+{
+  loop_->assertInLoopThread();
+  if (paused_ && !stopped_)
+  {
+    paused_ = false;
+    if (listenning_)
+    {
+      acceptChannel_.enableReading();
+    }
+  }
+}
+
+void Acceptor::stop()
+{
+  loop_->assertInLoopThread();
+  pause();
+  stopped_ = true;
 }
 
 void Acceptor::handleRead()
 {
   loop_->assertInLoopThread();
+  // the callback may pause() us in the middle of a batch
+  for (int i = 0; i < acceptBudget_ && !paused_; ++i)
+  {
+    if (!acceptOne())
+    {
+      break;
+    }
+  }
+}
+
+// returns false when there is nothing more to accept for now
+bool Acceptor::acceptOne()
+{
   InetAddress peerAddr(0);
-  //FIXME loop until no more
   int connfd = acceptSocket_.accept(&peerAddr); // socketacceptȴͻ˵
   if (connfd >= 0)
   {
@@ -61,6 +127,7 @@ void Acceptor::handleRead()
     {
       sockets::close(connfd);
     }
+    return true;
   }
   else
   {
@@ -72,6 +139,7 @@ void Acceptor::handleRead()
       ::close(idleFd_);
       idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC); // ǵƽ׼һеļ
     }
+    return false;
   }
 }
 
@@ -26,16 +26,47 @@ class Acceptor : boost::noncopyable
                                 const InetAddress&)> NewConnectionCallback;
 
   Acceptor(EventLoop* loop, const InetAddress& listenAddr);
+  /// Takes over @c listenfd, bound and maybe listening already,
+  /// e.g. inherited from another process.
+  Acceptor(EventLoop* loop, int listenfd);
   ~Acceptor();
 
+  int fd() const { return acceptSocket_.fd(); }
+
   void setNewConnectionCallback(const NewConnectionCallback& cb)
   { newConnectionCallback_ = cb; }
 
   bool listenning() const { return listenning_; }
   void listen();
 
+  /// See Socket::setDeferAccept().
+  void setDeferAccept(int seconds)
+  { acceptSocket_.setDeferAccept(seconds); }
+
+  /// See Socket::setFastOpen().
+  void setFastOpen(int queueLength)
+  { acceptSocket_.setFastOpen(queueLength); }
+
+  /// Connections accepted per readiness event at most, default 1.
+  void setAcceptBudget(int n)
+  { acceptBudget_ = n; }
+
+  /// Stops watching the listen socket, pending connections wait in
+  /// the backlog until resume().
+  /// Must be called in loop thread.
+  void pause();
+  void resume();
+  bool paused() const { return paused_; }
+
+  /// Stops watching the listen socket for good, resume() does nothing.
+  /// The socket stays open, pending connections are left to other
+  /// processes sharing it.
+  /// Must be called in loop thread.
+  void stop();
+
  private:
   void handleRead();
+  bool acceptOne();
 
   EventLoop* loop_;       // Ӧ¼ѭ
   Socket acceptSocket_;
@@ -43,6 +74,9 @@ class Acceptor : boost::noncopyable
   NewConnectionCallback newConnectionCallback_; // ӵĻص
   bool listenning_;      // ͷż
   int idleFd_;
+  int acceptBudget_;
+  bool paused_;
+  bool stopped_;
 };
 
 }
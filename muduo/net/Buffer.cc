@@ -3,14 +3,163 @@
 #include <errno.h>
 #include <sys/uio.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#define MUDUO_BUFFER_SIMD 1
+
+#if defined(__AVX2__)
+typedef __m256i Vec;
+const size_t kVecWidth = 32;
+
+inline Vec load(const char* p)
+{ return _mm256_loadu_si256(reinterpret_cast<const Vec*>(p)); }
+
+inline Vec splat(char c)
+{ return _mm256_set1_epi8(c); }
+
+// bit i set if byte i of a equals byte i of b
+inline uint32_t matches(Vec a, Vec b)
+{ return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b))); }
+#else
+typedef __m128i Vec;
+const size_t kVecWidth = 16;
+
+inline Vec load(const char* p)
+{ return _mm_loadu_si128(reinterpret_cast<const Vec*>(p)); }
+
+inline Vec splat(char c)
+{ return _mm_set1_epi8(c); }
+
+inline uint32_t matches(Vec a, Vec b)
+{ return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))); }
+#endif
+
+// above this, findAnyOf() uses a lookup table
+const size_t kMaxVecDelims = 8;
+#endif
+
+}
+
 const char Buffer::kCRLF[] = "\r\n";
 
 const size_t Buffer::kCheapPrepend;
 const size_t Buffer::kInitialSize;
 
+const size_t ReadScratch::kMinSize;
+const size_t ReadScratch::kMaxSize;
+
+const char* detail::findByte(const char* begin, const char* end, char c)
+{
+  const char* p = begin;
+#ifdef MUDUO_BUFFER_SIMD
+  const Vec needle = splat(c);
+  for (; p + kVecWidth <= end; p += kVecWidth)
+  {
+    uint32_t mask = matches(load(p), needle);
+    if (mask)
+    {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; p < end; ++p)
+  {
+    if (*p == c)
+    {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+const char* detail::findCRLF(const char* begin, const char* end)
+{
+  const char* p = begin;
+#ifdef MUDUO_BUFFER_SIMD
+  const Vec cr = splat('\r');
+  const Vec lf = splat('\n');
+  // the second load is one byte ahead, so '\r' at the last lane is covered
+  for (; p + kVecWidth + 1 <= end; p += kVecWidth)
+  {
+    uint32_t mask = matches(load(p), cr) & matches(load(p + 1), lf);
+    if (mask)
+    {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; p + 1 < end; ++p)
+  {
+    if (p[0] == '\r' && p[1] == '\n')
+    {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+const char* detail::findAnyOf(const char* begin, const char* end,
+                              const char* delims, size_t ndelims)
+{
+  if (ndelims == 0)
+  {
+    return NULL;
+  }
+  if (ndelims == 1)
+  {
+    return findByte(begin, end, delims[0]);
+  }
+
+  const char* p = begin;
+#ifdef MUDUO_BUFFER_SIMD
+  if (ndelims <= kMaxVecDelims)
+  {
+    Vec needles[kMaxVecDelims];
+    for (size_t i = 0; i < ndelims; ++i)
+    {
+      needles[i] = splat(delims[i]);
+    }
+    for (; p + kVecWidth <= end; p += kVecWidth)
+    {
+      const Vec data = load(p);
+      uint32_t mask = 0;
+      for (size_t i = 0; i < ndelims; ++i)
+      {
+        mask |= matches(data, needles[i]);
+      }
+      if (mask)
+      {
+        return p + __builtin_ctz(mask);
+      }
+    }
+  }
+#endif
+  bool table[256] = { false };
+  for (size_t i = 0; i < ndelims; ++i)
+  {
+    table[static_cast<unsigned char>(delims[i])] = true;
+  }
+  for (; p < end; ++p)
+  {
+    if (table[static_cast<unsigned char>(*p)])
+    {
+      return p;
+    }
+  }
+  return NULL;
+}
+
 // fdȡݵbuffer
 ssize_t Buffer::readFd(int fd, int* savedErrno)
 {
@@ -46,3 +195,122 @@ ssize_t Buffer::readFd(int fd, int* savedErrno)
   return n;
 }
 
+
+ssize_t Buffer::readFd(int fd, int* savedErrno, ReadScratch* scratch)
+{
+  Buffer* spill = scratch->prepare();
+  if (readableBytes() == 0)
+  {
+    retrieveAll();
+  }
+
+  ssize_t total = 0;
+  size_t copied = 0;
+  struct iovec vec[2];
+  // at most two reads, the second one only if the first filled both iovecs
+  for (int i = 0; i < 2; ++i)
+  {
+    const size_t writable = writableBytes();
+    const size_t spillable = spill->writableBytes();
+    vec[0].iov_base = beginWrite();
+    vec[0].iov_len = writable;
+    vec[1].iov_base = spill->beginWrite();
+    vec[1].iov_len = spillable;
+    const ssize_t n = sockets::readv(fd, vec, 2);
+    if (n < 0)
+    {
+      // data from the first read is delivered, the error shows up next time
+      if (total == 0)
+      {
+        *savedErrno = errno;
+        total = n;
+      }
+      break;
+    }
+    total += n;
+    if (implicit_cast<size_t>(n) <= writable)
+    {
+      writerIndex_ += n;
+    }
+    else
+    {
+      writerIndex_ = buffer_.size();
+      append(spill->beginWrite(), n - writable);
+      copied += n - writable;
+    }
+    if (n == 0 || implicit_cast<size_t>(n) < writable + spillable)
+    {
+      break;
+    }
+  }
+  if (total > 0)
+  {
+    scratch->record(implicit_cast<size_t>(total), copied);
+  }
+  return total;
+}
+
+ReadScratch::ReadScratch()
+  : buffer_(0),
+    lendable_(0),
+    lent_(false),
+    averageRead_(0),
+    targetSize_(64*1024),
+    bytesRead_(0),
+    bytesCopied_(0)
+{
+}
+
+Buffer* ReadScratch::prepare()
+{
+  fit(&buffer_, targetSize_);
+  return &buffer_;
+}
+
+void ReadScratch::lend(Buffer* buf)
+{
+  assert(!lent_);
+  assert(buf->readableBytes() == 0);
+  fit(&lendable_, targetSize_);
+  lendable_.swap(*buf);
+  lent_ = true;
+}
+
+void ReadScratch::giveBack(Buffer* buf)
+{
+  assert(lent_);
+  lendable_.swap(*buf);
+  if (lendable_.readableBytes() > 0)
+  {
+    buf->append(lendable_.peek(), lendable_.readableBytes());
+  }
+  lendable_.retrieveAll();
+  lent_ = false;
+}
+
+// grows or shrinks, never per read
+void ReadScratch::fit(Buffer* buf, size_t size)
+{
+  buf->retrieveAll();
+  if (buf->writableBytes() < size)
+  {
+    // vector::resize() zero-fills, so the new pages are touched here
+    // rather than by the kernel in the middle of readv(2).
+    buf->ensureWritableBytes(size);
+  }
+  else if (buf->writableBytes() > 4*size)
+  {
+    Buffer fresh(size);
+    buf->swap(fresh);
+  }
+}
+
+void ReadScratch::record(size_t n, size_t copied)
+{
+  bytesRead_ += n;
+  bytesCopied_ += copied;
+  // moving average with weight 1/8
+  averageRead_ = averageRead_ - averageRead_/8 + n/8;
+  size_t target = std::min(std::max(2*averageRead_, kMinSize), kMaxSize);
+  targetSize_ = (target + 4095) & ~static_cast<size_t>(4095);  // whole pages
+}
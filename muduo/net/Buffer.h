@@ -7,6 +7,8 @@
 
 #include <muduo/net/Endian.h>
 
+#include <boost/noncopyable.hpp>
+
 #include <algorithm>
 #include <vector>
 
@@ -19,6 +21,18 @@ namespace muduo
 namespace net
 {
 
+class ReadScratch;
+
+namespace detail
+{
+// Vectorized with AVX2 or SSE2 when the compiler targets them,
+// return NULL if not found.
+const char* findByte(const char* begin, const char* end, char c);
+const char* findCRLF(const char* begin, const char* end);
+const char* findAnyOf(const char* begin, const char* end,
+                      const char* delims, size_t ndelims);
+}
+
 /// A buffer class modeled after org.jboss.netty.buffer.ChannelBuffer
 ///
 /// @code
@@ -35,13 +49,17 @@ class Buffer : public muduo::copyable
   static const size_t kCheapPrepend = 8;
   static const size_t kInitialSize = 1024;
 
-  Buffer()
-    : buffer_(kCheapPrepend + kInitialSize),
+  /// @c initialSize may be 0, then nothing but the prepend area
+  /// is allocated until the first append.
+  explicit Buffer(size_t initialSize = kInitialSize)
+    : buffer_(kCheapPrepend + initialSize),
       readerIndex_(kCheapPrepend),
-      writerIndex_(kCheapPrepend)
+      writerIndex_(kCheapPrepend),
+      crlfScanned_(0),
+      eolScanned_(0)
   {
     assert(readableBytes() == 0);
-    assert(writableBytes() == kInitialSize);
+    assert(writableBytes() == initialSize);
     assert(prependableBytes() == kCheapPrepend);
   }
 
@@ -52,6 +70,8 @@ class Buffer : public muduo::copyable
     buffer_.swap(rhs.buffer_); // index 
     std::swap(readerIndex_, rhs.readerIndex_);
     std::swap(writerIndex_, rhs.writerIndex_);
+    std::swap(crlfScanned_, rhs.crlfScanned_);
+    std::swap(eolScanned_, rhs.eolScanned_);
   }
 
   size_t readableBytes() const
@@ -66,18 +86,60 @@ class Buffer : public muduo::copyable
   const char* peek() const
   { return begin() + readerIndex_; }
 
+  /// Searches resume where the last unsuccessful one stopped,
+  /// so a line arriving in pieces is scanned only once.
   const char* findCRLF() const // find /r /n
   {
-    const char* crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF+2);
-    return crlf == beginWrite() ? NULL : crlf;
+    return findCRLF(peek());
   }
 
   const char* findCRLF(const char* start) const
   {
     assert(peek() <= start);
     assert(start <= beginWrite());
-    const char* crlf = std::search(start, beginWrite(), kCRLF, kCRLF+2);
-    return crlf == beginWrite() ? NULL : crlf;
+    const char* scanned = peek() + crlfScanned_;
+    if (start > scanned)
+    {
+      return detail::findCRLF(start, beginWrite());
+    }
+    const char* crlf = detail::findCRLF(scanned, beginWrite());
+    // a trailing '\r' may be completed by the next read
+    crlfScanned_ = crlf ? crlf - peek()
+                        : std::max(readableBytes(), implicit_cast<size_t>(1)) - 1;
+    return crlf;
+  }
+
+  /// Same as findCRLF(), for a single '\n'.
+  const char* findEOL() const
+  {
+    return findEOL(peek());
+  }
+
+  const char* findEOL(const char* start) const
+  {
+    assert(peek() <= start);
+    assert(start <= beginWrite());
+    const char* scanned = peek() + eolScanned_;
+    if (start > scanned)
+    {
+      return detail::findByte(start, beginWrite(), '\n');
+    }
+    const char* eol = detail::findByte(scanned, beginWrite(), '\n');
+    eolScanned_ = eol ? eol - peek() : readableBytes();
+    return eol;
+  }
+
+  /// Finds the first byte that is one of @c delims.
+  const char* findAnyOf(const StringPiece& delims) const
+  {
+    return findAnyOf(delims, peek());
+  }
+
+  const char* findAnyOf(const StringPiece& delims, const char* start) const
+  {
+    assert(peek() <= start);
+    assert(start <= beginWrite());
+    return detail::findAnyOf(start, beginWrite(), delims.data(), delims.size());
   }
 
   // retrieve returns void, to prevent
@@ -89,6 +151,8 @@ class Buffer : public muduo::copyable
     if (len < readableBytes())
     {
       readerIndex_ += len;
+      crlfScanned_ = crlfScanned_ > len ? crlfScanned_ - len : 0;
+      eolScanned_ = eolScanned_ > len ? eolScanned_ - len : 0;
     }
     else
     {
@@ -122,6 +186,8 @@ class Buffer : public muduo::copyable
   {
     readerIndex_ = kCheapPrepend;
     writerIndex_ = kCheapPrepend;
+    crlfScanned_ = 0;
+    eolScanned_ = 0;
   }
 
   string retrieveAllAsString()
@@ -275,6 +341,8 @@ class Buffer : public muduo::copyable
     readerIndex_ -= len;
     const char* d = static_cast<const char*>(data);
     std::copy(d, d+len, begin()+readerIndex_);
+    crlfScanned_ = 0;
+    eolScanned_ = 0;
   }
 
   void shrink(size_t reserve)
@@ -286,12 +354,34 @@ class Buffer : public muduo::copyable
     swap(other);
   }
 
+  /// Reallocates to hold exactly readableBytes(),
+  /// an empty buffer keeps nothing but the prepend area.
+  void shrinkToFit()
+  {
+    Buffer other(readableBytes());
+    other.append(toStringPiece());
+    swap(other);
+  }
+
+  /// Bytes allocated, including the prepend area.
+  size_t internalCapacity() const
+  {
+    return buffer_.capacity();
+  }
+
   /// Read data directly into buffer.
   ///
   /// It may implement with readv(2)
   /// @return result of read(2), @c errno is saved
   ssize_t readFd(int fd, int* savedErrno);
 
+  /// Read data directly into buffer, spilling into @c scratch
+  /// instead of a 64k stack array.
+  ///
+  /// If a read fills both iovecs, a second readv(2) is issued.
+  /// @return bytes read, or result of readv(2), @c errno is saved
+  ssize_t readFd(int fd, int* savedErrno, ReadScratch* scratch);
+
  private:
 
   char* begin()
@@ -325,10 +415,62 @@ class Buffer : public muduo::copyable
   std::vector<char> buffer_; // ڲʹ vector ʵ
   size_t readerIndex_;
   size_t writerIndex_;
+  // readable bytes known to contain no CRLF / EOL, relative to readerIndex_
+  mutable size_t crlfScanned_;
+  mutable size_t eolScanned_;
 
   static const char kCRLF[]; // /r/n
 };
 
+/// Read area of an EventLoop.
+///
+/// Holds the spill area of Buffer::readFd(), and storage lent to an empty
+/// input buffer for one read and its callback, so a bulk read is copied
+/// only once, by the kernel.  Both are sized from recent reads and keep
+/// their storage across reads.  It is value-initialized when it grows, so
+/// its pages are already faulted in when a read lands there.
+/// Not thread safe.
+class ReadScratch : boost::noncopyable
+{
+ public:
+  static const size_t kMinSize = 16*1024;
+  static const size_t kMaxSize = 1024*1024;
+
+  ReadScratch();
+
+  /// Returns an empty buffer with at least targetSize() writable bytes.
+  Buffer* prepare();
+
+  /// Swaps the storage of the empty @c buf with the lendable one,
+  /// at least targetSize() writable bytes.  One at a time.
+  void lend(Buffer* buf);
+
+  /// Takes the storage back from @c buf, which keeps what is unread
+  /// in its own storage.
+  void giveBack(Buffer* buf);
+
+  /// Records a completed read of @c n bytes, @c copied of them
+  /// went through the scratch.
+  void record(size_t n, size_t copied);
+
+  size_t averageRead() const { return averageRead_; }
+  size_t targetSize() const { return targetSize_; }
+
+  int64_t bytesRead() const { return bytesRead_; }
+  int64_t bytesCopied() const { return bytesCopied_; }
+
+ private:
+  static void fit(Buffer* buf, size_t size);
+
+  Buffer buffer_;
+  Buffer lendable_;
+  bool lent_;
+  size_t averageRead_;
+  size_t targetSize_;
+  int64_t bytesRead_;
+  int64_t bytesCopied_;
+};
+
 }
 }
 
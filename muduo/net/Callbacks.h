@@ -4,6 +4,7 @@
 #include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <muduo/base/InlineFunction.h>
 #include <muduo/base/Timestamp.h>
 
 namespace muduo
@@ -32,15 +33,19 @@ class Buffer;
 class TcpConnection;
 typedef boost::shared_ptr<TcpConnection> TcpConnectionPtr;
 typedef boost::function<void()> TimerCallback;
-typedef boost::function<void (const TcpConnectionPtr&)> ConnectionCallback;
-typedef boost::function<void (const TcpConnectionPtr&)> CloseCallback;
-typedef boost::function<void (const TcpConnectionPtr&)> WriteCompleteCallback;
-typedef boost::function<void (const TcpConnectionPtr&, size_t)> HighWaterMarkCallback;
+
+// Three words in place, as much as boost::function keeps, enough for a
+// bind of a member function and this.  Called once per message or event.
+const size_t kCallbackInlineSize = 3 * sizeof(void*);
+typedef InlineFunction<void (const TcpConnectionPtr&), kCallbackInlineSize> ConnectionCallback;
+typedef InlineFunction<void (const TcpConnectionPtr&), kCallbackInlineSize> CloseCallback;
+typedef InlineFunction<void (const TcpConnectionPtr&), kCallbackInlineSize> WriteCompleteCallback;
+typedef InlineFunction<void (const TcpConnectionPtr&, size_t), kCallbackInlineSize> HighWaterMarkCallback;
 
 // the data has been read to (buf, len)
-typedef boost::function<void (const TcpConnectionPtr&,
-                              Buffer*,
-                              Timestamp)> MessageCallback;
+typedef InlineFunction<void (const TcpConnectionPtr&,
+                             Buffer*,
+                             Timestamp), kCallbackInlineSize> MessageCallback;
 
 void defaultConnectionCallback(const TcpConnectionPtr& conn);
 void defaultMessageCallback(const TcpConnectionPtr& conn,
@@ -11,11 +11,11 @@
 #ifndef MUDUO_NET_CHANNEL_H
 #define MUDUO_NET_CHANNEL_H
 
-#include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 
+#include <muduo/base/InlineFunction.h>
 #include <muduo/base/Timestamp.h>
 
 namespace muduo
@@ -30,8 +30,9 @@ class EventLoop;
 class Channel : boost::noncopyable // ע߻صIO¼
 {
  public:
-  typedef boost::function<void()> EventCallback;              // ¼ص
-  typedef boost::function<void(Timestamp)> ReadEventCallback; // ¼ص
+  // bind(&Class::handleXxx, this) fits inline
+  typedef InlineFunction<void(), 3 * sizeof(void*)> EventCallback;              // ¼ص
+  typedef InlineFunction<void(Timestamp), 3 * sizeof(void*)> ReadEventCallback; // ¼ص
 
   Channel(EventLoop* loop, int fd); // һchannelֻһEventLoop һEventLoopchannel
   ~Channel();
@@ -64,7 +65,7 @@ class Channel : boost::noncopyable // 
 
   void enableReading() { events_ |= kReadEvent; update(); } // λһЩ״̬
   
-  // void disableReading() { events_ &= ~kReadEvent; update(); }
+  void disableReading() { events_ &= ~kReadEvent; update(); }
   void enableWriting() { events_ |= kWriteEvent; update(); }
   
   void disableWriting() { events_ &= ~kWriteEvent; update(); }
@@ -1,4 +1,5 @@
 #include <muduo/net/Connector.h>
+#include <muduo/base/Atomic.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/Channel.h>
 #include <muduo/net/EventLoop.h>
@@ -6,18 +7,78 @@
 
 #include <boost/bind.hpp>
 #include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef TCP_FASTOPEN_CONNECT
+#define TCP_FASTOPEN_CONNECT 30  // since Linux 4.11
+#endif
 
 using namespace muduo;
 using namespace muduo::net;
 
 const int Connector::kMaxRetryDelayMs;
 
+namespace
+{
+
+AtomicInt32 g_maxConnecting;
+AtomicInt32 g_connecting;
+AtomicInt64 g_attempts;
+AtomicInt64 g_timeouts;
+
+bool acquireConnectSlot()
+{
+  int limit = g_maxConnecting.get();
+  if (g_connecting.incrementAndGet() > limit && limit > 0)
+  {
+    g_connecting.decrement();
+    return false;
+  }
+  return true;
+}
+
+void releaseConnectSlot()
+{
+  g_connecting.decrement();
+}
+
+}
+
+void Connector::setMaxConcurrentConnects(int n)
+{
+  g_maxConnecting.getAndSet(n);
+}
+
+int Connector::concurrentConnects()
+{
+  return g_connecting.get();
+}
+
+int64_t Connector::connectAttempts()
+{
+  return g_attempts.get();
+}
+
+int64_t Connector::connectTimeouts()
+{
+  return g_timeouts.get();
+}
+
 Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
   : loop_(loop),
     serverAddr_(serverAddr),
     connect_(false),
     state_(kDisconnected),
-    retryDelayMs_(kInitRetryDelayMs)
+    retryDelayMs_(kInitRetryDelayMs),
+    fastOpen_(false),
+    backoff_(kExponential),
+    connectTimeout_(0),
+    seed_(static_cast<unsigned int>(
+        reinterpret_cast<uintptr_t>(this)
+        ^ Timestamp::now().microSecondsSinceEpoch()))
 {
   LOG_DEBUG << "ctor[" << this << "]";
 }
@@ -51,7 +112,7 @@ void Connector::startInLoop()
 void Connector::stop()
 {
   connect_ = false;
-  loop_->runInLoop(boost::bind(&Connector::stopInLoop, this)); // FIXME: unsafe
+  loop_->runInLoop(boost::bind(&Connector::stopInLoop, shared_from_this()));
   // FIXME: cancel timer
 }
 
@@ -71,7 +132,27 @@ void Connector::stopInLoop()
 
 void Connector::connect()
 {
+  if (!acquireConnectSlot())
+  {
+    // too many connects in flight, come back shortly, don't back off
+    int delayMs = randomMs(kDeferDelayMs / 2, kDeferDelayMs * 3 / 2);
+    LOG_DEBUG << "Connector::connect - " << concurrentConnects()
+              << " connects in progress, defer " << delayMs << " ms";
+    loop_->runAfter(delayMs/1000.0,
+                    boost::bind(&Connector::startInLoop, shared_from_this()));
+    return;
+  }
+
   int sockfd = sockets::createNonblockingOrDie(); // socket
+  if (fastOpen_)
+  {
+    int optval = 1;
+    if (::setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT,
+                     &optval, sizeof optval) < 0)
+    {
+      LOG_SYSERR << "Connector::connect - TCP_FASTOPEN_CONNECT";
+    }
+  }
   int ret = sockets::connect(sockfd, serverAddr_.getSockAddrInet()); // socketsconnect()
   int savedErrno = (ret == 0) ? 0 : errno;
   switch (savedErrno)
@@ -88,6 +169,7 @@ void Connector::connect()
     case EADDRNOTAVAIL:
     case ECONNREFUSED:
     case ENETUNREACH:
+      releaseConnectSlot();
       retry(sockfd);
       break;
 
@@ -99,11 +181,13 @@ void Connector::connect()
     case EFAULT:
     case ENOTSOCK:
       LOG_SYSERR << "connect error in Connector::startInLoop " << savedErrno;
+      releaseConnectSlot();
       sockets::close(sockfd);
       break;
 
     default:
       LOG_SYSERR << "Unexpected error in Connector::startInLoop " << savedErrno;
+      releaseConnectSlot();
       sockets::close(sockfd);
       // connectErrorCallback_();
       break;
@@ -122,6 +206,7 @@ void Connector::restart()
 // ӳɹĶд
 void Connector::connecting(int sockfd)
 {
+  g_attempts.increment();
   setState(kConnecting);
   assert(!channel_);
 
@@ -136,17 +221,30 @@ void Connector::connecting(int sockfd)
   // as channel_ is not managed by shared_ptr
   // עд¼POLLOUT
   channel_->enableWriting();
+
+  if (connectTimeout_ > 0)
+  {
+    timeoutTimer_ = loop_->runAfter(connectTimeout_,
+        boost::bind(&Connector::handleTimeout, shared_from_this()));
+  }
 }
 
 int Connector::removeAndResetChannel()
 {
+  // the attempt is over, one way or another
+  releaseConnectSlot();
+  if (connectTimeout_ > 0)
+  {
+    loop_->cancel(timeoutTimer_);
+  }
   channel_->disableAll();
   channel_->remove();
   int sockfd = channel_->fd();
   // Can't reset channel_ here, because we are inside Channel::handleEvent
   // channel ΪڵhandleEvent
   // 뵽IO߳еִ
-  loop_->queueInLoop(boost::bind(&Connector::resetChannel, this)); // FIXME: unsafe
+  // keeps us alive, the owner may let go before this runs
+  loop_->queueInLoop(boost::bind(&Connector::resetChannel, shared_from_this()));
   return sockfd;
 }
 
@@ -216,13 +314,13 @@ void Connector::retry(int sockfd)
   setState(kDisconnected);
   if (connect_)
   {
+    int delayMs = nextRetryDelayMs();
     LOG_INFO << "Connector::retry - Retry connecting to " << serverAddr_.toIpPort()
-             << " in " << retryDelayMs_ << " milliseconds. ";
+             << " in " << delayMs << " milliseconds. ";
 
 	// עһʱ 
-    loop_->runAfter(retryDelayMs_/1000.0,
+    loop_->runAfter(delayMs/1000.0,
                     boost::bind(&Connector::startInLoop, shared_from_this()));
-    retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
   }
   else
   {
@@ -230,3 +328,47 @@ void Connector::retry(int sockfd)
   }
 }
 
+void Connector::handleTimeout()
+{
+  loop_->assertInLoopThread();
+  if (state_ == kConnecting)
+  {
+    LOG_WARN << "Connector::handleTimeout - connecting to "
+             << serverAddr_.toIpPort() << " timed out after "
+             << connectTimeout_ << " seconds";
+    g_timeouts.increment();
+    int sockfd = removeAndResetChannel();
+    retry(sockfd);
+  }
+}
+
+int Connector::nextRetryDelayMs()
+{
+  int delayMs = retryDelayMs_;
+  switch (backoff_)
+  {
+    case kExponential:
+      retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
+      break;
+
+    case kFullJitter:
+      delayMs = randomMs(0, retryDelayMs_);
+      retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
+      break;
+
+    case kDecorrelatedJitter:
+      // retryDelayMs_ is the previous delay here
+      delayMs = std::min(randomMs(kInitRetryDelayMs, retryDelayMs_ * 3),
+                         kMaxRetryDelayMs);
+      retryDelayMs_ = delayMs;
+      break;
+  }
+  return delayMs;
+}
+
+int Connector::randomMs(int low, int high)
+{
+  assert(low <= high);
+  return low + ::rand_r(&seed_) % (high - low + 1);
+}
+
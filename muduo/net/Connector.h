@@ -2,6 +2,7 @@
 #define MUDUO_NET_CONNECTOR_H
 
 #include <muduo/net/InetAddress.h>
+#include <muduo/net/TimerId.h>
 
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/function.hpp>
@@ -23,6 +24,14 @@ class Connector : boost::noncopyable,
  public:
   typedef boost::function<void (int sockfd)> NewConnectionCallback;
 
+  /// How the delay between retries grows.
+  enum BackoffPolicy
+  {
+    kExponential,        // 0.5s 1s 2s ... 30s, same for every client
+    kFullJitter,         // uniform in [0, exponential delay]
+    kDecorrelatedJitter  // uniform in [0.5s, 3 * previous delay], capped
+  };
+
   Connector(EventLoop* loop, const InetAddress& serverAddr);
   ~Connector();
 
@@ -35,10 +44,41 @@ class Connector : boost::noncopyable,
 
   const InetAddress& serverAddress() const { return serverAddr_; }
 
+  /// Must be called in loop thread, before start() or restart().
+  void setServerAddress(const InetAddress& serverAddr)
+  { serverAddr_ = serverAddr; }
+
+  /// TCP_FASTOPEN_CONNECT, the connection looks established at once and
+  /// the first bytes sent go out in the SYN when the server's cookie is
+  /// cached.  Must be set before start().
+  void setFastOpen(bool on) { fastOpen_ = on; }
+
+  /// Default kExponential.  Must be set before start().
+  void setBackoffPolicy(BackoffPolicy policy) { backoff_ = policy; }
+
+  /// Gives up a connect attempt still in progress after this many
+  /// seconds and retries, 0 to wait for the kernel.  Default 0.
+  /// Must be set before start().
+  void setConnectTimeout(double seconds) { connectTimeout_ = seconds; }
+
+  /// Caps connect attempts in progress across all Connectors of the
+  /// process, 0 for no limit.  Attempts over the limit wait a short
+  /// jittered delay and try again, without counting as a failure.
+  /// Thread safe.
+  static void setMaxConcurrentConnects(int n);
+  static int concurrentConnects();
+
+  /// Connect attempts that went in progress, and those of them given up
+  /// by the connect timeout, across all Connectors of the process.
+  /// Thread safe.
+  static int64_t connectAttempts();
+  static int64_t connectTimeouts();
+
  private:
   enum States { kDisconnected, kConnecting, kConnected };
   static const int kMaxRetryDelayMs = 30*1000;
   static const int kInitRetryDelayMs = 500;
+  static const int kDeferDelayMs = 20;
 
   void setState(States s) { state_ = s; }
   void startInLoop();
@@ -47,9 +87,12 @@ class Connector : boost::noncopyable,
   void connecting(int sockfd);
   void handleWrite();
   void handleError();
+  void handleTimeout();
   void retry(int sockfd);
   int removeAndResetChannel();
   void resetChannel();
+  int nextRetryDelayMs();
+  int randomMs(int low, int high);
 
   EventLoop* loop_; 
   InetAddress serverAddr_;
@@ -58,6 +101,11 @@ class Connector : boost::noncopyable,
   boost::scoped_ptr<Channel> channel_;
   NewConnectionCallback newConnectionCallback_;
   int retryDelayMs_;
+  bool fastOpen_;
+  BackoffPolicy backoff_;
+  double connectTimeout_;
+  TimerId timeoutTimer_;
+  unsigned int seed_;
 };
 
 }
@@ -11,10 +11,13 @@
 #include <muduo/base/Logging.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/base/Singleton.h>
+#include <muduo/net/Buffer.h>
 #include <muduo/net/Channel.h>
 #include <muduo/net/Poller.h>
+#include <muduo/net/Resolver.h>
 #include <muduo/net/SocketsOps.h>
 #include <muduo/net/TimerQueue.h>
+#include <muduo/net/TimingWheel.h>
 
 #include <boost/bind.hpp>
 
@@ -73,7 +76,8 @@ EventLoop::EventLoop()
     timerQueue_(new TimerQueue(this)),
     wakeupFd_(createEventfd()),
     wakeupChannel_(new Channel(this, wakeupFd_)), // ﴴһeventfdͨ
-    currentActiveChannel_(NULL)
+    currentActiveChannel_(NULL),
+    readScratch_(new ReadScratch)
 {
   LOG_TRACE << "EventLoop created " << this << " in thread " << threadId_;
   if (t_loopInThisThread) // ǰ߳ѾEventLoop LOG_FATAL
@@ -199,6 +203,26 @@ void EventLoop::cancel(TimerId timerId)
   return timerQueue_->cancel(timerId);
 }
 
+TimingWheel* EventLoop::timingWheel()
+{
+  assertInLoopThread();
+  if (!timingWheel_)
+  {
+    timingWheel_.reset(new TimingWheel(this, 1.0));
+  }
+  return timingWheel_.get();
+}
+
+Resolver* EventLoop::resolver()
+{
+  assertInLoopThread();
+  if (!resolver_)
+  {
+    resolver_.reset(new Resolver(this));
+  }
+  return resolver_.get();
+}
+
 void EventLoop::updateChannel(Channel* channel)
 {
   assert(channel->ownerLoop() == this);
@@ -257,18 +281,19 @@ void EventLoop::handleRead()
 // IO߳̿ѭ ޷IO¼
 void EventLoop::doPendingFunctors()
 {
-  std::vector<Functor> functors;
   callingPendingFunctors_ = true; // ڵü㺯
 
   {
   MutexLockGuard lock(mutex_);
-  functors.swap(pendingFunctors_); // pendFunctors_ӵfunctors ִ ʱ浽˱ĵط
+  callingFunctors_.swap(pendingFunctors_); // pendFunctors_ӵfunctors ִ ʱ浽˱ĵط
   }
 
-  for (size_t i = 0; i < functors.size(); ++i)
+  for (size_t i = 0; i < callingFunctors_.size(); ++i)
   {
-    functors[i]();
+    callingFunctors_[i]();
   }
+  // both vectors keep their capacity, queueInLoop() seldom reallocates
+  callingFunctors_.clear();
   callingPendingFunctors_ = false;
 }
 
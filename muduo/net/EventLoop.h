@@ -17,6 +17,7 @@
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <muduo/base/InlineFunction.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/base/Thread.h>
 #include <muduo/base/Timestamp.h>
@@ -30,7 +31,10 @@ namespace net
 
 class Channel;
 class Poller;
+class ReadScratch;
+class Resolver;
 class TimerQueue;
+class TimingWheel;
 
 ///
 /// Reactor, at most one per thread.
@@ -39,7 +43,8 @@ class TimerQueue;
 class EventLoop : boost::noncopyable
 {
  public:
-  typedef boost::function<void()> Functor;
+  /// Keeps a boost::bind of up to a few words without allocating.
+  typedef InlineFunction<void()> Functor;
 
   EventLoop();
   ~EventLoop();  // force out-line dtor, for scoped_ptr members.
@@ -113,6 +118,20 @@ class EventLoop : boost::noncopyable
   // bool callingPendingFunctors() const { return callingPendingFunctors_; }
   bool eventHandling() const { return eventHandling_; }
 
+  /// Read area of this loop, see TcpConnection::setLeanBuffers()
+  /// and TcpConnection::setScratchReads().
+  /// Must be called in loop thread.
+  ReadScratch* readScratch() { return readScratch_.get(); }
+
+  /// One-second wheel for idle timeouts of this loop, created on first use.
+  /// Must be called in loop thread.
+  TimingWheel* timingWheel();
+
+  /// DNS stub resolver of this loop, created on first use,
+  /// see Resolver::setDefaultNameservers().
+  /// Must be called in loop thread.
+  Resolver* resolver();
+
   static EventLoop* getEventLoopOfCurrentThread();
 
  private:
@@ -143,8 +162,12 @@ class EventLoop : boost::noncopyable
   boost::scoped_ptr<Channel> wakeupChannel_; // eventfd对应的数据通道
   ChannelList activeChannels_;               // 事件通道
   Channel* currentActiveChannel_;            // 正在处理的活动通道
+  boost::scoped_ptr<ReadScratch> readScratch_;
+  boost::scoped_ptr<TimingWheel> timingWheel_;
+  boost::scoped_ptr<Resolver> resolver_;
   MutexLock mutex_;
   std::vector<Functor> pendingFunctors_; // @BuardedBy mutex_ 执行一些计算任务
+  std::vector<Functor> callingFunctors_; // loop thread only, keeps its capacity
 };
 
 }
@@ -0,0 +1,747 @@
+#include <muduo/net/Resolver.h>
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Singleton.h>
+#include <muduo/base/ThreadLocal.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/Channel.h>
+#include <muduo/net/Endian.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/SocketsOps.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const uint16_t kTypeA = 1;
+const uint16_t kTypeCNAME = 5;
+const uint16_t kTypeSOA = 6;
+const uint16_t kClassIN = 1;
+const int kRcodeNXDomain = 3;
+const uint32_t kMaxTtl = 24*3600;
+const uint32_t kDefaultNegativeTtl = 30;
+const size_t kMaxPacketSize = 1500;
+
+//
+// cache shared by all loops
+//
+
+struct CacheEntry
+{
+  uint32_t ip;  // network endian
+  bool found;
+  Timestamp expiration;
+};
+
+typedef std::map<string, CacheEntry> CacheMap;
+typedef boost::shared_ptr<const CacheMap> CacheMapPtr;
+
+// Copy-on-write map.  Each thread keeps the snapshot it saw last together
+// with its version, and only takes the lock when the version moved on.
+class DnsCache : boost::noncopyable
+{
+ public:
+  DnsCache()
+    : map_(new CacheMap)
+  {
+  }
+
+  bool get(const string& name, Timestamp now, CacheEntry* entry)
+  {
+    Snapshot& local = local_.value();
+    if (local.version != version_.get())
+    {
+      MutexLockGuard lock(mutex_);
+      local.map = map_;
+      local.version = version_.get();
+    }
+    CacheMap::const_iterator it = local.map->find(name);
+    if (it != local.map->end() && now < it->second.expiration)
+    {
+      *entry = it->second;
+      return true;
+    }
+    return false;
+  }
+
+  void put(const string& name, const CacheEntry& entry)
+  {
+    Timestamp now(Timestamp::now());
+    boost::shared_ptr<CacheMap> newMap(new CacheMap);
+    MutexLockGuard lock(mutex_);
+    // drop what expired while copying
+    for (CacheMap::const_iterator it = map_->begin(); it != map_->end(); ++it)
+    {
+      if (now < it->second.expiration)
+      {
+        newMap->insert(newMap->end(), *it);
+      }
+    }
+    (*newMap)[name] = entry;
+    map_ = newMap;
+    version_.increment();
+  }
+
+ private:
+  struct Snapshot
+  {
+    Snapshot() : version(-1) { }
+
+    int64_t version;
+    CacheMapPtr map;
+  };
+
+  MutexLock mutex_;
+  CacheMapPtr map_;  // @GuardedBy mutex_
+  AtomicInt64 version_;
+  ThreadLocal<Snapshot> local_;
+};
+
+MutexLock g_nameserversMutex;
+bool g_nameserversSet = false;  // @GuardedBy g_nameserversMutex
+std::vector<InetAddress> g_nameservers;  // @GuardedBy g_nameserversMutex
+
+//
+// wire format, RFC 1035
+//
+
+void appendUInt16(string* out, uint16_t x)
+{
+  out->push_back(static_cast<char>(x >> 8));
+  out->push_back(static_cast<char>(x & 0xFF));
+}
+
+bool encodeQuery(const string& name, uint16_t id, string* out)
+{
+  out->clear();
+  appendUInt16(out, id);
+  appendUInt16(out, 0x0100);  // RD
+  appendUInt16(out, 1);  // QDCOUNT
+  appendUInt16(out, 0);
+  appendUInt16(out, 0);
+  appendUInt16(out, 0);
+
+  size_t start = 0;
+  while (start < name.size())
+  {
+    size_t dot = name.find('.', start);
+    if (dot == string::npos)
+    {
+      dot = name.size();
+    }
+    size_t len = dot - start;
+    if (len == 0 || len > 63)
+    {
+      return false;
+    }
+    out->push_back(static_cast<char>(len));
+    out->append(name, start, len);
+    start = dot + 1;
+  }
+  out->push_back('\0');
+  if (out->size() - 12 > 255)
+  {
+    return false;
+  }
+  appendUInt16(out, kTypeA);
+  appendUInt16(out, kClassIN);
+  return true;
+}
+
+class PacketReader
+{
+ public:
+  PacketReader(const char* data, size_t len)
+    : data_(reinterpret_cast<const uint8_t*>(data)),
+      len_(len),
+      pos_(0),
+      ok_(true)
+  {
+  }
+
+  bool ok() const { return ok_; }
+
+  uint16_t readUInt16()
+  {
+    if (!require(2))
+      return 0;
+    uint16_t x = static_cast<uint16_t>((data_[pos_] << 8) | data_[pos_+1]);
+    pos_ += 2;
+    return x;
+  }
+
+  uint32_t readUInt32()
+  {
+    uint32_t high = readUInt16();
+    uint32_t low = readUInt16();
+    return (high << 16) | low;
+  }
+
+  void read(void* out, size_t n)
+  {
+    if (require(n))
+    {
+      ::memcpy(out, data_ + pos_, n);
+      pos_ += n;
+    }
+  }
+
+  void skip(size_t n)
+  {
+    if (require(n))
+      pos_ += n;
+  }
+
+  // Reads a possibly compressed name as "a.b.c", lower case.
+  string readName()
+  {
+    string name;
+    size_t pos = pos_;
+    bool jumped = false;
+    int jumps = 0;
+    while (ok_)
+    {
+      if (pos >= len_)
+      {
+        ok_ = false;
+        break;
+      }
+      uint8_t len = data_[pos];
+      if ((len & 0xC0) == 0xC0)
+      {
+        if (pos + 1 >= len_ || ++jumps > 16)
+        {
+          ok_ = false;
+          break;
+        }
+        if (!jumped)
+        {
+          pos_ = pos + 2;
+          jumped = true;
+        }
+        pos = ((len & 0x3F) << 8) | data_[pos+1];
+      }
+      else if (len == 0)
+      {
+        if (!jumped)
+        {
+          pos_ = pos + 1;
+        }
+        break;
+      }
+      else if ((len & 0xC0) == 0 && pos + 1 + len <= len_)
+      {
+        if (!name.empty())
+        {
+          name.push_back('.');
+        }
+        for (size_t i = 0; i < len; ++i)
+        {
+          name.push_back(static_cast<char>(::tolower(data_[pos + 1 + i])));
+        }
+        pos += 1 + len;
+      }
+      else
+      {
+        ok_ = false;
+      }
+    }
+    return name;
+  }
+
+ private:
+  bool require(size_t n)
+  {
+    if (pos_ + n > len_)
+    {
+      ok_ = false;
+    }
+    return ok_;
+  }
+
+  const uint8_t* data_;
+  size_t len_;
+  size_t pos_;
+  bool ok_;
+};
+
+enum ParseResult
+{
+  kMalformed,      // ignore, keep waiting
+  kFound,
+  kNotFound,       // NXDOMAIN or NODATA
+  kServerFailure   // try the next nameserver
+};
+
+ParseResult parseResponse(const char* data, size_t len, const string& name,
+                          uint32_t* ip, uint32_t* ttl)
+{
+  PacketReader reader(data, len);
+  reader.readUInt16();  // id, checked by the caller
+  uint16_t flags = reader.readUInt16();
+  uint16_t qdcount = reader.readUInt16();
+  uint16_t ancount = reader.readUInt16();
+  uint16_t nscount = reader.readUInt16();
+  reader.readUInt16();  // ARCOUNT
+  if (!reader.ok() || !(flags & 0x8000) || qdcount != 1)
+  {
+    return kMalformed;
+  }
+  if (reader.readName() != name
+      || reader.readUInt16() != kTypeA
+      || reader.readUInt16() != kClassIN
+      || !reader.ok())
+  {
+    return kMalformed;
+  }
+
+  int rcode = flags & 0x0F;
+  if (flags & 0x0200)
+  {
+    LOG_WARN << "Resolver - truncated answer for " << name;
+    return kServerFailure;
+  }
+  if (rcode != 0 && rcode != kRcodeNXDomain)
+  {
+    return kServerFailure;
+  }
+
+  bool found = false;
+  uint32_t minTtl = kMaxTtl;
+  for (uint16_t i = 0; i < ancount && reader.ok(); ++i)
+  {
+    reader.readName();
+    uint16_t type = reader.readUInt16();
+    uint16_t klass = reader.readUInt16();
+    uint32_t rrTtl = reader.readUInt32();
+    uint16_t rdlength = reader.readUInt16();
+    if (rcode == 0 && klass == kClassIN && type == kTypeA && rdlength == 4
+        && !found)
+    {
+      reader.read(ip, sizeof *ip);  // stays in network byte order
+      found = true;
+    }
+    else
+    {
+      reader.skip(rdlength);
+    }
+    if (type == kTypeA || type == kTypeCNAME)
+    {
+      minTtl = std::min(minTtl, rrTtl);
+    }
+  }
+
+  if (found)
+  {
+    *ttl = minTtl;
+    return reader.ok() ? kFound : kMalformed;
+  }
+
+  // negative answer, RFC 2308: min(SOA TTL, SOA MINIMUM)
+  uint32_t negativeTtl = kDefaultNegativeTtl;
+  for (uint16_t i = 0; i < nscount && reader.ok(); ++i)
+  {
+    reader.readName();
+    uint16_t type = reader.readUInt16();
+    reader.readUInt16();
+    uint32_t rrTtl = reader.readUInt32();
+    uint16_t rdlength = reader.readUInt16();
+    if (type == kTypeSOA)
+    {
+      reader.readName();  // MNAME
+      reader.readName();  // RNAME
+      reader.skip(16);    // SERIAL REFRESH RETRY EXPIRE
+      uint32_t minimum = reader.readUInt32();
+      negativeTtl = std::min(rrTtl, minimum);
+      break;
+    }
+    reader.skip(rdlength);
+  }
+  if (!reader.ok())
+  {
+    return kMalformed;
+  }
+  *ttl = std::min(negativeTtl, kMaxTtl);
+  return kNotFound;
+}
+
+InetAddress makeAddress(uint32_t ipNetEndian)
+{
+  struct sockaddr_in addr;
+  bzero(&addr, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = ipNetEndian;
+  return InetAddress(addr);
+}
+
+// Query ids are all an off-path spoofer has to guess besides the port,
+// so they don't come from a PRNG seeded with the time.
+uint16_t randomId()
+{
+  uint16_t id = 0;
+#ifdef SYS_getrandom
+  if (::syscall(SYS_getrandom, &id, sizeof id, 0) == static_cast<long>(sizeof id))
+  {
+    return id;
+  }
+#endif
+  int fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+  if (fd >= 0)
+  {
+    ssize_t n = ::read(fd, &id, sizeof id);
+    ::close(fd);
+    if (n == static_cast<ssize_t>(sizeof id))
+    {
+      return id;
+    }
+  }
+  LOG_SYSFATAL << "Resolver - no random source";
+  return id;
+}
+
+void closeChannel(const boost::shared_ptr<Channel>& channel)
+{
+  sockets::close(channel->fd());
+}
+
+string normalize(const StringPiece& hostname)
+{
+  string name;
+  name.reserve(hostname.size());
+  for (int i = 0; i < hostname.size(); ++i)
+  {
+    name.push_back(static_cast<char>(::tolower(hostname[i])));
+  }
+  if (!name.empty() && name[name.size()-1] == '.')
+  {
+    name.resize(name.size()-1);
+  }
+  return name;
+}
+
+}
+
+Resolver::Resolver(EventLoop* loop)
+  : loop_(CHECK_NOTNULL(loop)),
+    nameservers_(defaultNameservers()),
+    timeout_(5.0),
+    attempts_(2)
+{
+}
+
+Resolver::Resolver(EventLoop* loop, const std::vector<InetAddress>& nameservers)
+  : loop_(CHECK_NOTNULL(loop)),
+    nameservers_(nameservers),
+    timeout_(5.0),
+    attempts_(2)
+{
+  assert(!nameservers_.empty());
+}
+
+Resolver::~Resolver()
+{
+  loop_->assertInLoopThread();
+  for (std::map<string, QueryPtr>::iterator it = queries_.begin();
+       it != queries_.end(); ++it)
+  {
+    const QueryPtr& query = it->second;
+    loop_->cancel(query->timer);
+    if (query->channel)
+    {
+      query->channel->disableAll();
+      query->channel->remove();
+      sockets::close(query->channel->fd());
+    }
+  }
+}
+
+void Resolver::resolve(const StringPiece& hostname, const Callback& cb)
+{
+  if (loop_->isInLoopThread())
+  {
+    resolveInLoop(hostname.as_string(), cb);
+  }
+  else
+  {
+    loop_->queueInLoop(
+        boost::bind(&Resolver::resolveInLoop, this, hostname.as_string(), cb));  // FIXME: unsafe
+  }
+}
+
+void Resolver::resolveInLoop(const string& hostname, const Callback& cb)
+{
+  loop_->assertInLoopThread();
+  struct in_addr literal;
+  if (::inet_pton(AF_INET, hostname.c_str(), &literal) == 1)
+  {
+    cb(true, makeAddress(literal.s_addr));
+    return;
+  }
+
+  string name(normalize(hostname));
+  CacheEntry entry;
+  if (Singleton<DnsCache>::instance().get(name, Timestamp::now(), &entry))
+  {
+    cb(entry.found, makeAddress(entry.ip));
+    return;
+  }
+
+  std::map<string, QueryPtr>::iterator it = queries_.find(name);
+  if (it != queries_.end())
+  {
+    it->second->callbacks.push_back(cb);
+    return;
+  }
+
+  QueryPtr query(new Query);
+  query->name = name;
+  query->id = 0;
+  query->tries = 0;
+  query->callbacks.push_back(cb);
+  string packet;
+  if (!encodeQuery(name, 0, &packet))
+  {
+    LOG_ERROR << "Resolver::resolve - bad hostname " << hostname;
+    cb(false, makeAddress(0));
+    return;
+  }
+  queries_[name] = query;
+  send(query);
+}
+
+const InetAddress& Resolver::serverOf(const Query& query) const
+{
+  return nameservers_[static_cast<size_t>(query.tries) % nameservers_.size()];
+}
+
+void Resolver::send(const QueryPtr& query)
+{
+  uint16_t id;
+  do
+  {
+    id = randomId();
+  } while (queryIds_.find(id) != queryIds_.end());
+  query->id = id;
+  queryIds_[id] = query;
+
+  // the kernel picks a new ephemeral port for each socket
+  closeSocket(query);
+  int sockfd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+  if (sockfd < 0)
+  {
+    // counts as a timeout
+    LOG_SYSERR << "Resolver::send - socket";
+  }
+  else
+  {
+    query->channel.reset(new Channel(loop_, sockfd));
+    query->channel->setReadCallback(boost::bind(&Resolver::handleRead, this, sockfd));
+    query->channel->enableReading();
+
+    string packet;
+    encodeQuery(query->name, id, &packet);
+    const struct sockaddr_in& server = serverOf(*query).getSockAddrInet();
+    ssize_t n = ::sendto(sockfd, packet.data(), packet.size(), 0,
+                         static_cast<const struct sockaddr*>(implicit_cast<const void*>(&server)),
+                         sizeof server);
+    if (n != static_cast<ssize_t>(packet.size()))
+    {
+      LOG_SYSERR << "Resolver::send - to " << serverOf(*query).toIpPort();
+    }
+  }
+  query->timer = loop_->runAfter(timeout_,
+      boost::bind(&Resolver::onTimeout, this, query->name, id));
+}
+
+void Resolver::closeSocket(const QueryPtr& query)
+{
+  if (query->channel)
+  {
+    // may be inside its own handleEvent(), close and destroy it later
+    query->channel->disableAll();
+    query->channel->remove();
+    loop_->queueInLoop(boost::bind(closeChannel, query->channel));
+    query->channel.reset();
+  }
+}
+
+void Resolver::handleRead(int sockfd)
+{
+  loop_->assertInLoopThread();
+  char buf[kMaxPacketSize];
+  while (true)
+  {
+    struct sockaddr_in from;
+    socklen_t fromLen = sizeof from;
+    ssize_t n = ::recvfrom(sockfd, buf, sizeof buf, 0,
+                           static_cast<struct sockaddr*>(implicit_cast<void*>(&from)),
+                           &fromLen);
+    if (n < 0)
+    {
+      if (errno != EAGAIN && errno != EINTR)
+      {
+        LOG_SYSERR << "Resolver::handleRead";
+      }
+      break;
+    }
+    if (n < 12)
+    {
+      continue;
+    }
+
+    uint16_t id = static_cast<uint16_t>((static_cast<uint8_t>(buf[0]) << 8)
+                                        | static_cast<uint8_t>(buf[1]));
+    std::map<uint16_t, QueryPtr>::iterator it = queryIds_.find(id);
+    if (it == queryIds_.end())
+    {
+      continue;
+    }
+    QueryPtr query(it->second);
+    if (!query->channel || query->channel->fd() != sockfd)
+    {
+      continue;
+    }
+    const struct sockaddr_in& server = serverOf(*query).getSockAddrInet();
+    if (from.sin_addr.s_addr != server.sin_addr.s_addr
+        || from.sin_port != server.sin_port)
+    {
+      LOG_WARN << "Resolver::handleRead - answer from unexpected "
+               << InetAddress(from).toIpPort();
+      continue;
+    }
+
+    uint32_t ip = 0;
+    uint32_t ttl = 0;
+    ParseResult result =
+        parseResponse(buf, static_cast<size_t>(n), query->name, &ip, &ttl);
+    switch (result)
+    {
+      case kFound:
+      case kNotFound:
+      {
+        CacheEntry entry;
+        entry.ip = ip;
+        entry.found = (result == kFound);
+        entry.expiration = addTime(Timestamp::now(), ttl);
+        if (ttl > 0)
+        {
+          Singleton<DnsCache>::instance().put(query->name, entry);
+        }
+        finish(query, entry.found, ip);
+        return;
+      }
+      case kServerFailure:
+        loop_->cancel(query->timer);
+        queryIds_.erase(query->id);
+        retryOrFail(query);
+        return;
+      case kMalformed:
+        LOG_WARN << "Resolver::handleRead - malformed answer for " << query->name;
+        break;
+    }
+  }
+}
+
+void Resolver::onTimeout(const string& name, uint16_t id)
+{
+  std::map<uint16_t, QueryPtr>::iterator it = queryIds_.find(id);
+  if (it != queryIds_.end() && it->second->name == name)
+  {
+    QueryPtr query(it->second);
+    LOG_WARN << "Resolver - " << serverOf(*query).toIpPort()
+             << " timed out for " << name;
+    queryIds_.erase(it);
+    retryOrFail(query);
+  }
+}
+
+void Resolver::retryOrFail(const QueryPtr& query)
+{
+  ++query->tries;
+  if (static_cast<size_t>(query->tries) < attempts_ * nameservers_.size())
+  {
+    send(query);
+  }
+  else
+  {
+    LOG_ERROR << "Resolver - no answer for " << query->name;
+    finish(query, false, 0);
+  }
+}
+
+void Resolver::finish(const QueryPtr& query, bool found, uint32_t ipNetEndian)
+{
+  loop_->cancel(query->timer);
+  closeSocket(query);
+  queryIds_.erase(query->id);
+  queries_.erase(query->name);
+  InetAddress addr(makeAddress(ipNetEndian));
+  for (size_t i = 0; i < query->callbacks.size(); ++i)
+  {
+    query->callbacks[i](found, addr);
+  }
+}
+
+std::vector<InetAddress> Resolver::defaultNameservers()
+{
+  MutexLockGuard lock(g_nameserversMutex);
+  if (!g_nameserversSet)
+  {
+    g_nameservers = parseResolvConf("/etc/resolv.conf");
+    g_nameserversSet = true;
+  }
+  return g_nameservers;
+}
+
+void Resolver::setDefaultNameservers(const std::vector<InetAddress>& nameservers)
+{
+  assert(!nameservers.empty());
+  MutexLockGuard lock(g_nameserversMutex);
+  g_nameservers = nameservers;
+  g_nameserversSet = true;
+}
+
+std::vector<InetAddress> Resolver::parseResolvConf(const char* path)
+{
+  std::vector<InetAddress> nameservers;
+  FILE* fp = ::fopen(path, "re");
+  if (fp)
+  {
+    char line[256];
+    char ip[64];
+    while (::fgets(line, sizeof line, fp))
+    {
+      struct in_addr addr;
+      if (::sscanf(line, " nameserver %63s", ip) == 1
+          && ::inet_pton(AF_INET, ip, &addr) == 1)
+      {
+        nameservers.push_back(InetAddress(ip, 53));
+      }
+    }
+    ::fclose(fp);
+  }
+  if (nameservers.empty())
+  {
+    nameservers.push_back(InetAddress("127.0.0.1", 53));
+  }
+  return nameservers;
+}
@@ -0,0 +1,105 @@
+#ifndef MUDUO_NET_RESOLVER_H
+#define MUDUO_NET_RESOLVER_H
+
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TimerId.h>
+
+#include <map>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class Channel;
+class EventLoop;
+
+///
+/// Asynchronous IPv4 stub resolver.
+///
+/// Sends A queries over UDP to the nameservers of /etc/resolv.conf and
+/// moves on to the next one on timeout or SERVFAIL.  Answers are cached
+/// for their TTL, NXDOMAIN and NODATA for the SOA minimum, in a cache
+/// shared by all loops of the process.  A cache lookup takes no lock
+/// unless the cache changed since the thread last looked.
+///
+/// Every attempt goes out from a socket of its own, so from a fresh
+/// source port, with a query id from getrandom().
+///
+/// Truncated answers are not retried over TCP.
+///
+class Resolver : boost::noncopyable
+{
+ public:
+  /// found is false for NXDOMAIN, NODATA and when every nameserver timed
+  /// out.  addr has port 0.
+  typedef boost::function<void (bool found, const InetAddress& addr)> Callback;
+
+  /// Uses defaultNameservers().
+  /// Must be constructed in loop thread.
+  explicit Resolver(EventLoop* loop);
+  Resolver(EventLoop* loop, const std::vector<InetAddress>& nameservers);
+  ~Resolver();
+
+  /// Resolves hostname, or parses it if it's a dotted IPv4 address.
+  /// cb runs in the loop thread, before resolve() returns on a cache hit.
+  /// Lookups of a name already in flight share its query.
+  /// Thread safe.
+  void resolve(const StringPiece& hostname, const Callback& cb);
+
+  /// Seconds to wait for a nameserver, default 5.
+  /// Not thread safe.
+  void setTimeout(double seconds) { timeout_ = seconds; }
+
+  /// Rounds over the nameservers before giving up, default 2.
+  /// Not thread safe.
+  void setAttempts(int attempts) { attempts_ = attempts; }
+
+  /// Nameservers of resolvers created by EventLoop::resolver(),
+  /// parsed from /etc/resolv.conf unless set.
+  /// Thread safe.
+  static std::vector<InetAddress> defaultNameservers();
+  static void setDefaultNameservers(const std::vector<InetAddress>& nameservers);
+
+  /// "nameserver" lines of a resolv.conf, 127.0.0.1:53 if there is none.
+  static std::vector<InetAddress> parseResolvConf(const char* path);
+
+ private:
+  struct Query
+  {
+    string name;
+    uint16_t id;
+    int tries;
+    TimerId timer;
+    boost::shared_ptr<Channel> channel;  // socket of the current attempt
+    std::vector<Callback> callbacks;
+  };
+  typedef boost::shared_ptr<Query> QueryPtr;
+
+  void resolveInLoop(const string& hostname, const Callback& cb);
+  void handleRead(int sockfd);
+  void send(const QueryPtr& query);
+  void closeSocket(const QueryPtr& query);
+  void onTimeout(const string& name, uint16_t id);
+  void retryOrFail(const QueryPtr& query);
+  void finish(const QueryPtr& query, bool found, uint32_t ipNetEndian);
+  const InetAddress& serverOf(const Query& query) const;
+
+  EventLoop* loop_;
+  const std::vector<InetAddress> nameservers_;
+  double timeout_;
+  int attempts_;
+  std::map<string, QueryPtr> queries_;   // by lower case name
+  std::map<uint16_t, QueryPtr> queryIds_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_RESOLVER_H
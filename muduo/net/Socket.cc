@@ -1,6 +1,7 @@
 
 #include <muduo/net/Socket.h>
 
+#include <muduo/base/Logging.h>
 #include <muduo/net/InetAddress.h>
 #include <muduo/net/SocketsOps.h>
 
@@ -67,3 +68,23 @@ void Socket::setKeepAlive(bool on)
   // FIXME CHECK
 }
 
+
+void Socket::setDeferAccept(int seconds)
+{
+  int optval = seconds;
+  if (::setsockopt(sockfd_, IPPROTO_TCP, TCP_DEFER_ACCEPT,
+                   &optval, sizeof optval) < 0)
+  {
+    LOG_SYSERR << "Socket::setDeferAccept";
+  }
+}
+
+void Socket::setFastOpen(int queueLength)
+{
+  int optval = queueLength;
+  if (::setsockopt(sockfd_, IPPROTO_TCP, TCP_FASTOPEN,
+                   &optval, sizeof optval) < 0)
+  {
+    LOG_SYSERR << "Socket::setFastOpen";
+  }
+}
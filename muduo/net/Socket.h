@@ -75,6 +75,18 @@ class Socket : boost::noncopyable
   //
   void setKeepAlive(bool on);
 
+  ///
+  /// TCP_DEFER_ACCEPT on a listening socket, wakes up accept only when
+  /// data arrives, or after @c seconds.  0 disables.
+  ///
+  void setDeferAccept(int seconds);
+
+  ///
+  /// TCP_FASTOPEN on a listening socket, with a queue of @c queueLength
+  /// pending fast open requests.  0 disables.
+  ///
+  void setFastOpen(int queueLength);
+
  private:
   const int sockfd_; // socket fd ļ
 };
@@ -15,6 +15,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>  // snprintf
+#include <string.h>  // memcpy
 #include <strings.h>  // bzero
 #include <sys/socket.h>
 #include <unistd.h>
@@ -109,7 +110,10 @@ int sockets::accept(int sockfd, struct sockaddr_in* addr)
   if (connfd < 0)
   {
     int savedErrno = errno; //  ԭǿܱı Ҫԭ
-    LOG_SYSERR << "Socket::accept";
+    if (savedErrno != EAGAIN)  // the end of an accept batch
+    {
+      LOG_SYSERR << "Socket::accept";
+    }
     switch (savedErrno)
     {
       case EAGAIN:
@@ -162,6 +166,11 @@ ssize_t sockets::write(int sockfd, const void *buf, size_t count)
   return ::write(sockfd, buf, count);
 }
 
+ssize_t sockets::writev(int sockfd, const struct iovec *iov, int iovcnt)
+{
+  return ::writev(sockfd, iov, iovcnt);
+}
+
 void sockets::close(int sockfd)
 {
   if (::close(sockfd) < 0)
@@ -255,3 +264,61 @@ bool sockets::isSelfConnect(int sockfd)
       && localaddr.sin_addr.s_addr == peeraddr.sin_addr.s_addr;
 }
 
+bool sockets::sendFd(int sockfd, int fd)
+{
+  char data = 'F';  // at least one byte goes with the ancillary data
+  struct iovec iov;
+  iov.iov_base = &data;
+  iov.iov_len = sizeof data;
+  char control[CMSG_SPACE(sizeof fd)];
+  bzero(control, sizeof control);
+  struct msghdr msg;
+  bzero(&msg, sizeof msg);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof control;
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof fd);
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof fd);
+  if (::sendmsg(sockfd, &msg, MSG_NOSIGNAL) < 0)
+  {
+    LOG_SYSERR << "sockets::sendFd";
+    return false;
+  }
+  return true;
+}
+
+int sockets::recvFd(int sockfd)
+{
+  char data;
+  struct iovec iov;
+  iov.iov_base = &data;
+  iov.iov_len = sizeof data;
+  int fd = -1;
+  char control[CMSG_SPACE(sizeof fd)];
+  struct msghdr msg;
+  bzero(&msg, sizeof msg);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof control;
+  ssize_t n = ::recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC);
+  if (n < 0)
+  {
+    LOG_SYSERR << "sockets::recvFd";
+  }
+  else if (n > 0)
+  {
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+        && cmsg->cmsg_len == CMSG_LEN(sizeof fd))
+    {
+      memcpy(&fd, CMSG_DATA(cmsg), sizeof fd);
+    }
+  }
+  return fd;
+}
+
@@ -32,6 +32,7 @@ int  accept(int sockfd, struct sockaddr_in* addr);
 ssize_t read(int sockfd, void *buf, size_t count);
 ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
 ssize_t write(int sockfd, const void *buf, size_t count);
+ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt);
 void close(int sockfd);
 void shutdownWrite(int sockfd);
 
@@ -48,6 +49,12 @@ struct sockaddr_in getLocalAddr(int sockfd);
 struct sockaddr_in getPeerAddr(int sockfd);
 bool isSelfConnect(int sockfd);
 
+/// Passes @c fd over the Unix socket @c sockfd with SCM_RIGHTS.
+bool sendFd(int sockfd, int fd);
+/// Receives a descriptor sent by sendFd(), close-on-exec.
+/// Returns -1 on error or EOF.
+int recvFd(int sockfd);
+
 }
 }
 }
@@ -2,7 +2,9 @@
 
 #include <muduo/base/Logging.h>
 #include <muduo/net/Connector.h>
+#include <muduo/net/Endian.h>
 #include <muduo/net/EventLoop.h>
+#include <muduo/net/Resolver.h>
 #include <muduo/net/SocketsOps.h>
 
 #include <boost/bind.hpp>
@@ -29,6 +31,13 @@ void removeConnector(const ConnectorPtr& connector)
    //connector->
 }
 
+string hostPort(const string& hostname, uint16_t port)
+{
+  char buf[32];
+  snprintf(buf, sizeof buf, ":%u", port);
+  return hostname + buf;
+}
+
 }
 }
 }
@@ -39,11 +48,17 @@ TcpClient::TcpClient(EventLoop* loop,
   : loop_(CHECK_NOTNULL(loop)),
     connector_(new Connector(loop, serverAddr)),
     name_(name),
+    port_(0),
+    connNamePrefix_(new string(name + ":" + serverAddr.toIpPort())),
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
     retry_(false),
     connect_(true),
-    nextConnId_(1)
+    readIdleTimeout_(0),
+    writeIdleTimeout_(0),
+    maxLifetime_(0),
+    nextConnId_(1),
+    self_(new TcpClient*(this))
 {
   connector_->setNewConnectionCallback(
       boost::bind(&TcpClient::newConnection, this, _1));
@@ -52,10 +67,39 @@ TcpClient::TcpClient(EventLoop* loop,
            << "] - connector " << get_pointer(connector_);
 }
 
+TcpClient::TcpClient(EventLoop* loop,
+                     const string& hostname,
+                     uint16_t port,
+                     const string& name)
+  : loop_(CHECK_NOTNULL(loop)),
+    connector_(new Connector(loop, InetAddress(port))),  // set when resolved
+    name_(name),
+    hostname_(hostname),
+    port_(port),
+    connNamePrefix_(new string(name + ":" + detail::hostPort(hostname, port))),
+    connectionCallback_(defaultConnectionCallback),
+    messageCallback_(defaultMessageCallback),
+    retry_(false),
+    connect_(true),
+    readIdleTimeout_(0),
+    writeIdleTimeout_(0),
+    maxLifetime_(0),
+    nextConnId_(1),
+    self_(new TcpClient*(this))
+{
+  connector_->setNewConnectionCallback(
+      boost::bind(&TcpClient::newConnection, this, _1));
+  LOG_INFO << "TcpClient::TcpClient[" << name_
+           << "] - connector " << get_pointer(connector_);
+}
+
 TcpClient::~TcpClient()
 {
   LOG_INFO << "TcpClient::~TcpClient[" << name_
            << "] - connector " << get_pointer(connector_);
+  // pending resolves and their retries find nobody
+  self_.reset();
+  loop_->cancel(resolveRetryTimer_);
   TcpConnectionPtr conn;
   {
     MutexLockGuard lock(mutex_);
@@ -80,10 +124,78 @@ TcpClient::~TcpClient()
 void TcpClient::connect()
 {
   // FIXME: check state
-  LOG_INFO << "TcpClient::connect[" << name_ << "] - connecting to "
-           << connector_->serverAddress().toIpPort();
-  connect_ = true;
-  connector_->start();
+  if (hostname_.empty())
+  {
+    LOG_INFO << "TcpClient::connect[" << name_ << "] - connecting to "
+             << connector_->serverAddress().toIpPort();
+    connect_ = true;
+    connector_->start();
+  }
+  else
+  {
+    connect_ = true;
+    loop_->runInLoop(boost::bind(&TcpClient::resolveAndConnectIfAlive,
+                                 WeakSelfPtr(self_)));
+  }
+}
+
+void TcpClient::resolveAndConnectIfAlive(const WeakSelfPtr& self)
+{
+  SelfPtr client(self.lock());
+  if (client)
+  {
+    (*client)->resolveAndConnect();
+  }
+}
+
+void TcpClient::onResolvedIfAlive(const WeakSelfPtr& self,
+                                  bool found, const InetAddress& addr)
+{
+  SelfPtr client(self.lock());
+  if (client)
+  {
+    (*client)->onResolved(found, addr);
+  }
+}
+
+void TcpClient::resolveAndConnect()
+{
+  loop_->assertInLoopThread();
+  if (!connect_)
+  {
+    return;
+  }
+  LOG_INFO << "TcpClient::connect[" << name_ << "] - resolving " << hostname_;
+  loop_->resolver()->resolve(hostname_,
+      boost::bind(&TcpClient::onResolvedIfAlive, WeakSelfPtr(self_), _1, _2));
+}
+
+void TcpClient::onResolved(bool found, const InetAddress& addr)
+{
+  loop_->assertInLoopThread();
+  if (!connect_)
+  {
+    return;
+  }
+  if (found)
+  {
+    struct sockaddr_in serverAddr = addr.getSockAddrInet();
+    serverAddr.sin_port = sockets::hostToNetwork16(port_);
+    connector_->setServerAddress(InetAddress(serverAddr));
+    LOG_INFO << "TcpClient::connect[" << name_ << "] - connecting to "
+             << hostname_ << " " << connector_->serverAddress().toIpPort();
+    connector_->restart();
+  }
+  else
+  {
+    LOG_ERROR << "TcpClient::connect[" << name_ << "] - cannot resolve "
+              << hostname_;
+    if (retry_)
+    {
+      resolveRetryTimer_ = loop_->runAfter(1.0,
+          boost::bind(&TcpClient::resolveAndConnectIfAlive, WeakSelfPtr(self_)));
+    }
+  }
 }
 
 // Ѿ ر
@@ -104,22 +216,37 @@ void TcpClient::stop()
 {
   connect_ = false;
   connector_->stop();
+  loop_->cancel(resolveRetryTimer_);
+}
+
+void TcpClient::setFastOpen(bool on)
+{
+  connector_->setFastOpen(on);
+}
+
+void TcpClient::setBackoffPolicy(Connector::BackoffPolicy policy)
+{
+  connector_->setBackoffPolicy(policy);
+}
+
+void TcpClient::setConnectTimeout(double seconds)
+{
+  connector_->setConnectTimeout(seconds);
 }
 
 void TcpClient::newConnection(int sockfd)
 {
   loop_->assertInLoopThread();
   InetAddress peerAddr(sockets::getPeerAddr(sockfd));
-  char buf[32];
-  snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
+  int64_t connId = nextConnId_;
   ++nextConnId_;
-  string connName = name_ + buf;
 
   InetAddress localAddr(sockets::getLocalAddr(sockfd));
   // FIXME poll with zero timeout to double confirm the new connection
   // FIXME use make_shared if necessary
   TcpConnectionPtr conn(new TcpConnection(loop_,
-                                          connName,
+                                          connNamePrefix_,
+                                          connId,
                                           sockfd,
                                           localAddr,
                                           peerAddr));
@@ -127,6 +254,7 @@ void TcpClient::newConnection(int sockfd)
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
+  conn->setIdleTimeouts(readIdleTimeout_, writeIdleTimeout_, maxLifetime_);
   conn->setCloseCallback(
       boost::bind(&TcpClient::removeConnection, this, _1)); // FIXME: unsafe
   {
@@ -150,8 +278,15 @@ void TcpClient::removeConnection(const TcpConnectionPtr& conn)
   loop_->queueInLoop(boost::bind(&TcpConnection::connectDestroyed, conn));
   if (retry_ && connect_)
   {
-    LOG_INFO << "TcpClient::connect[" << name_ << "] - Reconnecting to "
-             << connector_->serverAddress().toIpPort();
-    connector_->restart();
+    if (hostname_.empty())
+    {
+      LOG_INFO << "TcpClient::connect[" << name_ << "] - Reconnecting to "
+               << connector_->serverAddress().toIpPort();
+      connector_->restart();
+    }
+    else
+    {
+      resolveAndConnect();
+    }
   }
 }
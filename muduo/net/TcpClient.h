@@ -2,16 +2,18 @@
 #define MUDUO_NET_TCPCLIENT_H
 
 #include <boost/noncopyable.hpp>
+#include <boost/weak_ptr.hpp>
 
 #include <muduo/base/Mutex.h>
+#include <muduo/net/Connector.h>
 #include <muduo/net/TcpConnection.h>
+#include <muduo/net/TimerId.h>
 
 namespace muduo
 {
 namespace net
 {
 
-class Connector;
 typedef boost::shared_ptr<Connector> ConnectorPtr;
 
 class TcpClient : boost::noncopyable
@@ -22,6 +24,12 @@ class TcpClient : boost::noncopyable
   TcpClient(EventLoop* loop,
             const InetAddress& serverAddr,
             const string& name);
+  /// Resolves hostname with EventLoop::resolver() on every connect and
+  /// reconnect, so a reconnect follows DNS changes.
+  TcpClient(EventLoop* loop,
+            const string& hostname,
+            uint16_t port,
+            const string& name);
   ~TcpClient();  // force out-line dtor, for scoped_ptr members.
 
   void connect();
@@ -34,6 +42,7 @@ class TcpClient : boost::noncopyable
     return connection_;
   }
 
+  EventLoop* getLoop() const { return loop_; }
   bool retry() const;
   void enableRetry() { retry_ = true; }
 
@@ -52,7 +61,40 @@ class TcpClient : boost::noncopyable
   void setWriteCompleteCallback(const WriteCompleteCallback& cb)
   { writeCompleteCallback_ = cb; }
 
+  /// Idle and lifetime limits of the connection in seconds, 0 for none,
+  /// see TcpConnection::setIdleTimeouts().
+  /// Not thread safe.
+  void setReadIdleTimeout(int seconds)
+  { readIdleTimeout_ = seconds; }
+
+  void setWriteIdleTimeout(int seconds)
+  { writeIdleTimeout_ = seconds; }
+
+  void setMaxLifetime(int seconds)
+  { maxLifetime_ = seconds; }
+
+  /// See Connector::setFastOpen(), call before connect().
+  void setFastOpen(bool on);
+
+  /// See Connector::setBackoffPolicy(), call before connect().
+  void setBackoffPolicy(Connector::BackoffPolicy policy);
+
+  /// See Connector::setConnectTimeout(), call before connect().
+  void setConnectTimeout(double seconds);
+
  private:
+  // A resolve or its retry timer may call back seconds later, so they
+  // hold the client by self_, which goes away with it.
+  typedef boost::shared_ptr<TcpClient*> SelfPtr;
+  typedef boost::weak_ptr<TcpClient*> WeakSelfPtr;
+  static void resolveAndConnectIfAlive(const WeakSelfPtr& self);
+  static void onResolvedIfAlive(const WeakSelfPtr& self,
+                                bool found, const InetAddress& addr);
+
+  /// Not thread safe, but in loop
+  void resolveAndConnect();
+  /// Not thread safe, but in loop
+  void onResolved(bool found, const InetAddress& addr);
   /// Not thread safe, but in loop
   void newConnection(int sockfd);
   /// Not thread safe, but in loop
@@ -61,15 +103,23 @@ class TcpClient : boost::noncopyable
   EventLoop* loop_;
   ConnectorPtr connector_; // avoid revealing Connector 
   const string name_;	   // 
+  const string hostname_;  // empty if constructed with an address
+  const uint16_t port_;
+  const TcpConnection::NamePrefixPtr connNamePrefix_;  // "name:serverAddr", shared by its connections
   ConnectionCallback connectionCallback_; // ӽص
   MessageCallback    messageCallback_;
   WriteCompleteCallback writeCompleteCallback_;
   bool retry_;   // atmoic ӽϿǷ
   bool connect_; // atomic
+  int readIdleTimeout_;
+  int writeIdleTimeout_;
+  int maxLifetime_;
   // always in loop thread
-  int nextConnId_;
+  int64_t nextConnId_;
   mutable MutexLock mutex_;
   TcpConnectionPtr connection_; // @BuardedBy mutex_
+  SelfPtr self_;
+  TimerId resolveRetryTimer_;   // always in loop thread
 };
 
 }
@@ -0,0 +1,315 @@
+#include <muduo/net/TcpClientPool.h>
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/TcpClient.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <set>
+#include <stdio.h>  // snprintf
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// In the loop of the client, where its connection may still have a close
+// queued, which calls the client and the pool.
+void destroyClient(TcpClient* client, CountDownLatch* latch)
+{
+  TcpConnectionPtr conn = client->connection();
+  if (conn)
+  {
+    conn->setConnectionCallback(defaultConnectionCallback);
+    conn->setMessageCallback(defaultMessageCallback);
+    conn->setWriteCompleteCallback(WriteCompleteCallback());
+  }
+  delete client;  // hands the close of conn over to the loop
+  latch->countDown();
+}
+
+}
+
+TcpClientPool::TcpClientPool(EventLoop* baseLoop,
+                             const std::vector<InetAddress>& serverAddrs,
+                             const string& name)
+  : baseLoop_(CHECK_NOTNULL(baseLoop)),
+    serverAddrs_(serverAddrs),
+    name_(name),
+    started_(false),
+    connectionsPerServer_(1),
+    requestTimeout_(0),
+    maxFailures_(3),
+    connectionCallback_(defaultConnectionCallback),
+    messageCallback_(defaultMessageCallback),
+    threadPool_(new EventLoopThreadPool(baseLoop)),
+    next_(0),
+    evictions_(0)
+{
+  assert(!serverAddrs_.empty());
+}
+
+TcpClientPool::~TcpClientPool()
+{
+  baseLoop_->assertInLoopThread();
+  LOG_TRACE << "TcpClientPool::~TcpClientPool [" << name_ << "] destructing";
+  if (started_ && requestTimeout_ > 0)
+  {
+    baseLoop_->cancel(healthTimer_);
+  }
+  // Each client goes in its own loop, after which nothing there calls
+  // back into it or into us; then the IO loops stop.
+  std::set<EventLoop*> ioLoops;
+  CountDownLatch latch(static_cast<int>(clients_.size()));
+  while (!clients_.empty())
+  {
+    TcpClient* client = clients_.pop_back().release();
+    EventLoop* loop = client->getLoop();
+    if (loop != baseLoop_)
+    {
+      ioLoops.insert(loop);
+    }
+    loop->runInLoop(boost::bind(destroyClient, client, &latch));
+  }
+  latch.wait();
+
+  // the closes and connector stops above queued more, let it run first
+  CountDownLatch flushed(static_cast<int>(ioLoops.size()));
+  for (std::set<EventLoop*>::iterator it = ioLoops.begin(); it != ioLoops.end(); ++it)
+  {
+    (*it)->queueInLoop(boost::bind(&CountDownLatch::countDown, &flushed));
+  }
+  flushed.wait();
+  threadPool_.reset();
+}
+
+void TcpClientPool::setThreadNum(int numThreads)
+{
+  assert(0 <= numThreads);
+  threadPool_->setThreadNum(numThreads);
+}
+
+void TcpClientPool::start()
+{
+  baseLoop_->assertInLoopThread();
+  assert(!started_);
+  assert(connectionsPerServer_ > 0);
+  started_ = true;
+  threadPool_->start();
+
+  size_t total = serverAddrs_.size() * connectionsPerServer_;
+  {
+    MutexLockGuard lock(mutex_);
+    slots_.resize(total);
+  }
+  // interleave backends, so that each loop gets a mix of them
+  for (int i = 0; i < connectionsPerServer_; ++i)
+  {
+    for (size_t s = 0; s < serverAddrs_.size(); ++s)
+    {
+      size_t index = clients_.size();
+      char buf[32];
+      snprintf(buf, sizeof buf, "#%zu", index);
+      TcpClient* client = new TcpClient(threadPool_->getNextLoop(),
+                                        serverAddrs_[s],
+                                        name_ + buf);
+      clients_.push_back(client);
+      client->setConnectionCallback(
+          boost::bind(&TcpClientPool::onConnection, this, index, _1));
+      client->setMessageCallback(messageCallback_);
+      client->setWriteCompleteCallback(writeCompleteCallback_);
+      client->enableRetry();
+    }
+  }
+  assert(clients_.size() == total);
+
+  if (requestTimeout_ > 0)
+  {
+    double interval = std::min(requestTimeout_ / 2, 1.0);
+    healthTimer_ = baseLoop_->runEvery(interval,
+        boost::bind(&TcpClientPool::checkHealth, this));
+  }
+
+  for (size_t i = 0; i < clients_.size(); ++i)
+  {
+    clients_[i].connect();
+  }
+}
+
+TcpConnectionPtr TcpClientPool::acquire()
+{
+  MutexLockGuard lock(mutex_);
+  const size_t n = slots_.size();
+  Slot* best = NULL;
+  for (size_t i = 0; i < n; ++i)
+  {
+    // rotate the start, so ties don't all land on the first slot
+    Slot& slot = slots_[(next_ + i) % n];
+    if (slot.conn && slot.conn->connected()
+        && (best == NULL || slot.pending < best->pending))
+    {
+      best = &slot;
+      if (best->pending == 0)
+      {
+        break;
+      }
+    }
+  }
+  ++next_;
+
+  TcpConnectionPtr conn;
+  if (best)
+  {
+    if (best->pending == 0)
+    {
+      // idle until now, don't count the quiet time against it
+      best->lastProgress = Timestamp::now();
+    }
+    ++best->pending;
+    conn = best->conn;
+  }
+  return conn;
+}
+
+void TcpClientPool::release(const TcpConnectionPtr& conn, bool ok)
+{
+  TcpConnectionPtr evicted;
+  {
+    MutexLockGuard lock(mutex_);
+    size_t index = findLocked(conn);
+    if (index == slots_.size())
+    {
+      // evicted or reconnected while the request was in flight
+      return;
+    }
+    Slot* slot = &slots_[index];
+    if (slot->pending > 0)
+    {
+      --slot->pending;
+    }
+    slot->lastProgress = Timestamp::now();
+    if (ok)
+    {
+      slot->failures = 0;
+    }
+    else if (maxFailures_ > 0 && ++slot->failures >= maxFailures_)
+    {
+      evicted = evictLocked(slot, "too many failures");
+    }
+  }
+  if (evicted)
+  {
+    evicted->forceClose();
+  }
+}
+
+int TcpClientPool::pending(const TcpConnectionPtr& conn) const
+{
+  MutexLockGuard lock(mutex_);
+  size_t index = findLocked(conn);
+  return index < slots_.size() ? slots_[index].pending : -1;
+}
+
+int TcpClientPool::numConnected() const
+{
+  MutexLockGuard lock(mutex_);
+  int n = 0;
+  for (size_t i = 0; i < slots_.size(); ++i)
+  {
+    if (slots_[i].conn && slots_[i].conn->connected())
+    {
+      ++n;
+    }
+  }
+  return n;
+}
+
+int64_t TcpClientPool::evictions() const
+{
+  MutexLockGuard lock(mutex_);
+  return evictions_;
+}
+
+void TcpClientPool::onConnection(size_t index, const TcpConnectionPtr& conn)
+{
+  {
+    MutexLockGuard lock(mutex_);
+    if (index < slots_.size())
+    {
+      Slot& slot = slots_[index];
+      if (conn->connected())
+      {
+        slot.conn = conn;
+        slot.pending = 0;
+        slot.failures = 0;
+        slot.lastProgress = Timestamp::now();
+      }
+      else if (slot.conn == conn)
+      {
+        slot.conn.reset();
+        slot.pending = 0;
+      }
+    }
+  }
+  connectionCallback_(conn);
+}
+
+void TcpClientPool::checkHealth()
+{
+  baseLoop_->assertInLoopThread();
+  std::vector<TcpConnectionPtr> evicted;
+  Timestamp now(Timestamp::now());
+  {
+    MutexLockGuard lock(mutex_);
+    for (size_t i = 0; i < slots_.size(); ++i)
+    {
+      Slot& slot = slots_[i];
+      if (slot.conn && slot.pending > 0
+          && timeDifference(now, slot.lastProgress) > requestTimeout_)
+      {
+        evicted.push_back(evictLocked(&slot, "request timeout"));
+      }
+    }
+  }
+  for (size_t i = 0; i < evicted.size(); ++i)
+  {
+    evicted[i]->forceClose();
+  }
+}
+
+TcpConnectionPtr TcpClientPool::evictLocked(Slot* slot, const char* reason)
+{
+  mutex_.assertLocked();
+  LOG_WARN << "TcpClientPool::evict [" << name_ << "] - connection "
+           << slot->conn->name() << " " << reason
+           << ", pending " << slot->pending;
+  TcpConnectionPtr conn;
+  conn.swap(slot->conn);
+  slot->pending = 0;
+  slot->failures = 0;
+  ++evictions_;
+  return conn;
+}
+
+size_t TcpClientPool::findLocked(const TcpConnectionPtr& conn) const
+{
+  mutex_.assertLocked();
+  size_t i = 0;
+  if (conn)
+  {
+    while (i < slots_.size() && slots_[i].conn != conn)
+    {
+      ++i;
+    }
+  }
+  else
+  {
+    i = slots_.size();
+  }
+  return i;
+}
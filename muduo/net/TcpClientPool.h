@@ -0,0 +1,134 @@
+#ifndef MUDUO_NET_TCPCLIENTPOOL_H
+#define MUDUO_NET_TCPCLIENTPOOL_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/TimerId.h>
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoopThreadPool;
+class TcpClient;
+
+///
+/// A pool of client connections to a set of backends.
+///
+/// Connections are spread over the loops of an EventLoopThreadPool,
+/// each one is a TcpClient with retry enabled.  acquire() picks the live
+/// connection with the fewest requests in flight, the caller pairs it
+/// with release() when the response arrives.  A connection is evicted
+/// (closed and reconnected) after too many consecutive failures, or when
+/// it has requests in flight but made no progress for requestTimeout.
+///
+class TcpClientPool : boost::noncopyable
+{
+ public:
+  TcpClientPool(EventLoop* baseLoop,
+                const std::vector<InetAddress>& serverAddrs,
+                const string& name);
+  ~TcpClientPool();  // force out-line dtor, for scoped_ptr members.
+
+  /// Number of IO threads, 0 to do everything in baseLoop.
+  /// Must be called before start().
+  void setThreadNum(int numThreads);
+
+  /// Number of connections to each backend, default 1.
+  /// Must be called before start().
+  void setConnectionsPerServer(int n) { connectionsPerServer_ = n; }
+
+  /// Seconds a connection may have requests in flight without any
+  /// release(), 0 to disable.  Default 0.
+  /// Must be called before start().
+  void setRequestTimeout(double seconds) { requestTimeout_ = seconds; }
+
+  /// Consecutive failed release() before eviction, 0 to disable.  Default 3.
+  /// Must be called before start().
+  void setMaxFailures(int n) { maxFailures_ = n; }
+
+  /// Not thread safe, call before start().
+  void setConnectionCallback(const ConnectionCallback& cb)
+  { connectionCallback_ = cb; }
+
+  /// Not thread safe, call before start().
+  void setMessageCallback(const MessageCallback& cb)
+  { messageCallback_ = cb; }
+
+  /// Not thread safe, call before start().
+  void setWriteCompleteCallback(const WriteCompleteCallback& cb)
+  { writeCompleteCallback_ = cb; }
+
+  /// Starts the IO threads and connects.
+  /// Must be called in baseLoop.
+  void start();
+
+  /// Picks the least loaded live connection and counts one request in
+  /// flight on it.  Returns null if no connection is up.
+  /// Thread safe.
+  TcpConnectionPtr acquire();
+
+  /// Finishes a request started with acquire().
+  /// Thread safe.
+  void release(const TcpConnectionPtr& conn, bool ok = true);
+
+  /// Requests in flight on conn, -1 if it's not in the pool.
+  /// Thread safe.
+  int pending(const TcpConnectionPtr& conn) const;
+
+  /// Thread safe.
+  int numConnected() const;
+  int64_t evictions() const;
+
+ private:
+  struct Slot
+  {
+    Slot() : pending(0), failures(0) { }
+
+    TcpConnectionPtr conn;
+    int pending;
+    int failures;
+    Timestamp lastProgress;
+  };
+
+  /// Not thread safe, but in loop of the client
+  void onConnection(size_t index, const TcpConnectionPtr& conn);
+  /// Not thread safe, but in baseLoop
+  void checkHealth();
+  /// Must hold mutex_
+  TcpConnectionPtr evictLocked(Slot* slot, const char* reason);
+  /// Index of the slot holding conn, slots_.size() if none.
+  /// Must hold mutex_
+  size_t findLocked(const TcpConnectionPtr& conn) const;
+
+  EventLoop* baseLoop_;
+  const std::vector<InetAddress> serverAddrs_;
+  const string name_;
+  bool started_;
+  int connectionsPerServer_;
+  double requestTimeout_;
+  int maxFailures_;
+  ConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+  WriteCompleteCallback writeCompleteCallback_;
+  TimerId healthTimer_;
+  boost::scoped_ptr<EventLoopThreadPool> threadPool_;
+  boost::ptr_vector<TcpClient> clients_;
+  mutable MutexLock mutex_;
+  std::vector<Slot> slots_; // @GuardedBy mutex_, sized in start()
+  size_t next_;             // @GuardedBy mutex_, where the scan starts
+  int64_t evictions_;       // @GuardedBy mutex_
+};
+
+}
+}
+
+#endif  // MUDUO_NET_TCPCLIENTPOOL_H
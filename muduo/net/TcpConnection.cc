@@ -7,9 +7,16 @@
 #include <muduo/net/SocketsOps.h>
 
 #include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
 
 #include <errno.h>
 #include <stdio.h>
+#include <sys/uio.h>
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#undef __STDC_FORMAT_MACROS
 
 using namespace muduo;
 using namespace muduo::net;
@@ -28,19 +35,52 @@ void muduo::net::defaultMessageCallback(const TcpConnectionPtr&,
   buf->retrieveAll();
 }
 
+namespace
+{
+// plain int, slots may be defined before this file's statics are constructed
+int g_numContextSlots = 0;
+}
+
+int muduo::net::detail::newContextSlot()
+{
+  int index = __sync_fetch_and_add(&g_numContextSlots, 1);
+  if (index >= kMaxContextSlots)
+  {
+    LOG_FATAL << "more than " << kMaxContextSlots << " ContextSlot";
+  }
+  return index;
+}
+
 TcpConnection::TcpConnection(EventLoop* loop,
-                             const string& nameArg,
+                             const NamePrefixPtr& namePrefix,
+                             int64_t id,
                              int sockfd,
                              const InetAddress& localAddr,
                              const InetAddress& peerAddr)
   : loop_(CHECK_NOTNULL(loop)),
-    name_(nameArg),
+    namePrefix_(namePrefix),
+    id_(id),
     state_(kConnecting),
     socket_(new Socket(sockfd)),
     channel_(new Channel(loop, sockfd)),
     localAddr_(localAddr),
     peerAddr_(peerAddr),
-    highWaterMark_(64*1024*1024)
+    highWaterMark_(64*1024*1024),
+    sharedOutputBytes_(0),
+    leanBuffers_(false),
+    scratchReads_(false),
+    readOnEstablish_(false),
+    reclaimThreshold_(0),
+    lastIoIteration_(0),
+    countedBufferBytes_(0),
+    readIdleTimeout_(0),
+    writeIdleTimeout_(0),
+    maxLifetime_(0),
+    timingWheel_(NULL),
+    idleEntry_(this),
+    lastReadTick_(0),
+    lastWriteTick_(0),
+    establishedTick_(0)
 {
 // ͨɶ¼ʱ صTcpConnection::handleRead,_1¼ʱ
   channel_->setReadCallback(
@@ -51,15 +91,33 @@ TcpConnection::TcpConnection(EventLoop* loop,
       boost::bind(&TcpConnection::handleClose, this));
   channel_->setErrorCallback(
       boost::bind(&TcpConnection::handleError, this));
-  LOG_DEBUG << "TcpConnection::ctor[" <<  name_ << "] at " << this
+  LOG_DEBUG << "TcpConnection::ctor[" <<  name() << "] at " << this
             << " fd=" << sockfd;
   socket_->setKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection()
 {
-  LOG_DEBUG << "TcpConnection::dtor[" <<  name_ << "] at " << this
+  LOG_DEBUG << "TcpConnection::dtor[" <<  name() << "] at " << this
             << " fd=" << channel_->fd();
+  if (bufferBytesCounter_)
+  {
+    bufferBytesCounter_->add(-countedBufferBytes_);
+  }
+  for (int i = 0; i < detail::kMaxContextSlots; ++i)
+  {
+    if (contexts_[i].context)
+    {
+      contexts_[i].destroy(contexts_[i].context);
+    }
+  }
+}
+
+string TcpConnection::name() const
+{
+  char buf[32];
+  snprintf(buf, sizeof buf, "#%" PRId64, id_);
+  return *namePrefix_ + buf;
 }
 
 // ̰߳ȫ Կ̵߳
@@ -92,10 +150,11 @@ void TcpConnection::send(const StringPiece& message)
     }
     else
     {
+      // copying a shared message along the way costs no allocation
       loop_->runInLoop(
-          boost::bind(&TcpConnection::sendInLoop,
+          boost::bind(&TcpConnection::sendCopyInLoop,
                       this,     // FIXME
-                      message.as_string()));
+                      SharedMessage(boost::make_shared<string>(message.data(), message.size()))));
                     //std::forward<string>(message)));
     }
   }
@@ -114,20 +173,54 @@ void TcpConnection::send(Buffer* buf)
     else
     {
       loop_->runInLoop(
-          boost::bind(&TcpConnection::sendInLoop,
+          boost::bind(&TcpConnection::sendCopyInLoop,
                       this,     // FIXME
-                      buf->retrieveAllAsString()));
+                      SharedMessage(boost::make_shared<string>(buf->peek(), buf->readableBytes()))));
+      buf->retrieveAll();
                     //std::forward<string>(message)));
     }
   }
 }
 
+void TcpConnection::send(const SharedMessage& message)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendSharedInLoop(message);
+    }
+    else
+    {
+      loop_->runInLoop(
+          boost::bind(&TcpConnection::sendSharedInLoop,
+                      this,     // FIXME
+                      message));
+    }
+  }
+}
+
 void TcpConnection::sendInLoop(const StringPiece& message)
 {
   sendInLoop(message.data(), message.size());
 }
 
+void TcpConnection::sendSharedInLoop(const SharedMessage& message)
+{
+  sendInLoop(message->data(), message->size(), message);
+}
+
+void TcpConnection::sendCopyInLoop(const SharedMessage& message)
+{
+  sendInLoop(message->data(), message->size());
+}
+
 void TcpConnection::sendInLoop(const void* data, size_t len)
+{
+  sendInLoop(data, len, SharedMessage());
+}
+
+void TcpConnection::sendInLoop(const void* data, size_t len, const SharedMessage& shared)
 {
   loop_->assertInLoopThread();
   ssize_t nwrote = 0;
@@ -138,9 +231,13 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
     LOG_WARN << "disconnected, give up writing";
     return;
   }
+  if (timingWheel_)
+  {
+    lastWriteTick_ = timingWheel_->now();
+  }
   // if no thing in output queue, try writing directly
   // ͨûйעд¼ ҷͻû ֱwrite
-  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+  if (!channel_->isWriting() && outputBytes() == 0)
   {
     nwrote = sockets::write(channel_->fd(), data, len);
     if (nwrote >= 0)
@@ -156,7 +253,9 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
     else // nwrote < 0
     {
       nwrote = 0;
-      if (errno != EWOULDBLOCK)
+      // EINPROGRESS: a TCP_FASTOPEN_CONNECT socket without cookie,
+      // the data goes out once the handshake completes
+      if (errno != EWOULDBLOCK && errno != EINPROGRESS)
       {
         LOG_SYSERR << "TcpConnection::sendInLoop";
         if (errno == EPIPE) // FIXME: any others?
@@ -172,7 +271,7 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   if (!error && remaining > 0)
   {
     LOG_TRACE << "I am going to write more data";
-    size_t oldLen = outputBuffer_.readableBytes();
+    size_t oldLen = outputBytes();
 
 	// ˮλhighWaterMark_ صhighWaterMarkCallback_ ʣ෢ͻռ䲻
     if (oldLen + remaining >= highWaterMark_
@@ -181,7 +280,23 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
     {
       loop_->queueInLoop(boost::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
     }
-    outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
+    if (shared)
+    {
+      sharedOutput_.push_back(SharedChunk(shared, len - remaining));
+      sharedOutputBytes_ += remaining;
+    }
+    else if (!sharedOutput_.empty())
+    {
+      // keep the order, behind the queued references
+      SharedMessage copy(new string(static_cast<const char*>(data)+nwrote, remaining));
+      sharedOutput_.push_back(SharedChunk(copy, 0));
+      sharedOutputBytes_ += remaining;
+    }
+    else
+    {
+      outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
+      updateBufferBytes();
+    }
     if (!channel_->isWriting())
     {
       channel_->enableWriting(); // ں˻˲д עPOLLOUT¼
@@ -215,11 +330,87 @@ void TcpConnection::shutdownInLoop()
   }
 }
 
+void TcpConnection::forceClose()
+{
+  // FIXME: use compare and swap
+  if (state_ == kConnected || state_ == kDisconnecting)
+  {
+    setState(kDisconnecting);
+    loop_->queueInLoop(boost::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+  }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+  loop_->assertInLoopThread();
+  if (state_ == kConnected || state_ == kDisconnecting)
+  {
+    // as if we received 0 byte in handleRead();
+    handleClose();
+  }
+}
+
 void TcpConnection::setTcpNoDelay(bool on)
 {
   socket_->setTcpNoDelay(on);
 }
 
+void TcpConnection::setLeanBuffers(bool on)
+{
+  assert(state_ == kConnecting);
+  leanBuffers_ = on;
+  if (on)
+  {
+    Buffer emptyInput(0);
+    Buffer emptyOutput(0);
+    inputBuffer_.swap(emptyInput);
+    outputBuffer_.swap(emptyOutput);
+  }
+}
+
+void TcpConnection::reclaimIdleBuffers(int64_t idleIterations)
+{
+  loop_->assertInLoopThread();
+  if (loop_->iteration() - lastIoIteration_ >= idleIterations)
+  {
+    if (inputBuffer_.internalCapacity() > Buffer::kCheapPrepend + inputBuffer_.readableBytes())
+    {
+      inputBuffer_.shrinkToFit();
+    }
+    if (outputBuffer_.internalCapacity() > Buffer::kCheapPrepend + outputBuffer_.readableBytes())
+    {
+      outputBuffer_.shrinkToFit();
+    }
+    updateBufferBytes();
+  }
+}
+
+void TcpConnection::releaseIfDrained(Buffer* buf)
+{
+  if (buf->readableBytes() == 0)
+  {
+    size_t capacity = buf->internalCapacity() - Buffer::kCheapPrepend;
+    if ((leanBuffers_ && capacity > 0)
+        || (reclaimThreshold_ > 0 && capacity > reclaimThreshold_))
+    {
+      buf->shrinkToFit();
+    }
+  }
+}
+
+void TcpConnection::updateBufferBytes()
+{
+  if (bufferBytesCounter_)
+  {
+    int64_t bytes = static_cast<int64_t>(bufferCapacity());
+    if (bytes != countedBufferBytes_)
+    {
+      bufferBytesCounter_->add(bytes - countedBufferBytes_);
+      countedBufferBytes_ = bytes;
+    }
+  }
+}
+
 void TcpConnection::connectEstablished()
 {
   loop_->assertInLoopThread();
@@ -227,8 +418,23 @@ void TcpConnection::connectEstablished()
   setState(kConnected);
   channel_->tie(shared_from_this()); // ӳɹעͨĿɶ¼ thisָװshared_ptr
   channel_->enableReading();
+  lastIoIteration_ = loop_->iteration();
+  updateBufferBytes();
+  if (readIdleTimeout_ > 0 || writeIdleTimeout_ > 0 || maxLifetime_ > 0)
+  {
+    timingWheel_ = loop_->timingWheel();
+    establishedTick_ = timingWheel_->now();
+    lastReadTick_ = establishedTick_;
+    lastWriteTick_ = establishedTick_;
+    checkIdleTimeout();
+  }
 
   connectionCallback_(shared_from_this()); // ص
+  // the callback may have closed us
+  if (readOnEstablish_ && state_ == kConnected)
+  {
+    handleRead(Timestamp::now());
+  }
 }
 
 void TcpConnection::connectDestroyed()
@@ -241,15 +447,75 @@ void TcpConnection::connectDestroyed()
 
     connectionCallback_(shared_from_this());
   }
+  if (timingWheel_)
+  {
+    timingWheel_->remove(&idleEntry_);
+  }
   channel_->remove();
 }
 
+void TcpConnection::checkIdleTimeout()
+{
+  loop_->assertInLoopThread();
+  assert(state_ == kConnected || state_ == kDisconnecting);
+  // a limit of N seconds expires once N whole ticks have passed
+  const int64_t now = timingWheel_->now();
+  int64_t deadline = 0;
+  const char* reason = NULL;
+  if (readIdleTimeout_ > 0)
+  {
+    deadline = lastReadTick_ + readIdleTimeout_ + 1;
+    reason = "read idle";
+  }
+  if (writeIdleTimeout_ > 0
+      && (reason == NULL || lastWriteTick_ + writeIdleTimeout_ + 1 < deadline))
+  {
+    deadline = lastWriteTick_ + writeIdleTimeout_ + 1;
+    reason = "write idle";
+  }
+  if (maxLifetime_ > 0
+      && (reason == NULL || establishedTick_ + maxLifetime_ + 1 < deadline))
+  {
+    deadline = establishedTick_ + maxLifetime_ + 1;
+    reason = "lifetime";
+  }
+  assert(reason != NULL);
+
+  if (deadline <= now)
+  {
+    LOG_INFO << "TcpConnection::checkIdleTimeout [" << name()
+             << "] - " << reason << " timeout";
+    forceCloseInLoop();
+  }
+  else
+  {
+    timingWheel_->insert(&idleEntry_, deadline - now);
+  }
+}
+
 // ӶϿ 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
   loop_->assertInLoopThread();
+  lastIoIteration_ = loop_->iteration();
+  if (timingWheel_)
+  {
+    lastReadTick_ = timingWheel_->now();
+  }
+  // an empty buffer borrows the storage of the loop's read area,
+  // so a bulk read is copied only once, by the kernel
+  ReadScratch* scratch = loop_->readScratch();
+  const bool borrowed = inputBuffer_.readableBytes() == 0
+      && (leanBuffers_
+          || (scratchReads_ && inputBuffer_.writableBytes() < scratch->averageRead()));
+  if (borrowed)
+  {
+    scratch->lend(&inputBuffer_);
+  }
   int savedErrno = 0;
-  ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno); // read
+  ssize_t n = scratchReads_
+      ? inputBuffer_.readFd(channel_->fd(), &savedErrno, scratch)
+      : inputBuffer_.readFd(channel_->fd(), &savedErrno); // read
   if (n > 0)
   {
     messageCallback_(shared_from_this(), &inputBuffer_, receiveTime); // shared_from_thisǰthisָתshared_ptr
@@ -258,12 +524,26 @@ void TcpConnection::handleRead(Timestamp receiveTime)
   {
     handleClose();
   }
+  else if (savedErrno == EAGAIN)
+  {
+    // nothing yet, after readOnEstablish_
+  }
   else
   {
     errno = savedErrno;
     LOG_SYSERR << "TcpConnection::handleRead";
     handleError();
   }
+
+  if (borrowed)
+  {
+    scratch->giveBack(&inputBuffer_);
+  }
+  else
+  {
+    releaseIfDrained(&inputBuffer_);
+  }
+  updateBufferBytes();
 }
 
 // ں˻пռ صú
@@ -272,15 +552,19 @@ void TcpConnection::handleWrite()
   loop_->assertInLoopThread();
   if (channel_->isWriting())
   {
-    ssize_t n = sockets::write(channel_->fd(),
-                               outputBuffer_.peek(),
-                               outputBuffer_.readableBytes());
+    ssize_t n = writeOutput();
+    lastIoIteration_ = loop_->iteration();
+    if (timingWheel_)
+    {
+      lastWriteTick_ = timingWheel_->now();
+    }
     if (n > 0)
     {
-      outputBuffer_.retrieve(n); // ±ƶ
-      if (outputBuffer_.readableBytes() == 0)  //  ͻ ֹͣעPOOLOUT¼
+      if (outputBytes() == 0)  //  ͻ ֹͣעPOOLOUT¼
       {
         channel_->disableWriting(); // ֹͣעPOLLOUT¼ busy loop
+        releaseIfDrained(&outputBuffer_);
+        updateBufferBytes();
         if (writeCompleteCallback_)
         {
           loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
@@ -307,6 +591,60 @@ void TcpConnection::handleWrite()
   }
 }
 
+ssize_t TcpConnection::writeOutput()
+{
+  if (sharedOutput_.empty())
+  {
+    ssize_t n = sockets::write(channel_->fd(),
+                               outputBuffer_.peek(),
+                               outputBuffer_.readableBytes());
+    if (n > 0)
+    {
+      outputBuffer_.retrieve(static_cast<size_t>(n));
+    }
+    return n;
+  }
+
+  const int kMaxIov = 64;
+  struct iovec vec[kMaxIov];
+  int cnt = 0;
+  if (outputBuffer_.readableBytes() > 0)
+  {
+    vec[cnt].iov_base = const_cast<char*>(outputBuffer_.peek());
+    vec[cnt].iov_len = outputBuffer_.readableBytes();
+    ++cnt;
+  }
+  for (std::deque<SharedChunk>::const_iterator it = sharedOutput_.begin();
+       it != sharedOutput_.end() && cnt < kMaxIov; ++it)
+  {
+    vec[cnt].iov_base = const_cast<char*>(it->message->data() + it->offset);
+    vec[cnt].iov_len = it->message->size() - it->offset;
+    ++cnt;
+  }
+  ssize_t n = sockets::writev(channel_->fd(), vec, cnt);
+  if (n > 0)
+  {
+    size_t left = static_cast<size_t>(n);
+    size_t fromBuffer = std::min(left, outputBuffer_.readableBytes());
+    outputBuffer_.retrieve(fromBuffer);
+    left -= fromBuffer;
+    sharedOutputBytes_ -= left;
+    while (left > 0)
+    {
+      SharedChunk& chunk = sharedOutput_.front();
+      size_t chunkLeft = chunk.message->size() - chunk.offset;
+      if (left < chunkLeft)
+      {
+        chunk.offset += left;
+        break;
+      }
+      left -= chunkLeft;
+      sharedOutput_.pop_front();
+    }
+  }
+  return n;
+}
+
 void TcpConnection::handleClose()
 {
   loop_->assertInLoopThread();
@@ -315,6 +653,10 @@ void TcpConnection::handleClose()
   // we don't close fd, leave it to dtor, so we can find leaks easily.
   setState(kDisconnected);
   channel_->disableAll();
+  if (timingWheel_)
+  {
+    timingWheel_->remove(&idleEntry_);
+  }
 
   TcpConnectionPtr guardThis(shared_from_this());
   connectionCallback_(guardThis);
@@ -325,7 +667,7 @@ void TcpConnection::handleClose()
 void TcpConnection::handleError()
 {
   int err = sockets::getSocketError(channel_->fd());
-  LOG_ERROR << "TcpConnection::handleError [" << name_
+  LOG_ERROR << "TcpConnection::handleError [" << name()
             << "] - SO_ERROR = " << err << " " << strerror_tl(err);
 }
 
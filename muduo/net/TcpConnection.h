@@ -1,19 +1,24 @@
 #ifndef MUDUO_NET_TCPCONNECTION_H
 #define MUDUO_NET_TCPCONNECTION_H
 
+#include <muduo/base/Atomic.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
 #include <muduo/net/Callbacks.h>
 #include <muduo/net/Buffer.h>
 #include <muduo/net/InetAddress.h>
+#include <muduo/net/TimingWheel.h>
 
 #include <boost/any.hpp>
+#include <boost/checked_delete.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <deque>
+
 namespace muduo
 {
 namespace net
@@ -23,23 +28,61 @@ class Channel;
 class EventLoop;
 class Socket;
 
+namespace detail
+{
+const int kMaxContextSlots = 8;
+/// Aborts when all kMaxContextSlots are taken.
+int newContextSlot();
+}
+
+///
+/// Key of a typed context of TcpConnection, holding a T*.
+///
+/// Slots are a process-wide resource, define one per use at namespace
+/// scope, e.g. const ContextSlot<HttpContext> kHttpContext;
+///
+template<typename T>
+class ContextSlot : boost::noncopyable
+{
+ public:
+  ContextSlot()
+    : index_(detail::newContextSlot())
+  {
+  }
+
+  int index() const { return index_; }
+
+ private:
+  const int index_;
+};
+
 /// TCP connection, for both client and server usage.
 /// This is an interface class, so don't expose too much details.
 class TcpConnection : boost::noncopyable,
                       public boost::enable_shared_from_this<TcpConnection>
 {
  public:
+  typedef boost::shared_ptr<const string> NamePrefixPtr;
+  typedef boost::shared_ptr<AtomicInt64> BufferBytesCounterPtr;
+  /// Immutable payload sent to many connections, see TcpServer::broadcast().
+  typedef boost::shared_ptr<const string> SharedMessage;
+
   /// Constructs a TcpConnection with a connected sockfd
   /// User should not create this object.
+  /// @c namePrefix is shared by all connections of the same owner,
+  /// @c id is unique within that owner.
   TcpConnection(EventLoop* loop,
-                const string& name,
+                const NamePrefixPtr& namePrefix,
+                int64_t id,
                 int sockfd,
                 const InetAddress& localAddr,
                 const InetAddress& peerAddr);
   ~TcpConnection();
 
   EventLoop* getLoop() const { return loop_; }
-  const string& name() const { return name_; }
+  int64_t id() const { return id_; }
+  /// Formatted on demand as "prefix#id", mostly for logging.
+  string name() const;
   const InetAddress& localAddress() { return localAddr_; }
   const InetAddress& peerAddress() { return peerAddr_; }
   bool connected() const { return state_ == kConnected; }
@@ -49,7 +92,13 @@ class TcpConnection : boost::noncopyable,
   void send(const StringPiece& message);
   // void send(Buffer&& message); // C++11
   void send(Buffer* message);  // this one will swap data
+  /// What can't be written at once is queued as a reference to
+  /// @c message, not copied into the output buffer.
+  /// Thread safe.
+  void send(const SharedMessage& message);
   void shutdown(); // NOT thread safe, no simultaneous calling
+  /// Closes without waiting for the output buffer to drain.
+  void forceClose();
   void setTcpNoDelay(bool on);
 
   void setContext(const boost::any& context)
@@ -61,6 +110,26 @@ class TcpConnection : boost::noncopyable,
   boost::any* getMutableContext()
   { return &context_; }
 
+  /// Typed context, an array lookup without any_cast.
+  /// The connection owns @c context and deletes it on reset or destruction.
+  /// Not thread safe, but in loop.
+  template<typename T>
+  void setContext(const ContextSlot<T>& slot, T* context)
+  {
+    ContextHolder& holder = contexts_[slot.index()];
+    if (holder.context)
+    {
+      holder.destroy(holder.context);
+    }
+    holder.context = context;
+    holder.destroy = &deleteContext<T>;
+  }
+
+  /// NULL if not set.
+  template<typename T>
+  T* getContext(const ContextSlot<T>& slot) const
+  { return static_cast<T*>(contexts_[slot.index()].context); }
+
   void setConnectionCallback(const ConnectionCallback& cb)
   { connectionCallback_ = cb; }
 
@@ -76,6 +145,58 @@ class TcpConnection : boost::noncopyable,
   Buffer* inputBuffer()
   { return &inputBuffer_; }
 
+  /// Starts with zero-capacity buffers, and reads into the loop's
+  /// EventLoop::readScratch() while inputBuffer_ is empty, so only leftovers
+  /// of a partial message are kept by this connection.
+  /// Drained buffers are released at once.
+  /// Call before connectEstablished().
+  void setLeanBuffers(bool on);
+
+  /// Reads spill into the loop's pre-faulted ReadScratch instead of
+  /// a 64k stack array, see Buffer::readFd(int, int*, ReadScratch*).
+  /// An empty input buffer that is too small for a typical read
+  /// borrows the scratch's storage for the read, as lean buffers do.
+  void setScratchReads(bool on)
+  { scratchReads_ = on; }
+
+  /// Reads once in connectEstablished(), without waiting for the poller.
+  /// For sockets from a TCP_DEFER_ACCEPT or TCP_FASTOPEN listener,
+  /// which mostly have the request by the time they are accepted.
+  void setReadOnEstablish(bool on)
+  { readOnEstablish_ = on; }
+
+  /// A drained buffer holding more than @c bytes is released.
+  /// 0 (default) keeps buffers as large as they grew.
+  void setBufferReclaimThreshold(size_t bytes)
+  { reclaimThreshold_ = bytes; }
+
+  /// Shrinks buffers to fit if there was no IO during the last
+  /// @c idleIterations iterations of the loop.
+  /// Must be called in loop thread.
+  void reclaimIdleBuffers(int64_t idleIterations);
+
+  /// Bytes allocated by input and output buffers.
+  size_t bufferCapacity() const
+  { return inputBuffer_.internalCapacity() + outputBuffer_.internalCapacity(); }
+
+  /// Counter shared by a group of connections, such as those of a TcpServer,
+  /// kept equal to the sum of their bufferCapacity().
+  /// Call before connectEstablished().
+  void setBufferBytesCounter(const BufferBytesCounterPtr& counter)
+  { bufferBytesCounter_ = counter; }
+
+  /// Force closes the connection after @c readIdleSeconds without input,
+  /// @c writeIdleSeconds without output, or @c lifetimeSeconds after it
+  /// was established, 0 for no limit.  Checked once a second on the loop's
+  /// timingWheel(), so a timeout fires up to one second late.
+  /// Call before connectEstablished().
+  void setIdleTimeouts(int readIdleSeconds, int writeIdleSeconds, int lifetimeSeconds)
+  {
+    readIdleTimeout_ = readIdleSeconds;
+    writeIdleTimeout_ = writeIdleSeconds;
+    maxLifetime_ = lifetimeSeconds;
+  }
+
   /// Internal use only.
   void setCloseCallback(const CloseCallback& cb)
   { closeCallback_ = cb; }
@@ -96,11 +217,55 @@ class TcpConnection : boost::noncopyable,
   //void sendInLoop(string&& message);
   void sendInLoop(const StringPiece& message);
   void sendInLoop(const void* message, size_t len);
+  void sendSharedInLoop(const SharedMessage& message);
+  // what is left goes to outputBuffer_, as for send(StringPiece)
+  void sendCopyInLoop(const SharedMessage& message);
+  /// Leftover of data is queued by reference if @c shared holds data.
+  void sendInLoop(const void* data, size_t len, const SharedMessage& shared);
+  /// Writes outputBuffer_ then sharedOutput_, retrieves what went out.
+  ssize_t writeOutput();
+  size_t outputBytes() const
+  { return outputBuffer_.readableBytes() + sharedOutputBytes_; }
   void shutdownInLoop();
+  void forceCloseInLoop();
   void setState(StateE s) { state_ = s; }
+  void releaseIfDrained(Buffer* buf);
+  void updateBufferBytes();
+  void checkIdleTimeout();
+
+  struct ContextHolder
+  {
+    ContextHolder() : context(NULL), destroy(NULL) { }
+    void* context;
+    void (*destroy)(void*);
+  };
+
+  template<typename T>
+  static void deleteContext(void* context)
+  { boost::checked_delete(static_cast<T*>(context)); }
+
+  struct SharedChunk
+  {
+    SharedChunk(const SharedMessage& msg, size_t off)
+      : message(msg), offset(off)
+    { }
+
+    SharedMessage message;
+    size_t offset;  // bytes already written
+  };
+
+  class IdleEntry : public TimingWheel::Entry
+  {
+   public:
+    explicit IdleEntry(TcpConnection* conn) : conn_(conn) { }
+   private:
+    virtual void onExpire() { conn_->checkIdleTimeout(); }
+    TcpConnection* conn_;
+  };
 
   EventLoop* loop_;
-  string name_;
+  NamePrefixPtr namePrefix_;
+  const int64_t id_;
   StateE state_;  // FIXME: use atomic variable
   // we don't expose those classes to client.
   boost::scoped_ptr<Socket> socket_;
@@ -121,6 +286,25 @@ class TcpConnection : boost::noncopyable,
   size_t highWaterMark_; // ˮλ־ ֹӦò㻺ű
   Buffer inputBuffer_;   // ӦòĽպͷͻ
   Buffer outputBuffer_;  // FIXME: use list<Buffer> as output buffer.
+  // goes out after outputBuffer_, later sends queue here while non-empty
+  std::deque<SharedChunk> sharedOutput_;
+  size_t sharedOutputBytes_;
+  bool leanBuffers_;
+  bool scratchReads_;
+  bool readOnEstablish_;
+  size_t reclaimThreshold_;
+  int64_t lastIoIteration_;
+  BufferBytesCounterPtr bufferBytesCounter_;
+  int64_t countedBufferBytes_;  // last value added to *bufferBytesCounter_
+  int readIdleTimeout_;
+  int writeIdleTimeout_;
+  int maxLifetime_;
+  TimingWheel* timingWheel_;    // NULL without timeouts
+  IdleEntry idleEntry_;
+  int64_t lastReadTick_;        // ticks of timingWheel_
+  int64_t lastWriteTick_;
+  int64_t establishedTick_;
+  ContextHolder contexts_[detail::kMaxContextSlots];
   boost::any context_;   // boostany Ա һδ֪͵Ķ
   // FIXME: creationTime_, lastReceiveTime_
   //        bytesReceived_, bytesSent_
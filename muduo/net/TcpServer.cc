@@ -1,28 +1,138 @@
 #include <muduo/net/TcpServer.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/Acceptor.h>
+#include <muduo/net/Channel.h>
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/EventLoopThreadPool.h>
 #include <muduo/net/SocketsOps.h>
 
 #include <boost/bind.hpp>
 
-#include <stdio.h>  // snprintf
+#include <map>
+
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+const size_t kMinPeerPruneSize = 1024;
+
+typedef std::vector<TcpConnectionPtr> ConnectionList;
+typedef boost::shared_ptr<ConnectionList> ConnectionListPtr;
+
+typedef std::map<EventLoop*, ConnectionListPtr> ConnectionsByLoop;
+
+// one task per io loop, not one per connection
+template<typename ConnectionMap>
+void groupByLoop(const ConnectionMap& connections, ConnectionsByLoop* connsByLoop)
+{
+  for (typename ConnectionMap::const_iterator it(connections.begin());
+      it != connections.end(); ++it)
+  {
+    ConnectionListPtr& conns = (*connsByLoop)[it->second->getLoop()];
+    if (!conns)
+    {
+      conns.reset(new ConnectionList);
+    }
+    conns->push_back(it->second);
+  }
+}
+
+void reclaimIdleBuffersInLoop(const ConnectionListPtr& conns, int64_t idleIterations)
+{
+  for (size_t i = 0; i < conns->size(); ++i)
+  {
+    (*conns)[i]->reclaimIdleBuffers(idleIterations);
+  }
+}
+
+void sendInLoop(const ConnectionListPtr& conns,
+                const TcpConnection::SharedMessage& message)
+{
+  for (size_t i = 0; i < conns->size(); ++i)
+  {
+    (*conns)[i]->send(message);
+  }
+}
+
+}
+
 TcpServer::TcpServer(EventLoop* loop,
                      const InetAddress& listenAddr,
                      const string& nameArg)
   : loop_(CHECK_NOTNULL(loop)),
     hostport_(listenAddr.toIpPort()),
     name_(nameArg),
+    connNamePrefix_(new string(nameArg + ":" + hostport_)),
     acceptor_(new Acceptor(loop, listenAddr)),
     threadPool_(new EventLoopThreadPool(loop)),
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
     started_(false),
+    leanBuffers_(false),
+    scratchReads_(false),
+    readOnEstablish_(false),
+    bufferReclaimThreshold_(0),
+    idleReclaimInterval_(0),
+    idleReclaimIterations_(0),
+    bufferBytes_(new AtomicInt64),
+    readIdleTimeout_(0),
+    writeIdleTimeout_(0),
+    maxLifetime_(0),
+    maxConnections_(0),
+    peerRate_(0),
+    peerBurst_(0),
+    peerPruneSize_(kMinPeerPruneSize),
+    resumeTimerPending_(false),
+    draining_(false),
+    drainTimerPending_(false),
+    handoffFd_(-1),
+    handoffUid_(::geteuid()),
+    nextConnId_(1)
+{
+  acceptor_->setNewConnectionCallback(
+      boost::bind(&TcpServer::newConnection, this, _1, _2));
+}
+
+TcpServer::TcpServer(EventLoop* loop,
+                     int listenfd,
+                     const string& nameArg)
+  : loop_(CHECK_NOTNULL(loop)),
+    hostport_(InetAddress(sockets::getLocalAddr(listenfd)).toIpPort()),
+    name_(nameArg),
+    connNamePrefix_(new string(nameArg + ":" + hostport_)),
+    acceptor_(new Acceptor(loop, listenfd)),
+    threadPool_(new EventLoopThreadPool(loop)),
+    connectionCallback_(defaultConnectionCallback),
+    messageCallback_(defaultMessageCallback),
+    started_(false),
+    leanBuffers_(false),
+    scratchReads_(false),
+    readOnEstablish_(false),
+    bufferReclaimThreshold_(0),
+    idleReclaimInterval_(0),
+    idleReclaimIterations_(0),
+    bufferBytes_(new AtomicInt64),
+    readIdleTimeout_(0),
+    writeIdleTimeout_(0),
+    maxLifetime_(0),
+    maxConnections_(0),
+    peerRate_(0),
+    peerBurst_(0),
+    peerPruneSize_(kMinPeerPruneSize),
+    resumeTimerPending_(false),
+    draining_(false),
+    drainTimerPending_(false),
+    handoffFd_(-1),
+    handoffUid_(::geteuid()),
     nextConnId_(1)
 {
   acceptor_->setNewConnectionCallback(
@@ -33,6 +143,25 @@ TcpServer::~TcpServer()
 {
   loop_->assertInLoopThread();
   LOG_TRACE << "TcpServer::~TcpServer [" << name_ << "] destructing";
+  if (idleReclaimInterval_ > 0 && started_)
+  {
+    loop_->cancel(idleReclaimTimer_);
+  }
+  if (resumeTimerPending_)
+  {
+    loop_->cancel(resumeTimer_);
+  }
+  if (drainTimerPending_)
+  {
+    loop_->cancel(drainTimer_);
+  }
+  if (handoffChannel_)
+  {
+    handoffChannel_->disableAll();
+    handoffChannel_->remove();
+    sockets::close(handoffFd_);
+    ::unlink(handoffPath_.c_str());
+  }
 
   for (ConnectionMap::iterator it(connections_.begin());
       it != connections_.end(); ++it)
@@ -51,12 +180,41 @@ void TcpServer::setThreadNum(int numThreads)
   threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setAcceptBudget(int n)
+{
+  assert(0 < n);
+  acceptor_->setAcceptBudget(n);
+}
+
+void TcpServer::setDeferAccept(int seconds)
+{
+  acceptor_->setDeferAccept(seconds);
+  if (seconds > 0)
+  {
+    readOnEstablish_ = true;
+  }
+}
+
+void TcpServer::setFastOpen(int queueLength)
+{
+  acceptor_->setFastOpen(queueLength);
+  if (queueLength > 0)
+  {
+    readOnEstablish_ = true;
+  }
+}
+
 void TcpServer::start()
 {
   if (!started_)
   {
     started_ = true;
     threadPool_->start(threadInitCallback_);
+    if (idleReclaimInterval_ > 0)
+    {
+      idleReclaimTimer_ = loop_->runEvery(idleReclaimInterval_,
+          boost::bind(&TcpServer::reclaimIdleBuffers, this));
+    }
   }
 
   if (!acceptor_->listenning())
@@ -69,36 +227,52 @@ void TcpServer::start()
 void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
 {
   loop_->assertInLoopThread();
+  if (!admit(peerAddr, Timestamp::now()))
+  {
+    rejectedConnections_.increment();
+    LOG_DEBUG << "TcpServer::newConnection [" << name_
+              << "] - rejected " << peerAddr.toIpPort();
+    sockets::close(sockfd);
+    updateAccepting();
+    return;
+  }
 
   //ֽеķʽѡһEventLoop
   EventLoop* ioLoop = threadPool_->getNextLoop();
-  char buf[32];
-  snprintf(buf, sizeof buf, ":%s#%d", hostport_.c_str(), nextConnId_);
+  int64_t connId = nextConnId_;
   ++nextConnId_;
-  string connName = name_ + buf;
 
   LOG_INFO << "TcpServer::newConnection [" << name_
-           << "] - new connection [" << connName
+           << "] - new connection [" << *connNamePrefix_ << "#" << connId
            << "] from " << peerAddr.toIpPort();
 
   InetAddress localAddr(sockets::getLocalAddr(sockfd));
   // FIXME poll with zero timeout to double confirm the new connection
   // FIXME use make_shared if necessary
   TcpConnectionPtr conn(new TcpConnection(ioLoop,
-                                          connName,
+                                          connNamePrefix_,
+                                          connId,
                                           sockfd,
                                           localAddr,
                                           peerAddr));
 
   // Ӳ뵽б
-  connections_[connName] = conn;
+  connections_[connId] = conn;
+  numConnections_.increment();
 
     // ӵĶдرյȵĻص
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
+  conn->setLeanBuffers(leanBuffers_);
+  conn->setScratchReads(scratchReads_);
+  conn->setReadOnEstablish(readOnEstablish_);
+  conn->setBufferReclaimThreshold(bufferReclaimThreshold_);
+  conn->setBufferBytesCounter(bufferBytes_);
+  conn->setIdleTimeouts(readIdleTimeout_, writeIdleTimeout_, maxLifetime_);
   conn->setCloseCallback(
       boost::bind(&TcpServer::removeConnection, this, _1)); // FIXME: unsafe
+  updateAccepting();
   ioLoop->runInLoop(boost::bind(&TcpConnection::connectEstablished, conn)); // 뵽
 }
 
@@ -113,11 +287,296 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
   loop_->assertInLoopThread();
   LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_
            << "] - connection " << conn->name();
-  size_t n = connections_.erase(conn->name());
+  size_t n = connections_.erase(conn->id());
   (void)n;
   assert(n == 1);
+  numConnections_.decrement();
+  if (acceptor_->paused())
+  {
+    updateAccepting();
+  }
   EventLoop* ioLoop = conn->getLoop();
   ioLoop->queueInLoop( // 첽
       boost::bind(&TcpConnection::connectDestroyed, conn));
+  finishDrainIfEmpty();
 }
 
+
+bool TcpServer::admit(const InetAddress& peerAddr, Timestamp now)
+{
+  if (maxConnections_ > 0
+      && connections_.size() >= static_cast<size_t>(maxConnections_))
+  {
+    return false;
+  }
+  if (!acceptBucket_.consume(now))
+  {
+    return false;
+  }
+  if (peerRate_ > 0)
+  {
+    if (peerBuckets_.size() >= peerPruneSize_)
+    {
+      prunePeerBuckets(now);
+    }
+    PeerBucketMap::iterator it = peerBuckets_.find(peerAddr.ipNetEndian());
+    if (it == peerBuckets_.end())
+    {
+      it = peerBuckets_.insert(std::make_pair(peerAddr.ipNetEndian(),
+                                              TokenBucket(peerRate_, peerBurst_, now))).first;
+    }
+    if (!it->second.consume(now))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TcpServer::prunePeerBuckets(Timestamp now)
+{
+  // a full bucket is as good as a new one
+  for (PeerBucketMap::iterator it = peerBuckets_.begin(); it != peerBuckets_.end(); )
+  {
+    if (it->second.full(now))
+    {
+      it = peerBuckets_.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  peerPruneSize_ = std::max(kMinPeerPruneSize, 2*peerBuckets_.size());
+}
+
+// Stops polling the listen socket while over the connection limit or out
+// of accept tokens, so overload backs up into the kernel backlog instead of
+// keeping the base loop busy accepting and closing.
+void TcpServer::updateAccepting()
+{
+  loop_->assertInLoopThread();
+  const bool full = maxConnections_ > 0
+      && connections_.size() >= static_cast<size_t>(maxConnections_);
+  const double wait = acceptBucket_.waitTime(Timestamp::now());
+  if (full || wait > 0)
+  {
+    acceptor_->pause();
+    if (!full && !resumeTimerPending_)
+    {
+      resumeTimerPending_ = true;
+      resumeTimer_ = loop_->runAfter(wait,
+          boost::bind(&TcpServer::resumeAccepting, this));
+    }
+  }
+  else
+  {
+    acceptor_->resume();
+  }
+}
+
+bool TcpServer::acceptPaused() const
+{
+  loop_->assertInLoopThread();
+  return acceptor_->paused();
+}
+
+void TcpServer::resumeAccepting()
+{
+  resumeTimerPending_ = false;
+  updateAccepting();
+}
+
+void TcpServer::reclaimIdleBuffers()
+{
+  loop_->assertInLoopThread();
+  ConnectionsByLoop connsByLoop;
+  groupByLoop(connections_, &connsByLoop);
+  for (ConnectionsByLoop::iterator it(connsByLoop.begin());
+      it != connsByLoop.end(); ++it)
+  {
+    it->first->runInLoop(
+        boost::bind(&reclaimIdleBuffersInLoop, it->second, idleReclaimIterations_));
+  }
+}
+
+void TcpServer::broadcast(const StringPiece& message)
+{
+  broadcast(TcpConnection::SharedMessage(new string(message.data(), message.size())));
+}
+
+void TcpServer::broadcast(const TcpConnection::SharedMessage& message)
+{
+  loop_->runInLoop(
+      boost::bind(&TcpServer::broadcastInLoop, this, message)); // FIXME: unsafe
+}
+
+void TcpServer::broadcastInLoop(const TcpConnection::SharedMessage& message)
+{
+  loop_->assertInLoopThread();
+  ConnectionsByLoop connsByLoop;
+  groupByLoop(connections_, &connsByLoop);
+  for (ConnectionsByLoop::iterator it(connsByLoop.begin());
+      it != connsByLoop.end(); ++it)
+  {
+    it->first->runInLoop(boost::bind(&sendInLoop, it->second, message));
+  }
+}
+
+void TcpServer::drain(double seconds, const DrainCallback& cb)
+{
+  loop_->runInLoop(
+      boost::bind(&TcpServer::drainInLoop, this, seconds, cb)); // FIXME: unsafe
+}
+
+void TcpServer::drainInLoop(double seconds, const DrainCallback& cb)
+{
+  loop_->assertInLoopThread();
+  if (draining_)
+  {
+    return;
+  }
+  LOG_INFO << "TcpServer::drain [" << name_ << "] - "
+           << connections_.size() << " connections";
+  draining_ = true;
+  drainCallback_ = cb;
+  acceptor_->stop();
+  if (resumeTimerPending_)
+  {
+    loop_->cancel(resumeTimer_);
+    resumeTimerPending_ = false;
+  }
+  if (!connections_.empty())
+  {
+    drainTimerPending_ = true;
+    drainTimer_ = loop_->runAfter(seconds,
+        boost::bind(&TcpServer::forceCloseAll, this));
+  }
+  finishDrainIfEmpty();
+}
+
+void TcpServer::finishDrainIfEmpty()
+{
+  if (draining_ && connections_.empty() && drainCallback_)
+  {
+    if (drainTimerPending_)
+    {
+      loop_->cancel(drainTimer_);
+      drainTimerPending_ = false;
+    }
+    LOG_INFO << "TcpServer::drain [" << name_ << "] - done";
+    DrainCallback cb;
+    cb.swap(drainCallback_);
+    cb();
+  }
+}
+
+void TcpServer::forceCloseAll()
+{
+  drainTimerPending_ = false;
+  LOG_WARN << "TcpServer::drain [" << name_ << "] - force closing "
+           << connections_.size() << " connections";
+  for (ConnectionMap::iterator it(connections_.begin());
+      it != connections_.end(); ++it)
+  {
+    it->second->forceClose();
+  }
+}
+
+void TcpServer::enableHandoff(const string& path, const HandoffCallback& cb)
+{
+  loop_->assertInLoopThread();
+  assert(!handoffChannel_);
+  struct sockaddr_un addr;
+  bzero(&addr, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof addr.sun_path)
+  {
+    LOG_FATAL << "TcpServer::enableHandoff - path too long " << path;
+  }
+  memcpy(addr.sun_path, path.c_str(), path.size());
+  ::unlink(path.c_str());
+  handoffFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  // nobody can connect before listen(), so chmod() leaves no window,
+  // unlike a process-wide umask()
+  if (handoffFd_ < 0
+      || ::bind(handoffFd_, static_cast<struct sockaddr*>(implicit_cast<void*>(&addr)),
+                sizeof addr) < 0
+      || ::chmod(path.c_str(), 0600) < 0
+      || ::listen(handoffFd_, SOMAXCONN) < 0)
+  {
+    LOG_SYSFATAL << "TcpServer::enableHandoff " << path;
+  }
+  handoffPath_ = path;
+  handoffCallback_ = cb;
+  handoffChannel_.reset(new Channel(loop_, handoffFd_));
+  handoffChannel_->setReadCallback(boost::bind(&TcpServer::handleHandoff, this));
+  handoffChannel_->enableReading();
+}
+
+void TcpServer::handleHandoff()
+{
+  loop_->assertInLoopThread();
+  int connfd = ::accept4(handoffFd_, NULL, NULL, SOCK_CLOEXEC);
+  if (connfd < 0)
+  {
+    LOG_SYSERR << "TcpServer::handleHandoff";
+    return;
+  }
+  struct ucred cred;
+  socklen_t credLen = sizeof cred;
+  if (::getsockopt(connfd, SOL_SOCKET, SO_PEERCRED, &cred, &credLen) < 0)
+  {
+    LOG_SYSERR << "TcpServer::handleHandoff - SO_PEERCRED";
+    sockets::close(connfd);
+    return;
+  }
+  if (cred.uid != handoffUid_)
+  {
+    LOG_WARN << "TcpServer::handleHandoff [" << name_ << "] - refused pid "
+             << cred.pid << " uid " << cred.uid;
+    sockets::close(connfd);
+    return;
+  }
+  // blocking, the peer is waiting for it
+  bool sent = sockets::sendFd(connfd, acceptor_->fd());
+  sockets::close(connfd);
+  if (sent)
+  {
+    LOG_INFO << "TcpServer::handleHandoff [" << name_ << "] - listen socket handed off";
+    if (handoffCallback_)
+    {
+      handoffCallback_();
+    }
+  }
+}
+
+int TcpServer::takeOverListenFd(const string& path)
+{
+  struct sockaddr_un addr;
+  bzero(&addr, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof addr.sun_path)
+  {
+    return -1;
+  }
+  memcpy(addr.sun_path, path.c_str(), path.size());
+  int sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sockfd < 0)
+  {
+    LOG_SYSERR << "TcpServer::takeOverListenFd";
+    return -1;
+  }
+  int listenfd = -1;
+  if (::connect(sockfd, static_cast<struct sockaddr*>(implicit_cast<void*>(&addr)),
+                sizeof addr) == 0)
+  {
+    listenfd = sockets::recvFd(sockfd);
+  }
+  else
+  {
+    LOG_INFO << "TcpServer::takeOverListenFd - no server at " << path;
+  }
+  sockets::close(sockfd);
+  return listenfd;
+}
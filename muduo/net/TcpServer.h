@@ -3,10 +3,14 @@
 
 #include <muduo/base/Types.h>
 #include <muduo/net/TcpConnection.h>
+#include <muduo/net/TimerId.h>
+#include <muduo/net/TokenBucket.h>
 
-#include <map>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <sys/types.h>
 
 namespace muduo
 {
@@ -14,6 +18,7 @@ namespace net
 {
 
 class Acceptor;
+class Channel;
 class EventLoop;
 class EventLoopThreadPool;
 
@@ -22,11 +27,18 @@ class TcpServer : boost::noncopyable
 {
  public:
   typedef boost::function<void(EventLoop*)> ThreadInitCallback;
+  typedef boost::function<void()> DrainCallback;
+  typedef boost::function<void()> HandoffCallback;
 
   //TcpServer(EventLoop* loop, const InetAddress& listenAddr);
   TcpServer(EventLoop* loop,
             const InetAddress& listenAddr,
             const string& nameArg);
+  /// Serves on @c listenfd, a bound and listening socket,
+  /// e.g. from takeOverListenFd().
+  TcpServer(EventLoop* loop,
+            int listenfd,
+            const string& nameArg);
   ~TcpServer();  // force out-line dtor, for scoped_ptr members.
 
   const string& hostport() const { return hostport_; }
@@ -55,6 +67,123 @@ class TcpServer : boost::noncopyable
   void setWriteCompleteCallback(const WriteCompleteCallback& cb)
   { writeCompleteCallback_ = cb; }
 
+  /// Buffer memory policy of new connections,
+  /// see TcpConnection::setLeanBuffers().
+  /// Not thread safe.
+  void setLeanBuffers(bool on)
+  { leanBuffers_ = on; }
+
+  /// See TcpConnection::setScratchReads().
+  /// Not thread safe.
+  void setScratchReads(bool on)
+  { scratchReads_ = on; }
+
+  /// See TcpConnection::setBufferReclaimThreshold().
+  /// Not thread safe.
+  void setBufferReclaimThreshold(size_t bytes)
+  { bufferReclaimThreshold_ = bytes; }
+
+  /// Every @c interval seconds, shrinks buffers of connections
+  /// which had no IO during the last @c idleIterations loop iterations.
+  /// Call before start(). Not thread safe.
+  void setIdleBufferReclaim(double interval, int64_t idleIterations)
+  { idleReclaimInterval_ = interval; idleReclaimIterations_ = idleIterations; }
+
+  /// Bytes held by buffers of all connections.
+  /// Thread safe.
+  int64_t bufferBytes() const
+  { return bufferBytes_->get(); }
+
+  /// Thread safe.
+  int numConnections() const
+  { return numConnections_.get(); }
+
+  /// Closes connections that received nothing for @c seconds,
+  /// see TcpConnection::setIdleTimeouts().
+  /// Not thread safe.
+  void setReadIdleTimeout(int seconds)
+  { readIdleTimeout_ = seconds; }
+
+  /// Closes connections that sent nothing for @c seconds.
+  /// Not thread safe.
+  void setWriteIdleTimeout(int seconds)
+  { writeIdleTimeout_ = seconds; }
+
+  /// Closes connections @c seconds after they were established.
+  /// Not thread safe.
+  void setMaxLifetime(int seconds)
+  { maxLifetime_ = seconds; }
+
+  /// Stops accepting at @c n live connections, resumes when one closes;
+  /// further clients wait in the listen backlog.  0 for no limit.
+  /// Not thread safe.
+  void setMaxConnections(int n)
+  { maxConnections_ = n; }
+
+  /// Accepts no more than @c rate connections per second,
+  /// in bursts of @c burst.  The listen socket is not polled meanwhile.
+  /// Not thread safe.
+  void setAcceptRate(double rate, double burst)
+  { acceptBucket_ = TokenBucket(rate, burst, Timestamp::now()); }
+
+  /// Connections from one IP beyond @c rate per second, in bursts of
+  /// @c burst, are closed right after accept.
+  /// Not thread safe.
+  void setPerPeerRate(double rate, double burst)
+  { peerRate_ = rate; peerBurst_ = burst; }
+
+  /// Connections accepted per poll of the listen socket, default 1.
+  /// Not thread safe.
+  void setAcceptBudget(int n);
+
+  /// TCP_DEFER_ACCEPT, a connection is accepted when its first data
+  /// arrives (or after @c seconds), and read right when established.
+  /// Call before start().
+  void setDeferAccept(int seconds);
+
+  /// TCP_FASTOPEN with @c queueLength pending requests, the first data
+  /// arrives with the SYN and is read right when established.
+  /// Call before start().
+  void setFastOpen(int queueLength);
+
+  /// Connections closed by admission control.
+  /// Thread safe.
+  int64_t rejectedConnections() const
+  { return rejectedConnections_.get(); }
+
+  /// Whether admission control stopped polling the listen socket.
+  /// Must be called in loop thread.
+  bool acceptPaused() const;
+
+  /// Sends @c message to every connection.  It is copied once into an
+  /// immutable buffer, each IO loop gets one task, and each connection
+  /// queues a reference to that buffer for what it can't write at once.
+  /// Thread safe.
+  void broadcast(const StringPiece& message);
+  void broadcast(const TcpConnection::SharedMessage& message);
+
+  /// Stops accepting for good and waits for the connections to close,
+  /// force closing the rest after @c seconds.  @c cb runs in loop when
+  /// no connection is left.
+  /// Thread safe.
+  void drain(double seconds, const DrainCallback& cb);
+  bool draining() const { return draining_; }
+
+  /// Hands the listen socket to a process calling takeOverListenFd()
+  /// on the Unix socket @c path, then runs @c cb, which usually drain()s.
+  /// @c path is created with mode 0600, and only a peer running as the
+  /// handoff uid gets the socket.
+  /// Must be called in loop thread, after start().
+  void enableHandoff(const string& path, const HandoffCallback& cb);
+
+  /// Uid a handoff peer must run as, default the effective uid of this process.
+  /// Not thread safe.
+  void setHandoffUid(uid_t uid) { handoffUid_ = uid; }
+
+  /// Fetches the listen socket of a server with enableHandoff(@c path).
+  /// Blocking, returns -1 if no server is there.
+  static int takeOverListenFd(const string& path);
+
  private:
   /// Not thread safe, but in loop
   void newConnection(int sockfd, const InetAddress& peerAddr);
@@ -62,13 +191,30 @@ class TcpServer : boost::noncopyable
   void removeConnection(const TcpConnectionPtr& conn);
   /// Not thread safe, but in loop
   void removeConnectionInLoop(const TcpConnectionPtr& conn);
+  /// Not thread safe, but in loop
+  void reclaimIdleBuffers();
+  /// Not thread safe, but in loop
+  void broadcastInLoop(const TcpConnection::SharedMessage& message);
+  /// Not thread safe, but in loop
+  bool admit(const InetAddress& peerAddr, Timestamp now);
+  void prunePeerBuckets(Timestamp now);
+  void updateAccepting();
+  void resumeAccepting();
+  /// Not thread safe, but in loop
+  void drainInLoop(double seconds, const DrainCallback& cb);
+  void finishDrainIfEmpty();
+  void forceCloseAll();
+  void handleHandoff();
+
+  typedef boost::unordered_map<uint32_t, TokenBucket> PeerBucketMap;  // by ipNetEndian()
 
-  // typedef boost::shared_ptr<TcpConnection> TcpConnectionPtr;
-  typedef std::map<string, TcpConnectionPtr> ConnectionMap; // ͻбmap
+  // keyed by TcpConnection::id(), no per-connection string is built
+  typedef boost::unordered_map<int64_t, TcpConnectionPtr> ConnectionMap; // ͻбmap
 
   EventLoop* loop_;        // the acceptor loop
   const string hostport_;
   const string name_;
+  const TcpConnection::NamePrefixPtr connNamePrefix_;  // "name:hostport"
   
   boost::scoped_ptr<Acceptor> acceptor_; // avoid revealing Acceptor
   
@@ -78,8 +224,38 @@ class TcpServer : boost::noncopyable
   WriteCompleteCallback writeCompleteCallback_;
   ThreadInitCallback    threadInitCallback_;
   bool started_;
+  bool leanBuffers_;
+  bool scratchReads_;
+  bool readOnEstablish_;
+  size_t bufferReclaimThreshold_;
+  double idleReclaimInterval_;
+  int64_t idleReclaimIterations_;
+  TimerId idleReclaimTimer_;
+  const TcpConnection::BufferBytesCounterPtr bufferBytes_;
+  mutable AtomicInt32 numConnections_;
+  int readIdleTimeout_;
+  int writeIdleTimeout_;
+  int maxLifetime_;
+  int maxConnections_;
+  TokenBucket acceptBucket_;
+  double peerRate_;
+  double peerBurst_;
+  PeerBucketMap peerBuckets_;
+  size_t peerPruneSize_;       // prune full buckets when there are this many
+  bool resumeTimerPending_;
+  TimerId resumeTimer_;
+  mutable AtomicInt64 rejectedConnections_;
+  bool draining_;
+  DrainCallback drainCallback_;  // emptied when called
+  bool drainTimerPending_;
+  TimerId drainTimer_;
+  string handoffPath_;
+  int handoffFd_;
+  boost::scoped_ptr<Channel> handoffChannel_;
+  HandoffCallback handoffCallback_;
+  uid_t handoffUid_;
   // always in loop thread
-  int nextConnId_;            // һid
+  int64_t nextConnId_;            // һid
   ConnectionMap connections_; // бmap
 };
 
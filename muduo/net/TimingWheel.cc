@@ -0,0 +1,85 @@
+#include <muduo/net/TimingWheel.h>
+
+#include <muduo/net/EventLoop.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int TimingWheel::kBuckets;
+
+TimingWheel::TimingWheel(EventLoop* loop, double tickSeconds)
+  : loop_(loop),
+    tickSeconds_(tickSeconds),
+    now_(0),
+    size_(0),
+    buckets_(kBuckets)
+{
+  loop_->runEvery(tickSeconds_, boost::bind(&TimingWheel::tick, this));
+}
+
+void TimingWheel::insert(Entry* entry, int64_t ticks)
+{
+  loop_->assertInLoopThread();
+  if (entry->linked())
+  {
+    unlink(entry);
+  }
+  ticks = std::max(std::min(ticks, implicit_cast<int64_t>(kBuckets)),
+                   implicit_cast<int64_t>(1));
+  link(entry, &buckets_[static_cast<size_t>((now_ + ticks) % kBuckets)]);
+}
+
+void TimingWheel::remove(Entry* entry)
+{
+  loop_->assertInLoopThread();
+  if (entry->linked())
+  {
+    unlink(entry);
+  }
+}
+
+void TimingWheel::tick()
+{
+  ++now_;
+  // detach the bucket first, onExpire() may link entries into it again
+  Entry* expired = buckets_[static_cast<size_t>(now_ % kBuckets)];
+  buckets_[static_cast<size_t>(now_ % kBuckets)] = NULL;
+  if (expired)
+  {
+    expired->pprev_ = &expired;
+  }
+  while (expired)
+  {
+    Entry* entry = expired;
+    unlink(entry);
+    entry->onExpire();
+  }
+}
+
+void TimingWheel::link(Entry* entry, Entry** head)
+{
+  entry->next_ = *head;
+  if (*head)
+  {
+    (*head)->pprev_ = &entry->next_;
+  }
+  *head = entry;
+  entry->pprev_ = head;
+  ++size_;
+}
+
+void TimingWheel::unlink(Entry* entry)
+{
+  *entry->pprev_ = entry->next_;
+  if (entry->next_)
+  {
+    entry->next_->pprev_ = entry->pprev_;
+  }
+  entry->next_ = NULL;
+  entry->pprev_ = NULL;
+  --size_;
+}
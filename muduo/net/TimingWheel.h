@@ -0,0 +1,79 @@
+#ifndef MUDUO_NET_TIMINGWHEEL_H
+#define MUDUO_NET_TIMINGWHEEL_H
+
+#include <muduo/base/Types.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <vector>
+
+#include <assert.h>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+
+///
+/// Coarse timeouts for many objects of one loop, see EventLoop::timingWheel().
+///
+/// Entries are intrusive, linking and unlinking never allocate.
+/// When the bucket of an entry comes due, the entry is unlinked and its
+/// onExpire() called, which may link it again.  So an owner records
+/// activity as a tick number and checks it in onExpire(), instead of
+/// moving the entry on every event.
+/// Must be used in loop thread.
+class TimingWheel : boost::noncopyable
+{
+ public:
+  class Entry : boost::noncopyable
+  {
+   public:
+    Entry() : next_(NULL), pprev_(NULL) { }
+    bool linked() const { return pprev_ != NULL; }
+
+   protected:
+    ~Entry() { assert(!linked()); }
+
+   private:
+    friend class TimingWheel;
+    virtual void onExpire() = 0;
+
+    Entry* next_;
+    Entry** pprev_;  // points to the pointer pointing to this entry
+  };
+
+  static const int kBuckets = 64;
+
+  /// Owned by @c loop, ticks until the loop is destroyed.
+  TimingWheel(EventLoop* loop, double tickSeconds);
+
+  /// Ticks since this wheel was created.
+  int64_t now() const { return now_; }
+  double tickSeconds() const { return tickSeconds_; }
+  size_t size() const { return size_; }
+
+  /// Links @c entry to expire @c ticks from now, relinks if already linked.
+  /// More than kBuckets ticks ahead expires after kBuckets ticks,
+  /// onExpire() shall link it again.
+  void insert(Entry* entry, int64_t ticks);
+  void remove(Entry* entry);
+
+ private:
+  void tick();
+  void link(Entry* entry, Entry** head);
+  void unlink(Entry* entry);
+
+  EventLoop* loop_;
+  const double tickSeconds_;
+  int64_t now_;
+  size_t size_;
+  std::vector<Entry*> buckets_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_TIMINGWHEEL_H
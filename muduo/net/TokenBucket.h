@@ -0,0 +1,93 @@
+#ifndef MUDUO_NET_TOKENBUCKET_H
+#define MUDUO_NET_TOKENBUCKET_H
+
+#include <muduo/base/copyable.h>
+#include <muduo/base/Timestamp.h>
+
+#include <algorithm>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Rate limiter, refilled at @c rate tokens per second up to @c burst.
+///
+/// A default constructed bucket is disabled and never runs dry.
+/// Not thread safe.
+class TokenBucket : public muduo::copyable
+{
+ public:
+  TokenBucket()
+    : rate_(0),
+      burst_(0),
+      tokens_(0)
+  {
+  }
+
+  TokenBucket(double rate, double burst, Timestamp now)
+    : rate_(rate),
+      burst_(std::max(burst, 1.0)),
+      tokens_(burst_),
+      last_(now)
+  {
+  }
+
+  bool enabled() const { return rate_ > 0; }
+
+  /// Takes a token, returns false if there is none.
+  bool consume(Timestamp now)
+  {
+    if (!enabled())
+    {
+      return true;
+    }
+    refill(now);
+    if (tokens_ >= 1.0)
+    {
+      tokens_ -= 1.0;
+      return true;
+    }
+    return false;
+  }
+
+  /// Seconds until a token is available, 0 if there is one.
+  double waitTime(Timestamp now) const
+  {
+    if (!enabled())
+    {
+      return 0;
+    }
+    double tokens = available(now);
+    return tokens >= 1.0 ? 0 : (1.0 - tokens) / rate_;
+  }
+
+  /// Back to @c burst tokens, so forgetting this bucket changes nothing.
+  bool full(Timestamp now) const
+  {
+    return available(now) >= burst_;
+  }
+
+ private:
+  double available(Timestamp now) const
+  {
+    return std::min(burst_, tokens_ + timeDifference(now, last_) * rate_);
+  }
+
+  void refill(Timestamp now)
+  {
+    tokens_ = available(now);
+    last_ = now;
+  }
+
+  double rate_;
+  double burst_;
+  double tokens_;
+  Timestamp last_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_TOKENBUCKET_H
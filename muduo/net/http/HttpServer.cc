@@ -19,6 +19,11 @@
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+const ContextSlot<HttpContext> kHttpContext;
+}
+
 namespace muduo
 {
 namespace net
@@ -161,8 +166,7 @@ void HttpServer::onConnection(const TcpConnectionPtr& conn)
 {
   if (conn->connected())
   {
-    conn->setContext(HttpContext()); // boost::any Խ͵
-    // TcpConnectionһhttpContext
+    conn->setContext(kHttpContext, new HttpContext); // parser state, reused for each request
   }
 }
 
@@ -170,7 +174,7 @@ void HttpServer::onMessage(const TcpConnectionPtr& conn,
                            Buffer* buf,
                            Timestamp receiveTime)
 {
-  HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext()); // Ըıany
+  HttpContext* context = conn->getContext(kHttpContext);
 
   if (!detail::parseRequest(buf, context, receiveTime))
   {
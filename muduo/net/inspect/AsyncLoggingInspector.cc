@@ -0,0 +1,51 @@
+#include <muduo/net/inspect/AsyncLoggingInspector.h>
+#include <muduo/base/AsyncLogging.h>
+
+#include <boost/bind.hpp>
+#include <stdio.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void AsyncLoggingInspector::registerCommands(Inspector* ins,
+                                             const string& module,
+                                             AsyncLogging* log)
+{
+  ins->add(module, "stats", boost::bind(AsyncLoggingInspector::stats, log, _1, _2),
+           "print memory budget, pending bytes and free buffers");
+  ins->add(module, "dropped", boost::bind(AsyncLoggingInspector::dropped, log, _1, _2),
+           "print dropped lines and bytes per level");
+}
+
+string AsyncLoggingInspector::stats(AsyncLogging* log, HttpRequest::Method, const Inspector::ArgList&)
+{
+  const char* blockLevel = log->blockLevel() < Logger::NUM_LOG_LEVELS
+      ? Logger::levelName(log->blockLevel()) : "NONE";
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "memory_budget %zu\npending_bytes %zu\nfree_buffers %zu\n"
+           "block_level %.*s\nblocked_lines %lld\n",
+           log->memoryBudget(),
+           log->pendingBytes(),
+           log->numFreeBuffers(),
+           static_cast<int>(strcspn(blockLevel, " ")), blockLevel,
+           static_cast<long long>(log->blockedLines()));
+  return buf;
+}
+
+string AsyncLoggingInspector::dropped(AsyncLogging* log, HttpRequest::Method, const Inspector::ArgList&)
+{
+  string result;
+  char buf[256];
+  for (int i = 0; i < Logger::NUM_LOG_LEVELS; ++i)
+  {
+    Logger::LogLevel level = static_cast<Logger::LogLevel>(i);
+    snprintf(buf, sizeof buf, "%-5.5s lines %lld bytes %lld\n",
+             Logger::levelName(level),
+             static_cast<long long>(log->droppedLines(level)),
+             static_cast<long long>(log->droppedBytes(level)));
+    result += buf;
+  }
+  return result;
+}
@@ -0,0 +1,32 @@
+#ifndef MUDUO_NET_INSPECT_ASYNCLOGGINGINSPECTOR_H
+#define MUDUO_NET_INSPECT_ASYNCLOGGINGINSPECTOR_H
+
+#include <muduo/net/inspect/Inspector.h>
+#include <boost/noncopyable.hpp>
+
+namespace muduo
+{
+
+class AsyncLogging;
+
+namespace net
+{
+
+// Commands of an AsyncLogging, under /module/
+//   stats    memory budget, pending bytes, free buffers, blocked lines
+//   dropped  dropped lines and bytes per level
+// The log must outlive the inspector.
+class AsyncLoggingInspector : boost::noncopyable
+{
+ public:
+  static void registerCommands(Inspector* ins, const string& module, AsyncLogging* log);
+
+ private:
+  static string stats(AsyncLogging* log, HttpRequest::Method, const Inspector::ArgList&);
+  static string dropped(AsyncLogging* log, HttpRequest::Method, const Inspector::ArgList&);
+};
+
+}
+}
+
+#endif  // MUDUO_NET_INSPECT_ASYNCLOGGINGINSPECTOR_H
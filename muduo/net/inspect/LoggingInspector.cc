@@ -0,0 +1,82 @@
+#include <muduo/net/inspect/LoggingInspector.h>
+#include <muduo/base/Logging.h>
+
+#include <boost/bind.hpp>
+#include <string.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// "INFO", without the padding
+string levelName(Logger::LogLevel level)
+{
+  const char* name = Logger::levelName(level);
+  return string(name, strcspn(name, " "));
+}
+
+// NUM_LOG_LEVELS if not a level name
+Logger::LogLevel parseLevel(const string& name)
+{
+  for (int i = 0; i < Logger::NUM_LOG_LEVELS; ++i)
+  {
+    Logger::LogLevel level = static_cast<Logger::LogLevel>(i);
+    if (::strcasecmp(name.c_str(), levelName(level).c_str()) == 0)
+    {
+      return level;
+    }
+  }
+  return Logger::NUM_LOG_LEVELS;
+}
+
+}
+
+void LoggingInspector::registerCommands(Inspector* ins, const string& module)
+{
+  ins->add(module, "level", boost::bind(LoggingInspector::level, _1, _2),
+           "print or set the process wide log level");
+  ins->add(module, "modules", boost::bind(LoggingInspector::modules, _1, _2),
+           "print or set log levels of directories and source files");
+}
+
+string LoggingInspector::level(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  if (!args.empty())
+  {
+    Logger::LogLevel level = parseLevel(args[0]);
+    if (level == Logger::NUM_LOG_LEVELS)
+    {
+      return "unknown level " + args[0] + "\n";
+    }
+    Logger::setLogLevel(level);
+  }
+  return levelName(Logger::logLevel()) + "\n";
+}
+
+string LoggingInspector::modules(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  if (args.size() == 2)
+  {
+    if (args[1] == "reset")
+    {
+      Logger::resetModuleLogLevel(args[0]);
+    }
+    else
+    {
+      Logger::LogLevel level = parseLevel(args[1]);
+      if (level == Logger::NUM_LOG_LEVELS)
+      {
+        return "unknown level " + args[1] + "\n";
+      }
+      Logger::setModuleLogLevel(args[0], level);
+    }
+  }
+  else if (!args.empty())
+  {
+    return "usage: modules[/module/LEVEL|reset]\n";
+  }
+  return Logger::moduleLogLevels();
+}
@@ -0,0 +1,31 @@
+#ifndef MUDUO_NET_INSPECT_LOGGINGINSPECTOR_H
+#define MUDUO_NET_INSPECT_LOGGINGINSPECTOR_H
+
+#include <muduo/net/inspect/Inspector.h>
+#include <boost/noncopyable.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+// Log levels of the process, under /module/
+//   level                  print the process wide level
+//   level/DEBUG            set it
+//   modules                print the module levels
+//   modules/net/DEBUG      set the level of a directory or source file
+//   modules/net/reset      back to the process wide level
+class LoggingInspector : boost::noncopyable
+{
+ public:
+  static void registerCommands(Inspector* ins, const string& module);
+
+ private:
+  static string level(HttpRequest::Method, const Inspector::ArgList&);
+  static string modules(HttpRequest::Method, const Inspector::ArgList&);
+};
+
+}
+}
+
+#endif  // MUDUO_NET_INSPECT_LOGGINGINSPECTOR_H
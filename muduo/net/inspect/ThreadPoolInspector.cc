@@ -0,0 +1,43 @@
+#include <muduo/net/inspect/ThreadPoolInspector.h>
+#include <muduo/base/ThreadPool.h>
+
+#include <boost/bind.hpp>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void ThreadPoolInspector::registerCommands(Inspector* ins,
+                                           const string& module,
+                                           ThreadPool* pool)
+{
+  ins->add(module, "stats", boost::bind(ThreadPoolInspector::stats, pool, _1, _2),
+           "print queue size and rejected tasks");
+  ins->add(module, "queue_time", boost::bind(ThreadPoolInspector::queueTime, pool, _1, _2),
+           "histogram of time in queue");
+  ins->add(module, "run_time", boost::bind(ThreadPoolInspector::runTime, pool, _1, _2),
+           "histogram of task run time");
+}
+
+string ThreadPoolInspector::stats(ThreadPool* pool, HttpRequest::Method, const Inspector::ArgList&)
+{
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "name %s\nqueue_size %zu\nmax_queue_size %d\nrejected %lld\ncompleted %lld\n",
+           pool->name().c_str(),
+           pool->queueSize(),
+           pool->maxQueueSize(),
+           static_cast<long long>(pool->numRejected()),
+           static_cast<long long>(pool->runTime().count()));
+  return buf;
+}
+
+string ThreadPoolInspector::queueTime(ThreadPool* pool, HttpRequest::Method, const Inspector::ArgList&)
+{
+  return pool->queueTime().toString();
+}
+
+string ThreadPoolInspector::runTime(ThreadPool* pool, HttpRequest::Method, const Inspector::ArgList&)
+{
+  return pool->runTime().toString();
+}
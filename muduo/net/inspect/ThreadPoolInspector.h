@@ -0,0 +1,34 @@
+#ifndef MUDUO_NET_INSPECT_THREADPOOLINSPECTOR_H
+#define MUDUO_NET_INSPECT_THREADPOOLINSPECTOR_H
+
+#include <muduo/net/inspect/Inspector.h>
+#include <boost/noncopyable.hpp>
+
+namespace muduo
+{
+
+class ThreadPool;
+
+namespace net
+{
+
+// Commands of a ThreadPool, under /module/
+//   stats       queue size, max queue size, rejected tasks
+//   queue_time  histogram of run() to start, in us
+//   run_time    histogram of task run time, in us
+// The pool must outlive the inspector.
+class ThreadPoolInspector : boost::noncopyable
+{
+ public:
+  static void registerCommands(Inspector* ins, const string& module, ThreadPool* pool);
+
+ private:
+  static string stats(ThreadPool* pool, HttpRequest::Method, const Inspector::ArgList&);
+  static string queueTime(ThreadPool* pool, HttpRequest::Method, const Inspector::ArgList&);
+  static string runTime(ThreadPool* pool, HttpRequest::Method, const Inspector::ArgList&);
+};
+
+}
+}
+
+#endif  // MUDUO_NET_INSPECT_THREADPOOLINSPECTOR_H
@@ -1,4 +1,7 @@
 #include <muduo/net/inspect/Inspector.h>
+#include <muduo/net/inspect/LoggingInspector.h>
+#include <muduo/net/inspect/ThreadPoolInspector.h>
+#include <muduo/base/ThreadPool.h>
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/EventLoopThread.h>
 
@@ -10,6 +13,10 @@ int main()
   EventLoop loop;
   EventLoopThread t;
   Inspector ins(t.startLoop(), InetAddress(12345), "test");
+  ThreadPool pool("pool");
+  pool.start(2);
+  ThreadPoolInspector::registerCommands(&ins, "pool", &pool);
+  LoggingInspector::registerCommands(&ins, "log");
   loop.loop();
 }
 
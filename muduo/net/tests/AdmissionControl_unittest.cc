@@ -0,0 +1,154 @@
+#include <muduo/net/TcpServer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/SocketsOps.h>
+#include <muduo/base/Logging.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Admission control of TcpServer: the connection cap pauses the listen
+// socket instead of rejecting, per IP rates reject, and the accept rate
+// spaces accepts out.
+
+struct Stats
+{
+  Stats() : accepted(0), sawPaused(false) {}
+
+  int accepted;
+  bool sawPaused;
+  std::vector<TcpConnectionPtr> live;
+  std::vector<Timestamp> times;
+};
+
+std::vector<int> g_clients;
+
+void onConnection(TcpServer* server, Stats* stats, const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    ++stats->accepted;
+    stats->live.push_back(conn);
+    stats->times.push_back(Timestamp::now());
+    stats->sawPaused = stats->sawPaused || server->acceptPaused();
+  }
+  else
+  {
+    stats->live.erase(std::find(stats->live.begin(), stats->live.end(), conn));
+  }
+}
+
+// blocking, completes in the listen backlog whether or not we accept
+void connectClients(uint16_t port, int n)
+{
+  InetAddress addr("127.0.0.1", port);
+  for (int i = 0; i < n; ++i)
+  {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    int ret = sockets::connect(fd, addr.getSockAddrInet());
+    assert(ret == 0); (void)ret;
+    g_clients.push_back(fd);
+  }
+}
+
+TcpServer* g_capped;
+Stats g_cappedStats;
+TcpServer* g_perPeer;
+Stats g_perPeerStats;
+TcpServer* g_rated;
+Stats g_ratedStats;
+
+void checkCapReached()
+{
+  assert(g_cappedStats.accepted == 3);
+  assert(g_capped->acceptPaused());
+  assert(g_capped->rejectedConnections() == 0);
+  // two go away, the two in the backlog take their places
+  g_cappedStats.live[0]->forceClose();
+  g_cappedStats.live[1]->forceClose();
+}
+
+void checkCapCleared()
+{
+  assert(g_cappedStats.accepted == 5);
+  assert(g_cappedStats.live.size() == 3);
+  assert(g_capped->acceptPaused());
+  assert(g_capped->rejectedConnections() == 0);
+  printf("connection cap OK\n");
+
+  connectClients(2012, 5);
+}
+
+void checkPerPeer()
+{
+  // a burst of 2, then 1 per second
+  assert(g_perPeerStats.accepted == 2);
+  assert(g_perPeer->rejectedConnections() == 3);
+  printf("per peer rate OK\n");
+
+  connectClients(2013, 10);
+}
+
+void checkAcceptRate(EventLoop* loop)
+{
+  assert(g_ratedStats.accepted == 10);
+  assert(g_rated->rejectedConnections() == 0);
+  assert(g_ratedStats.sawPaused);
+  // 10 per second with a burst of 1, 9 waits of 0.1s
+  double span = timeDifference(g_ratedStats.times.back(), g_ratedStats.times.front());
+  printf("10 accepts in %.2f seconds\n", span);
+  assert(span >= 0.85);
+  printf("accept rate OK\n");
+  loop->quit();
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+
+  TcpServer capped(&loop, InetAddress(2011), "Capped");
+  capped.setMaxConnections(3);
+  capped.setAcceptBudget(8);
+  capped.setConnectionCallback(boost::bind(onConnection, &capped, &g_cappedStats, _1));
+  capped.start();
+  g_capped = &capped;
+
+  TcpServer perPeer(&loop, InetAddress(2012), "PerPeer");
+  perPeer.setPerPeerRate(1, 2);
+  perPeer.setAcceptBudget(8);
+  perPeer.setConnectionCallback(boost::bind(onConnection, &perPeer, &g_perPeerStats, _1));
+  perPeer.start();
+  g_perPeer = &perPeer;
+
+  TcpServer rated(&loop, InetAddress(2013), "Rated");
+  rated.setAcceptRate(10, 1);
+  rated.setAcceptBudget(8);
+  rated.setConnectionCallback(boost::bind(onConnection, &rated, &g_ratedStats, _1));
+  rated.start();
+  g_rated = &rated;
+
+  connectClients(2011, 5);
+  loop.runAfter(0.5, checkCapReached);
+  loop.runAfter(1.0, checkCapCleared);
+  loop.runAfter(1.5, checkPerPeer);
+  loop.runAfter(3.5, boost::bind(checkAcceptRate, &loop));
+  loop.loop();
+
+  for (size_t i = 0; i < g_clients.size(); ++i)
+  {
+    ::close(g_clients[i]);
+  }
+  printf("OK\n");
+}
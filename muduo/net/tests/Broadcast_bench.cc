@@ -0,0 +1,190 @@
+// Fan-out of one message to many connections of a multi-threaded server,
+// TcpServer::broadcast() against a send() per connection.
+//
+// usage: broadcast_bench [copy|shared] [clients] [messages] [size]
+//
+// Every client checks the messages arrive whole and in order, including
+// a greeting that mixes shared and plain sends on a full socket.
+
+#include <muduo/net/TcpServer.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/Endian.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Mutex.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kGreetings = 3;
+const size_t kGreetingSize = 1024 * 1024;
+
+// int32 length, int32 sequence, payload
+string makeMessage(int32_t seq, size_t size)
+{
+  string message(size, 'x');
+  int32_t be32 = sockets::hostToNetwork32(static_cast<int32_t>(size - sizeof be32));
+  memcpy(&message[0], &be32, sizeof be32);
+  be32 = sockets::hostToNetwork32(seq);
+  memcpy(&message[sizeof be32], &be32, sizeof be32);
+  return message;
+}
+
+class Server : boost::noncopyable
+{
+ public:
+  Server(EventLoop* loop, const InetAddress& listenAddr)
+    : server_(loop, listenAddr, "Broadcast"),
+      greeting_(new string(makeMessage(0, kGreetingSize)))
+  {
+    server_.setConnectionCallback(boost::bind(&Server::onConnection, this, _1));
+    server_.setThreadNum(4);
+    server_.start();
+  }
+
+  void broadcast(const string& message)
+  {
+    server_.broadcast(message);
+  }
+
+  void sendOneByOne(const string& message)
+  {
+    MutexLockGuard lock(mutex_);
+    for (size_t i = 0; i < connections_.size(); ++i)
+    {
+      connections_[i]->send(message);
+    }
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      // shared, plain, shared: the plain one must wait behind the first
+      conn->send(greeting_);
+      conn->send(makeMessage(1, kGreetingSize));
+      conn->send(TcpConnection::SharedMessage(new string(makeMessage(2, kGreetingSize))));
+      MutexLockGuard lock(mutex_);
+      connections_.push_back(conn);
+    }
+  }
+
+  TcpServer server_;
+  const TcpConnection::SharedMessage greeting_;
+  MutexLock mutex_;
+  std::vector<TcpConnectionPtr> connections_;
+};
+
+class Client : boost::noncopyable
+{
+ public:
+  Client(EventLoop* loop, const InetAddress& serverAddr, int* done)
+    : client_(loop, serverAddr, "Client"),
+      next_(0),
+      done_(done)
+  {
+    client_.setMessageCallback(boost::bind(&Client::onMessage, this, _1, _2, _3));
+    client_.connect();
+  }
+
+  int received() const { return next_; }
+
+ private:
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    while (buf->readableBytes() >= sizeof(int32_t)
+           && buf->readableBytes() >= sizeof(int32_t) + static_cast<size_t>(buf->peekInt32()))
+    {
+      int32_t len = buf->readInt32();
+      int32_t seq = buf->readInt32();
+      if (seq != next_)
+      {
+        LOG_FATAL << "expect " << next_ << " got " << seq;
+      }
+      buf->retrieve(static_cast<size_t>(len) - sizeof seq);
+      ++next_;
+      ++*done_;
+    }
+  }
+
+  TcpClient client_;
+  int next_;
+  int* done_;
+};
+
+void waitFor(EventLoop* loop, const int* done, int expected, const char* what)
+{
+  Timestamp start(Timestamp::now());
+  while (*done < expected)
+  {
+    loop->loop();  // quit by check()
+  }
+  printf("%s %.3f s\n", what, timeDifference(Timestamp::now(), start));
+}
+
+void check(EventLoop* loop, const int* done, int expected)
+{
+  if (*done >= expected)
+  {
+    loop->quit();
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  bool shared = argc <= 1 || strcmp(argv[1], "copy") != 0;
+  int numClients = argc > 2 ? atoi(argv[2]) : 50;
+  int numMessages = argc > 3 ? atoi(argv[3]) : 1000;
+  size_t size = argc > 4 ? static_cast<size_t>(atoi(argv[4])) : 1024;
+  Logger::setLogLevel(Logger::WARN);
+  printf("%s, %d clients, %d messages of %zd bytes\n",
+         shared ? "broadcast" : "send per connection", numClients, numMessages, size);
+
+  // clients run in the base loop, the server connections in its io threads
+  EventLoop loop;
+  InetAddress serverAddr("127.0.0.1", 2032);
+  Server server(&loop, serverAddr);
+
+  int done = 0;
+  boost::ptr_vector<Client> clients;
+  for (int i = 0; i < numClients; ++i)
+  {
+    clients.push_back(new Client(&loop, serverAddr, &done));
+  }
+  int expected = numClients * kGreetings;
+  loop.runEvery(0.001, boost::bind(check, &loop, &done, boost::cref(expected)));
+  waitFor(&loop, &done, expected, "greetings");
+
+  std::vector<string> messages;
+  for (int i = 0; i < numMessages; ++i)
+  {
+    messages.push_back(makeMessage(kGreetings + i, size));
+  }
+  expected += numClients * numMessages;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < numMessages; ++i)
+  {
+    if (shared)
+      server.broadcast(messages[i]);
+    else
+      server.sendOneByOne(messages[i]);
+  }
+  printf("queued %.3f s\n", timeDifference(Timestamp::now(), start));
+  waitFor(&loop, &done, expected, "delivered");
+  double mbytes = static_cast<double>(numClients) * numMessages * static_cast<double>(size) / 1024 / 1024;
+  printf("%.1f MiB in %.3f s\n", mbytes, timeDifference(Timestamp::now(), start));
+  for (size_t i = 0; i < clients.size(); ++i)
+  {
+    assert(clients[i].received() == kGreetings + numMessages);
+  }
+}
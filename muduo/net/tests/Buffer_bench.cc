@@ -0,0 +1,164 @@
+#include <muduo/net/Buffer.h>
+#include <muduo/base/Timestamp.h>
+
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kRounds = 2000;
+
+// lines of about 100 bytes, like HTTP headers
+string makeLines(int nlines)
+{
+  string result;
+  for (int i = 0; i < nlines; ++i)
+  {
+    result.append(90 + i % 20, 'x');
+    result.append("\r\n");
+  }
+  return result;
+}
+
+void benchCRLF(const string& lines)
+{
+  const char kCRLF[] = "\r\n";
+  int64_t found = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kRounds; ++i)
+  {
+    const char* p = lines.data();
+    const char* end = p + lines.size();
+    const char* crlf;
+    while ((crlf = std::search(p, end, kCRLF, kCRLF+2)) != end)
+    {
+      ++found;
+      p = crlf + 2;
+    }
+  }
+  printf("std::search  %f %ld\n", timeDifference(Timestamp::now(), start), found);
+
+  found = 0;
+  start = Timestamp::now();
+  for (int i = 0; i < kRounds; ++i)
+  {
+    Buffer buf;
+    buf.append(lines);
+    const char* crlf;
+    while ((crlf = buf.findCRLF()) != NULL)
+    {
+      ++found;
+      buf.retrieveUntil(crlf + 2);
+    }
+  }
+  printf("findCRLF     %f %ld\n", timeDifference(Timestamp::now(), start), found);
+}
+
+void benchEOL(const string& lines)
+{
+  int64_t found = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kRounds; ++i)
+  {
+    const char* p = lines.data();
+    const char* end = p + lines.size();
+    const void* eol;
+    while ((eol = memchr(p, '\n', end - p)) != NULL)
+    {
+      ++found;
+      p = static_cast<const char*>(eol) + 1;
+    }
+  }
+  printf("memchr       %f %ld\n", timeDifference(Timestamp::now(), start), found);
+
+  found = 0;
+  start = Timestamp::now();
+  for (int i = 0; i < kRounds; ++i)
+  {
+    Buffer buf;
+    buf.append(lines);
+    const char* eol;
+    while ((eol = buf.findEOL()) != NULL)
+    {
+      ++found;
+      buf.retrieveUntil(eol + 1);
+    }
+  }
+  printf("findEOL      %f %ld\n", timeDifference(Timestamp::now(), start), found);
+}
+
+void benchAnyOf(const string& lines)
+{
+  const char delims[] = "\r\n:;";
+  int64_t found = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kRounds; ++i)
+  {
+    const char* p = lines.data();
+    const char* end = p + lines.size();
+    while ((p = std::find_first_of(p, end, delims, delims+4)) != end)
+    {
+      ++found;
+      ++p;
+    }
+  }
+  printf("find_first_of %f %ld\n", timeDifference(Timestamp::now(), start), found);
+
+  found = 0;
+  start = Timestamp::now();
+  for (int i = 0; i < kRounds; ++i)
+  {
+    Buffer buf;
+    buf.append(lines);
+    const char* p;
+    while ((p = buf.findAnyOf(delims)) != NULL)
+    {
+      ++found;
+      buf.retrieveUntil(p + 1);
+    }
+  }
+  printf("findAnyOf    %f %ld\n", timeDifference(Timestamp::now(), start), found);
+}
+
+// a 64k line arriving 1k at a time, searched after every piece
+void benchPartial()
+{
+  const string piece(1024, 'y');
+  const char kCRLF[] = "\r\n";
+  int64_t found = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kRounds / 10; ++i)
+  {
+    Buffer buf;
+    for (int j = 0; j < 64; ++j)
+    {
+      buf.append(piece);
+      const char* end = buf.beginWrite();
+      found += std::search(buf.peek(), end, kCRLF, kCRLF+2) != end;
+    }
+  }
+  printf("rescan       %f %ld\n", timeDifference(Timestamp::now(), start), found);
+
+  start = Timestamp::now();
+  for (int i = 0; i < kRounds / 10; ++i)
+  {
+    Buffer buf;
+    for (int j = 0; j < 64; ++j)
+    {
+      buf.append(piece);
+      found += buf.findCRLF() != NULL;
+    }
+  }
+  printf("resume       %f %ld\n", timeDifference(Timestamp::now(), start), found);
+}
+
+int main()
+{
+  string lines = makeLines(1000);
+  benchCRLF(lines);
+  benchEOL(lines);
+  benchAnyOf(lines);
+  benchPartial();
+}
@@ -5,8 +5,11 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 
+#include <unistd.h>
+
 using muduo::string;
 using muduo::net::Buffer;
+using muduo::net::ReadScratch;
 
 BOOST_AUTO_TEST_CASE(testBufferAppendRetrieve)
 {
@@ -100,6 +103,29 @@ BOOST_AUTO_TEST_CASE(testBufferShrink)
   BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
 }
 
+BOOST_AUTO_TEST_CASE(testBufferShrinkToFit)
+{
+  Buffer buf(0);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), Buffer::kCheapPrepend);
+
+  buf.append(string(2000, 'y'));
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 2000);
+  BOOST_CHECK_GE(buf.internalCapacity(), Buffer::kCheapPrepend+2000);
+
+  buf.retrieve(1500);
+  buf.shrinkToFit();
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 500);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), Buffer::kCheapPrepend+500);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string(500, 'y'));
+
+  buf.shrinkToFit();
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), Buffer::kCheapPrepend);
+}
+
 BOOST_AUTO_TEST_CASE(testBufferPrepend)
 {
   Buffer buf;
@@ -141,3 +167,100 @@ BOOST_AUTO_TEST_CASE(testBufferReadInt)
   BOOST_CHECK_EQUAL(buf.readInt16(), -1);
 }
 
+
+BOOST_AUTO_TEST_CASE(testBufferReadFdScratch)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(::pipe(fds), 0);
+  int savedErrno = 0;
+  ReadScratch scratch;
+
+  const string str(60000, 'y');
+  BOOST_REQUIRE_EQUAL(::write(fds[1], str.data(), str.size()), 60000);
+  Buffer buf;
+  BOOST_CHECK_EQUAL(buf.readFd(fds[0], &savedErrno, &scratch), 60000);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), str);
+  BOOST_CHECK_EQUAL(scratch.bytesRead(), 60000);
+  BOOST_CHECK_EQUAL(scratch.bytesCopied(), 60000 - Buffer::kInitialSize);
+  BOOST_CHECK_EQUAL(scratch.averageRead(), 60000 / 8);
+
+  // the spill storage stays with the scratch, no allocation per read
+  const char* spill = scratch.prepare()->beginWrite();
+  BOOST_REQUIRE_EQUAL(::write(fds[1], str.data(), str.size()), 60000);
+  BOOST_CHECK_EQUAL(buf.readFd(fds[0], &savedErrno, &scratch), 60000);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), str);
+  BOOST_CHECK(scratch.prepare()->beginWrite() == spill);
+
+  // an empty buffer borrows the lendable storage, nothing copied
+  const string str2(10000, 'z');
+  BOOST_REQUIRE_EQUAL(::write(fds[1], str2.data(), str2.size()), 10000);
+  Buffer small(0);
+  scratch.lend(&small);
+  const char* lent = small.beginWrite();
+  int64_t copied = scratch.bytesCopied();
+  BOOST_CHECK_EQUAL(small.readFd(fds[0], &savedErrno, &scratch), 10000);
+  BOOST_CHECK_EQUAL(scratch.bytesCopied(), copied);
+  small.retrieve(9990);
+  scratch.giveBack(&small);
+  BOOST_CHECK_EQUAL(small.retrieveAllAsString(), string(10, 'z'));
+
+  // and the same storage is lent next time
+  Buffer other(0);
+  scratch.lend(&other);
+  BOOST_CHECK(other.beginWrite() == lent);
+  scratch.giveBack(&other);
+  BOOST_CHECK_EQUAL(other.readableBytes(), 0u);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferFindDelimiters)
+{
+  // lengths around the vector widths, delimiter at every position
+  for (size_t len = 2; len < 80; ++len)
+  {
+    for (size_t pos = 0; pos + 1 < len; ++pos)
+    {
+      Buffer buf;
+      string str(len, 'a');
+      str[pos] = '\r';
+      str[pos+1] = '\n';
+      buf.append(str);
+      BOOST_CHECK_EQUAL(buf.findCRLF() - buf.peek(), static_cast<ssize_t>(pos));
+      BOOST_CHECK_EQUAL(buf.findEOL() - buf.peek(), static_cast<ssize_t>(pos+1));
+      BOOST_CHECK_EQUAL(buf.findAnyOf("\n\r") - buf.peek(), static_cast<ssize_t>(pos));
+      BOOST_CHECK_EQUAL(buf.findAnyOf(":;,\t\n") - buf.peek(), static_cast<ssize_t>(pos+1));
+      BOOST_CHECK(buf.findAnyOf("0123456789:;,\t\n") != NULL);
+      BOOST_CHECK(buf.findAnyOf("xyz") == NULL);
+    }
+  }
+
+  Buffer buf;
+  buf.append(string(100, 'a'));
+  BOOST_CHECK(buf.findCRLF() == NULL);
+  BOOST_CHECK(buf.findEOL() == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferFindCRLFResume)
+{
+  Buffer buf;
+  buf.append(string(100, 'a'));
+  buf.append("\r");
+  BOOST_CHECK(buf.findCRLF() == NULL);
+  // the trailing '\r' is scanned again
+  buf.append("\nbb\r\n");
+  const char* crlf = buf.findCRLF();
+  BOOST_CHECK_EQUAL(crlf - buf.peek(), 100);
+  BOOST_CHECK_EQUAL(buf.findEOL() - buf.peek(), 101);
+
+  buf.retrieveUntil(crlf + 2);
+  BOOST_CHECK_EQUAL(buf.findCRLF() - buf.peek(), 2);
+  BOOST_CHECK_EQUAL(buf.findEOL() - buf.peek(), 3);
+
+  buf.retrieve(1);
+  BOOST_CHECK_EQUAL(buf.findCRLF() - buf.peek(), 1);
+  buf.prepend("\r\n", 2);
+  BOOST_CHECK_EQUAL(buf.findCRLF() - buf.peek(), 0);
+  BOOST_CHECK_EQUAL(buf.findEOL() - buf.peek(), 1);
+}
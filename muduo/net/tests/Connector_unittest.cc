@@ -0,0 +1,112 @@
+#include <muduo/net/Connector.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/SocketsOps.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// A listening socket that never accepts, with its queue full, drops
+// further SYNs: every Connector to it stays in progress until the
+// connect timeout.
+
+typedef boost::shared_ptr<Connector> ConnectorPtr;
+
+const int kMaxConnecting = 8;
+int maxSeen = 0;
+int established = 0;
+int64_t attempts = 0;
+int64_t timeouts = 0;
+int inProgress = 0;
+
+void onConnection(int sockfd)
+{
+  ++established;
+  sockets::close(sockfd);
+}
+
+void sample()
+{
+  maxSeen = std::max(maxSeen, Connector::concurrentConnects());
+}
+
+void stopAll(EventLoop* loop, std::vector<ConnectorPtr>* connectors)
+{
+  attempts = Connector::connectAttempts();
+  timeouts = Connector::connectTimeouts();
+  inProgress = Connector::concurrentConnects();
+  for (size_t i = 0; i < connectors->size(); ++i)
+  {
+    (*connectors)[i]->stop();
+  }
+  loop->runAfter(0.1, boost::bind(&EventLoop::quit, loop));
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::ERROR);
+  EventLoop loop;
+
+  InetAddress blackhole("127.0.0.1", 2022);
+  int listenfd = sockets::createNonblockingOrDie();
+  sockets::bindOrDie(listenfd, blackhole.getSockAddrInet());
+  if (::listen(listenfd, 0) < 0)
+  {
+    LOG_SYSFATAL << "listen";
+  }
+  // fill the accept queue
+  std::vector<int> fillers;
+  for (int i = 0; i < 4; ++i)
+  {
+    int fd = sockets::createNonblockingOrDie();
+    sockets::connect(fd, blackhole.getSockAddrInet());
+    fillers.push_back(fd);
+  }
+
+  Connector::setMaxConcurrentConnects(kMaxConnecting);
+  std::vector<ConnectorPtr> connectors;
+  for (int i = 0; i < 50; ++i)
+  {
+    ConnectorPtr connector(new Connector(&loop, blackhole));
+    connector->setNewConnectionCallback(onConnection);
+    connector->setBackoffPolicy(i % 2 ? Connector::kFullJitter
+                                      : Connector::kDecorrelatedJitter);
+    connector->setConnectTimeout(0.3);
+    connector->start();
+    connectors.push_back(connector);
+  }
+
+  loop.runEvery(0.01, sample);
+  loop.runAfter(3.0, boost::bind(stopAll, &loop, &connectors));
+  loop.loop();
+
+  printf("max concurrent connects %d (limit %d), established %d, "
+         "attempts %lld, timed out %lld, in progress %d\n",
+         maxSeen, kMaxConnecting, established,
+         static_cast<long long>(attempts), static_cast<long long>(timeouts),
+         inProgress);
+  assert(maxSeen <= kMaxConnecting);
+  assert(maxSeen > 0);
+  assert(established == 0);
+  // every attempt that was over by then timed out
+  assert(attempts > kMaxConnecting);
+  assert(timeouts == attempts - inProgress);
+  // stop() gave the slots back
+  assert(Connector::concurrentConnects() == 0);
+  for (size_t i = 0; i < fillers.size(); ++i)
+  {
+    sockets::close(fillers[i]);
+  }
+  sockets::close(listenfd);
+  printf("OK\n");
+}
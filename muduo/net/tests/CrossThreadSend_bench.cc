@@ -0,0 +1,154 @@
+// Heap allocations and time per message of TcpConnection::send() and
+// EventLoop::runInLoop() called from outside the loop thread.
+//
+// usage: crossthreadsend_bench [messages] [size]
+
+#include <muduo/net/TcpServer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/SocketsOps.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+
+#include <boost/bind.hpp>
+
+#include <new>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int64_t g_allocations = 0;
+
+void* operator new(size_t size)
+{
+  __sync_fetch_and_add(&g_allocations, 1);
+  void* p = ::malloc(size ? size : 1);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) throw()
+{
+  ::free(p);
+}
+
+int64_t allocations()
+{
+  return __sync_fetch_and_add(&g_allocations, 0);
+}
+
+TcpConnectionPtr g_conn;
+CountDownLatch g_connected(1);
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_conn = conn;
+    g_connected.countDown();
+  }
+}
+
+struct Counter
+{
+  Counter() : sum(0) { }
+  void add(const string& s) { sum += s.size(); }
+  size_t sum;
+};
+
+// TcpServer lives in its loop thread
+void startServer(EventLoop* loop, const InetAddress& listenAddr,
+                 TcpServer** server, CountDownLatch* started)
+{
+  *server = new TcpServer(loop, listenAddr, "CrossThreadSend");
+  (*server)->setConnectionCallback(onConnection);
+  (*server)->start();
+  started->countDown();
+}
+
+void stopServer(TcpServer* server, CountDownLatch* stopped)
+{
+  delete server;
+  stopped->countDown();
+}
+
+void report(const char* what, int n, int64_t allocs, Timestamp start)
+{
+  printf("%-24s %6.2f allocations/msg %8.1f ns/msg\n", what,
+         static_cast<double>(allocs) / n,
+         timeDifference(Timestamp::now(), start) * 1e9 / n);
+}
+
+int main(int argc, char* argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 100000;
+  size_t size = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 100;
+  Logger::setLogLevel(Logger::WARN);
+
+  EventLoopThread thread;
+  EventLoop* loop = thread.startLoop();
+  InetAddress listenAddr("127.0.0.1", 2036);
+  TcpServer* server = NULL;
+  CountDownLatch started(1);
+  loop->runInLoop(boost::bind(startServer, loop, listenAddr, &server, &started));
+  started.wait();
+
+  int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sockets::connect(sockfd, listenAddr.getSockAddrInet()) < 0)
+  {
+    LOG_SYSFATAL << "connect";
+  }
+  g_connected.wait();
+  const string message(size, 'x');
+
+  {
+    Counter counter;
+    CountDownLatch done(1);
+    int64_t allocs = allocations();
+    Timestamp start(Timestamp::now());
+    for (int i = 0; i < n; ++i)
+    {
+      loop->runInLoop(boost::bind(&Counter::add, &counter, message));
+    }
+    loop->runInLoop(boost::bind(&CountDownLatch::countDown, &done));
+    done.wait();
+    report("runInLoop", n, allocations() - allocs, start);
+    assert(counter.sum == n * size);
+  }
+
+  {
+    int64_t allocs = allocations();
+    Timestamp start(Timestamp::now());
+    for (int i = 0; i < n; ++i)
+    {
+      g_conn->send(message);
+    }
+    char buf[65536];
+    size_t total = 0;
+    while (total < n * size)
+    {
+      ssize_t nr = sockets::read(sockfd, buf, sizeof buf);
+      assert(nr > 0);
+      total += static_cast<size_t>(nr);
+    }
+    report("TcpConnection::send", n, allocations() - allocs, start);
+  }
+
+  sockets::close(sockfd);
+  g_conn.reset();
+  // let the server see the close
+  CountDownLatch closed(1);
+  loop->runAfter(0.1, boost::bind(&CountDownLatch::countDown, &closed));
+  closed.wait();
+  CountDownLatch stopped(1);
+  loop->runInLoop(boost::bind(stopServer, server, &stopped));
+  stopped.wait();
+}
@@ -0,0 +1,146 @@
+#include <muduo/net/TcpServer.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/SocketsOps.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Three processes: "old" serves the port, "new" starts later and takes
+// over its listen socket, old drains and exits.  The client in the parent
+// connects all along and must never be refused.
+//
+// Each server answers with its name after 50ms, so some requests are in
+// flight when the old one starts draining.
+
+const char* kPath = "/tmp/muduo_handoff_unittest";
+const char* kStrangerPath = "/tmp/muduo_handoff_unittest_stranger";
+const uint16_t kPort = 2035;
+const uint16_t kStrangerPort = 2036;
+
+void reply(const TcpConnectionPtr& conn, const char* name)
+{
+  conn->send(name);
+  conn->shutdown();
+}
+
+void onConnection(EventLoop* loop, const char* name, const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    loop->runAfter(0.05, boost::bind(reply, conn, name));
+  }
+}
+
+void runOld()
+{
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress("127.0.0.1", kPort), "old");
+  server.setConnectionCallback(boost::bind(onConnection, &loop, "old", _1));
+  server.start();
+  server.enableHandoff(kPath,
+      boost::bind(&TcpServer::drain, &server, 1.0,
+                  TcpServer::DrainCallback(boost::bind(&EventLoop::quit, &loop))));
+  loop.loop();
+  printf("old: drained\n");
+  fflush(stdout);
+}
+
+void runNew()
+{
+  int listenfd = TcpServer::takeOverListenFd(kPath);
+  assert(listenfd >= 0);
+  EventLoop loop;
+  TcpServer server(&loop, listenfd, "new");
+  server.setConnectionCallback(boost::bind(onConnection, &loop, "new", _1));
+  server.start();
+  loop.runAfter(1.5, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+}
+
+// only hands off to another uid, so we must get nothing
+void runStranger()
+{
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress("127.0.0.1", kStrangerPort), "stranger");
+  server.start();
+  server.setHandoffUid(::geteuid() + 1);
+  server.enableHandoff(kStrangerPath,
+      boost::bind(&EventLoop::quit, &loop));
+  loop.runAfter(0.5, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+}
+
+pid_t spawn(void (*func)())
+{
+  pid_t pid = ::fork();
+  if (pid == 0)
+  {
+    func();
+    ::_exit(0);
+  }
+  return pid;
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::ERROR);
+  pid_t strangerPid = spawn(runStranger);
+  ::usleep(200 * 1000);
+  struct stat st;
+  assert(::stat(kStrangerPath, &st) == 0 && (st.st_mode & 0777) == 0600);
+  assert(TcpServer::takeOverListenFd(kStrangerPath) < 0);
+  (void) st;
+  int status = 0;
+  ::waitpid(strangerPid, &status, 0);
+
+  pid_t oldPid = spawn(runOld);
+  ::usleep(200 * 1000);
+
+  int answers[2] = { 0, 0 };
+  int refused = 0;
+  pid_t newPid = 0;
+  Timestamp start(Timestamp::now());
+  while (timeDifference(Timestamp::now(), start) < 1.2)
+  {
+    if (newPid == 0 && timeDifference(Timestamp::now(), start) > 0.4)
+    {
+      newPid = spawn(runNew);
+    }
+    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    InetAddress serverAddr("127.0.0.1", kPort);
+    if (sockets::connect(sockfd, serverAddr.getSockAddrInet()) < 0)
+    {
+      ++refused;
+    }
+    else
+    {
+      char buf[16] = "";
+      ssize_t n = sockets::read(sockfd, buf, sizeof buf - 1);
+      if (n > 0 && strcmp(buf, "old") == 0)
+        ++answers[0];
+      else if (n > 0 && strcmp(buf, "new") == 0)
+        ++answers[1];
+      else
+        ++refused;
+    }
+    sockets::close(sockfd);
+  }
+
+  ::waitpid(oldPid, &status, 0);
+  ::waitpid(newPid, &status, 0);
+  printf("answered by old %d, by new %d, refused %d\n",
+         answers[0], answers[1], refused);
+  assert(answers[0] > 0 && answers[1] > 0 && refused == 0);
+}
@@ -0,0 +1,66 @@
+#include <muduo/net/TcpServer.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/base/Logging.h>
+
+#include <boost/bind.hpp>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+Timestamp g_start;
+double g_closed[2];
+
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+  LOG_INFO << conn->name() << (conn->connected() ? " UP" : " DOWN");
+}
+
+void onClientConnection(int i, const TcpConnectionPtr& conn)
+{
+  if (!conn->connected())
+  {
+    g_closed[i] = timeDifference(Timestamp::now(), g_start);
+    printf("client %d closed after %.1f seconds\n", i, g_closed[i]);
+  }
+}
+
+void chat(TcpClient* client)
+{
+  TcpConnectionPtr conn = client->connection();
+  if (conn && conn->connected())
+  {
+    conn->send("hello\n");
+  }
+}
+
+int main()
+{
+  EventLoop loop;
+  InetAddress listenAddr(2010);
+  TcpServer server(&loop, listenAddr, "IdleServer");
+  server.setReadIdleTimeout(2);
+  server.setMaxLifetime(5);
+  server.setConnectionCallback(onServerConnection);
+  server.start();
+
+  // client 0 says nothing, client 1 talks every half a second
+  TcpClient silent(&loop, listenAddr, "Silent");
+  silent.setConnectionCallback(boost::bind(onClientConnection, 0, _1));
+  TcpClient chatty(&loop, listenAddr, "Chatty");
+  chatty.setConnectionCallback(boost::bind(onClientConnection, 1, _1));
+
+  g_start = Timestamp::now();
+  silent.connect();
+  chatty.connect();
+  loop.runEvery(0.5, boost::bind(chat, &chatty));
+  loop.runAfter(7.0, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  assert(2.0 <= g_closed[0] && g_closed[0] < 3.5);
+  assert(5.0 <= g_closed[1] && g_closed[1] < 6.5);
+  printf("OK\n");
+}
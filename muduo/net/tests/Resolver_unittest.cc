@@ -0,0 +1,252 @@
+#include <muduo/net/Resolver.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/Channel.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+#include <muduo/net/SocketsOps.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+
+#include <map>
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// A stub DNS server on the same loop:
+//   a.test      A 10.0.0.1, TTL 1
+//   local.test  A 127.0.0.1, TTL 60
+//   nx.test     NXDOMAIN, SOA minimum 1
+//   slow.test   never answers
+//   gone.test   never answers
+
+class StubDns : boost::noncopyable
+{
+ public:
+  StubDns(EventLoop* loop, const InetAddress& listenAddr)
+    : sockfd_(::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)),
+      channel_(loop, sockfd_)
+  {
+    sockets::bindOrDie(sockfd_, listenAddr.getSockAddrInet());
+    channel_.setReadCallback(boost::bind(&StubDns::handleRead, this));
+    channel_.enableReading();
+  }
+
+  ~StubDns()
+  {
+    channel_.disableAll();
+    channel_.remove();
+    sockets::close(sockfd_);
+  }
+
+  int queries(const string& name) { return queries_[name]; }
+  uint16_t port(const string& name) { return ports_[name]; }
+
+ private:
+  void handleRead()
+  {
+    char buf[512];
+    struct sockaddr_in from;
+    socklen_t len = sizeof from;
+    ssize_t n = ::recvfrom(sockfd_, buf, sizeof buf, 0,
+                           static_cast<struct sockaddr*>(implicit_cast<void*>(&from)),
+                           &len);
+    if (n < 12)
+      return;
+
+    // question is the single name after the header
+    string name;
+    size_t pos = 12;
+    while (pos < static_cast<size_t>(n) && buf[pos] != 0)
+    {
+      size_t labelLen = static_cast<uint8_t>(buf[pos]);
+      if (!name.empty())
+        name.push_back('.');
+      name.append(buf + pos + 1, labelLen);
+      pos += 1 + labelLen;
+    }
+    size_t questionEnd = pos + 1 + 4;
+    ++queries_[name];
+    ports_[name] = from.sin_port;
+    if (name == "slow.test" || name == "gone.test")
+      return;
+
+    string answer(buf, questionEnd);
+    answer[2] = static_cast<char>(0x81);  // QR RD
+    answer[3] = static_cast<char>(0x80);  // RA
+    if (name == "a.test" || name == "local.test")
+    {
+      answer[7] = 1;  // ANCOUNT
+      const char rr[] = { '\xc0', 12, 0, 1, 0, 1 };
+      answer.append(rr, sizeof rr);
+      appendUInt32(&answer, name == "a.test" ? 1 : 60);
+      answer.push_back(0);
+      answer.push_back(4);
+      const char* ip = name == "a.test" ? "10.0.0.1" : "127.0.0.1";
+      struct in_addr addr;
+      ::inet_pton(AF_INET, ip, &addr);
+      answer.append(reinterpret_cast<const char*>(&addr), 4);
+    }
+    else
+    {
+      answer[3] = static_cast<char>(0x83);  // RA NXDOMAIN
+      answer[9] = 1;  // NSCOUNT
+      const char rr[] = { '\xc0', 12, 0, 6, 0, 1 };
+      answer.append(rr, sizeof rr);
+      appendUInt32(&answer, 60);
+      answer.push_back(0);
+      answer.push_back(2 + 2 + 20);
+      const char names[] = { '\xc0', 12, '\xc0', 12 };
+      answer.append(names, sizeof names);
+      for (int i = 0; i < 4; ++i)
+        appendUInt32(&answer, 3600);
+      appendUInt32(&answer, 1);  // MINIMUM
+    }
+    ::sendto(sockfd_, answer.data(), answer.size(), 0,
+             static_cast<struct sockaddr*>(implicit_cast<void*>(&from)), len);
+  }
+
+  static void appendUInt32(string* out, uint32_t x)
+  {
+    for (int shift = 24; shift >= 0; shift -= 8)
+      out->push_back(static_cast<char>((x >> shift) & 0xFF));
+  }
+
+  int sockfd_;
+  Channel channel_;
+  std::map<string, int> queries_;
+  std::map<string, uint16_t> ports_;  // of the last query
+};
+
+StubDns* g_dns;
+int g_answers = 0;
+
+void expect(const char* name, bool expectFound, const char* expectIp,
+            bool found, const InetAddress& addr)
+{
+  printf("%s: %s %s\n", name, found ? "found" : "not found",
+         addr.toIp().c_str());
+  assert(found == expectFound);
+  assert(!found || addr.toIp() == expectIp);
+  (void)expectFound;
+  (void)expectIp;
+  ++g_answers;
+}
+
+// runs in another loop, cache hits need no query
+void lookupInOtherLoop(EventLoop* loop, const std::vector<InetAddress>* servers)
+{
+  Resolver resolver(loop, *servers);
+  int before = g_answers;
+  resolver.resolve("A.Test.", boost::bind(expect, "a.test other loop", true, "10.0.0.1", _1, _2));
+  assert(g_answers == before + 1);
+  (void)before;
+}
+
+void step1(Resolver* resolver)
+{
+  resolver->resolve("a.test", boost::bind(expect, "a.test", true, "10.0.0.1", _1, _2));
+  resolver->resolve("a.test", boost::bind(expect, "a.test shared", true, "10.0.0.1", _1, _2));
+  resolver->resolve("nx.test", boost::bind(expect, "nx.test", false, "", _1, _2));
+  resolver->resolve("slow.test", boost::bind(expect, "slow.test", false, "", _1, _2));
+  resolver->resolve("1.2.3.4", boost::bind(expect, "literal", true, "1.2.3.4", _1, _2));
+}
+
+// a client that goes away with its resolve in flight, and one with a
+// retry pending, must not be called back
+void connectDoomed(EventLoop* loop, TcpClient** pending, TcpClient** retrying)
+{
+  *pending = new TcpClient(loop, "gone.test", 2031, "pending");
+  (*pending)->connect();
+  *retrying = new TcpClient(loop, "nx2.test", 2031, "retrying");
+  (*retrying)->enableRetry();
+  (*retrying)->connect();
+}
+
+void destroyDoomed(TcpClient** pending, TcpClient** retrying)
+{
+  assert(g_dns->queries("gone.test") == 1);
+  assert(g_dns->queries("nx2.test") == 1);
+  delete *pending;
+  delete *retrying;
+  *pending = NULL;
+  *retrying = NULL;
+}
+
+void step2(Resolver* resolver, EventLoopThread* other,
+           const std::vector<InetAddress>* servers)
+{
+  assert(g_dns->queries("a.test") == 1);
+  // sent together, each from a port of its own
+  assert(g_dns->port("a.test") != g_dns->port("nx.test"));
+  assert(g_dns->port("a.test") != g_dns->port("slow.test"));
+  assert(g_dns->port("nx.test") != g_dns->port("slow.test"));
+  resolver->resolve("a.test", boost::bind(expect, "a.test cached", true, "10.0.0.1", _1, _2));
+  resolver->resolve("nx.test", boost::bind(expect, "nx.test cached", false, "", _1, _2));
+  assert(g_dns->queries("a.test") == 1);
+  assert(g_dns->queries("nx.test") == 1);
+  EventLoop* loop = other->startLoop();
+  loop->runInLoop(boost::bind(lookupInOtherLoop, loop, servers));
+}
+
+void step3(Resolver* resolver)
+{
+  // TTL of 1 second is over
+  resolver->resolve("a.test", boost::bind(expect, "a.test expired", true, "10.0.0.1", _1, _2));
+}
+
+void onClientConnection(EventLoop* loop, const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    printf("connected to %s by name\n", conn->peerAddress().toIpPort().c_str());
+    printf("queries: a.test %d, nx.test %d, slow.test %d, local.test %d\n",
+           g_dns->queries("a.test"), g_dns->queries("nx.test"),
+           g_dns->queries("slow.test"), g_dns->queries("local.test"));
+    assert(g_dns->queries("a.test") == 2);
+    assert(g_dns->queries("slow.test") == 1);
+    loop->quit();
+  }
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  InetAddress dnsAddr("127.0.0.1", 10053);
+  StubDns dns(&loop, dnsAddr);
+  g_dns = &dns;
+
+  std::vector<InetAddress> servers;
+  servers.push_back(dnsAddr);
+  Resolver::setDefaultNameservers(servers);
+  Resolver resolver(&loop, servers);
+  resolver.setTimeout(0.2);
+  resolver.setAttempts(1);
+
+  EventLoopThread other;
+  loop.runAfter(0.1, boost::bind(step1, &resolver));
+  loop.runAfter(0.5, boost::bind(step2, &resolver, &other, &servers));
+  loop.runAfter(1.5, boost::bind(step3, &resolver));
+
+  TcpClient* pending = NULL;
+  TcpClient* retrying = NULL;
+  loop.runAfter(0.1, boost::bind(connectDoomed, &loop, &pending, &retrying));
+  loop.runAfter(0.15, boost::bind(destroyDoomed, &pending, &retrying));
+
+  InetAddress serverAddr("127.0.0.1", 2031);
+  TcpServer server(&loop, serverAddr, "server");
+  server.start();
+  TcpClient client(&loop, "local.test", 2031, "client");
+  client.setConnectionCallback(boost::bind(onClientConnection, &loop, _1));
+  loop.runAfter(2.0, boost::bind(&TcpClient::connect, &client));
+
+  loop.loop();
+  printf("%d answers\n", g_answers);
+}
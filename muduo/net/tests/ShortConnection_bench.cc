@@ -0,0 +1,156 @@
+// Latency of short request/response connections over loopback,
+// with and without TCP_DEFER_ACCEPT and TCP_FASTOPEN.
+//
+// usage: shortconnection_bench [defer] [fastopen] [count]
+// fastopen needs net.ipv4.tcp_fastopen = 3 on the host.
+
+#include <muduo/net/TcpServer.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/base/Logging.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const char kRequest[] = "GET / HTTP/1.0\r\n\r\n";
+const char kResponse[] = "HTTP/1.0 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+
+void onRequest(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  if (buf->readableBytes() >= sizeof kRequest - 1)
+  {
+    buf->retrieveAll();
+    conn->send(kResponse, sizeof kResponse - 1);
+    conn->shutdown();
+  }
+}
+
+class Bench : boost::noncopyable
+{
+ public:
+  Bench(EventLoop* loop, const InetAddress& serverAddr, bool fastOpen, int count)
+    : loop_(loop),
+      serverAddr_(serverAddr),
+      fastOpen_(fastOpen),
+      count_(count)
+  {
+    latencies_.reserve(count);
+  }
+
+  void start()
+  {
+    start_ = Timestamp::now();
+    client_.reset(new TcpClient(loop_, serverAddr_, "Bench"));
+    client_->setFastOpen(fastOpen_);
+    client_->setConnectionCallback(boost::bind(&Bench::onConnection, this, _1));
+    client_->setMessageCallback(boost::bind(&Bench::onResponse, this, _1, _2, _3));
+    client_->connect();
+  }
+
+  void report()
+  {
+    std::sort(latencies_.begin(), latencies_.end());
+    double sum = 0;
+    for (size_t i = 0; i < latencies_.size(); ++i)
+    {
+      sum += latencies_[i];
+    }
+    printf("%zd connections, mean %.1f us, p50 %.1f us, p99 %.1f us\n",
+           latencies_.size(), sum / static_cast<double>(latencies_.size()),
+           latencies_[latencies_.size() / 2],
+           latencies_[latencies_.size() * 99 / 100]);
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setTcpNoDelay(true);
+      conn->send(kRequest, sizeof kRequest - 1);
+    }
+    else
+    {
+      latencies_.push_back(timeDifference(Timestamp::now(), start_) * 1e6);
+      // can't destroy client_ inside its own callback
+      loop_->queueInLoop(boost::bind(&Bench::next, this));
+    }
+  }
+
+  void onResponse(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    buf->retrieveAll();
+  }
+
+  void next()
+  {
+    client_.reset();
+    if (static_cast<int>(latencies_.size()) < count_)
+    {
+      start();
+    }
+    else
+    {
+      // let the server see the last close
+      loop_->runAfter(0.1, boost::bind(&EventLoop::quit, loop_));
+    }
+  }
+
+  EventLoop* loop_;
+  const InetAddress serverAddr_;
+  const bool fastOpen_;
+  const int count_;
+  Timestamp start_;
+  boost::scoped_ptr<TcpClient> client_;
+  std::vector<double> latencies_;
+};
+
+int main(int argc, char* argv[])
+{
+  bool defer = false;
+  bool fastOpen = false;
+  int count = 10000;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "defer") == 0)
+      defer = true;
+    else if (strcmp(argv[i], "fastopen") == 0)
+      fastOpen = true;
+    else
+      count = atoi(argv[i]);
+  }
+  Logger::setLogLevel(Logger::WARN);
+  printf("defer accept %d, fast open %d\n", defer, fastOpen);
+
+  // client and server share one loop, the server runs its callbacks
+  // inline as a single-threaded server does
+  EventLoop loop;
+  InetAddress serverAddr("127.0.0.1", 2020);
+  TcpServer server(&loop, serverAddr, "ShortConnection");
+  if (defer)
+  {
+    server.setDeferAccept(1);
+  }
+  if (fastOpen)
+  {
+    server.setFastOpen(128);
+  }
+  server.setMessageCallback(onRequest);
+  server.setAcceptBudget(16);
+  server.start();
+
+  Bench bench(&loop, serverAddr, fastOpen, count);
+  bench.start();
+  loop.loop();
+  bench.report();
+}
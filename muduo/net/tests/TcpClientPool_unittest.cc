@@ -0,0 +1,223 @@
+#include <muduo/net/TcpClientPool.h>
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#define __STDC_FORMAT_MACROS
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Two backends: "good" answers every line, "blackhole" reads and never
+// answers.  Requests should drift to the good backend, and connections to
+// the blackhole get evicted by the request timeout.  One connection is
+// evicted for failures on the way.  Checked when a connection comes back
+// after that.
+//
+// Then pools are destroyed while all their connections are up, with
+// closes of some of them still queued in the IO loops.
+
+const int kConnections = 4;
+const int kDestroyRounds = 10;
+
+EventLoop* g_loop = NULL;
+boost::scoped_ptr<TcpClientPool> g_pool;
+std::vector<InetAddress> g_backends;
+
+AtomicInt64 goodReplies;
+int sent = 0;
+int toGood = 0;
+int toBlackhole = 0;
+int64_t failureEvictions = -1;  // not yet
+bool reported = false;
+int destroyed = 0;
+TimerId sendTimer;
+
+void onServerMessage(bool reply, const TcpConnectionPtr& conn,
+                     Buffer* buf, Timestamp)
+{
+  const char* eol;
+  while ((eol = buf->findEOL()) != NULL)
+  {
+    if (reply)
+    {
+      conn->send(buf->peek(), static_cast<int>(eol + 1 - buf->peek()));
+    }
+    buf->retrieveUntil(eol + 1);
+  }
+}
+
+void onClientMessage(TcpClientPool* pool, const TcpConnectionPtr& conn,
+                     Buffer* buf, Timestamp)
+{
+  const char* eol;
+  while ((eol = buf->findEOL()) != NULL)
+  {
+    buf->retrieveUntil(eol + 1);
+    pool->release(conn);
+    goodReplies.increment();
+  }
+}
+
+void sendSome(const string& good)
+{
+  for (int i = 0; i < 10; ++i)
+  {
+    TcpConnectionPtr conn = g_pool->acquire();
+    if (conn)
+    {
+      ++sent;
+      if (conn->peerAddress().toIpPort() == good)
+        ++toGood;
+      else
+        ++toBlackhole;
+      conn->send("hello\n");
+    }
+  }
+}
+
+void failSome()
+{
+  TcpClientPool* pool = get_pointer(g_pool);
+  TcpConnectionPtr conn = pool->acquire();
+  assert(conn);
+  int64_t before = pool->evictions();
+  pool->release(conn, false);
+  pool->release(conn, false);
+  assert(pool->pending(conn) >= 0);
+  pool->release(conn, false);  // the third one in a row
+  assert(pool->pending(conn) == -1);
+  failureEvictions = pool->evictions() - before;
+  assert(failureEvictions >= 1);
+}
+
+void startDestroyRound();
+void check();
+
+// in the IO loops
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_loop->queueInLoop(check);
+  }
+}
+
+void report()
+{
+  TcpClientPool* pool = get_pointer(g_pool);
+  printf("sent %d, to good %d, to blackhole %d, replies %" PRId64
+         ", evictions %" PRId64 ", connected %d\n",
+         sent, toGood, toBlackhole, goodReplies.get(),
+         pool->evictions(), pool->numConnected());
+  // the good backend answers all but what was in flight
+  assert(goodReplies.get() > 0);
+  assert(goodReplies.get() + 100 >= toGood);
+  // least pending first, the blackhole only gets a few before it fills up
+  assert(toGood > 10 * toBlackhole);
+  assert(toBlackhole > 0);
+  // both blackhole connections timed out at least once
+  assert(pool->evictions() >= failureEvictions + 2);
+  // evicted connections are back, by retry
+  assert(pool->numConnected() == kConnections);
+  g_loop->cancel(sendTimer);
+  reported = true;
+}
+
+// pool with requests in flight, closes queued in its loops
+void destroyPool()
+{
+  for (int i = 0; i < kConnections; ++i)
+  {
+    TcpConnectionPtr conn = g_pool->acquire();
+    assert(conn);
+    conn->send("hello\n");
+    if (i % 2 == 0)
+    {
+      conn->forceClose();
+    }
+  }
+  g_pool.reset();
+  ++destroyed;
+  if (destroyed < kDestroyRounds)
+  {
+    startDestroyRound();
+  }
+  else
+  {
+    // anything still queued for the destroyed pools runs before quit
+    g_loop->runAfter(0.5, boost::bind(&EventLoop::quit, g_loop));
+  }
+}
+
+// in the base loop, after a connection came up
+void check()
+{
+  if (!g_pool || g_pool->numConnected() < kConnections)
+  {
+    return;
+  }
+  if (!reported)
+  {
+    if (failureEvictions >= 0 && g_pool->evictions() >= failureEvictions + 2)
+    {
+      report();
+      destroyPool();
+    }
+  }
+  else
+  {
+    destroyPool();
+  }
+}
+
+void startPool(double requestTimeout)
+{
+  g_pool.reset(new TcpClientPool(g_loop, g_backends, "pool"));
+  g_pool->setThreadNum(2);
+  g_pool->setConnectionsPerServer(kConnections / 2);
+  g_pool->setRequestTimeout(requestTimeout);
+  g_pool->setConnectionCallback(onConnection);
+  g_pool->setMessageCallback(boost::bind(onClientMessage, get_pointer(g_pool), _1, _2, _3));
+  g_pool->start();
+}
+
+void startDestroyRound()
+{
+  startPool(0);
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  InetAddress goodAddr("127.0.0.1", 2020);
+  InetAddress blackholeAddr("127.0.0.1", 2021);
+
+  TcpServer good(&loop, goodAddr, "good");
+  good.setMessageCallback(boost::bind(onServerMessage, true, _1, _2, _3));
+  good.start();
+  TcpServer blackhole(&loop, blackholeAddr, "blackhole");
+  blackhole.setMessageCallback(boost::bind(onServerMessage, false, _1, _2, _3));
+  blackhole.start();
+
+  g_loop = &loop;
+  g_backends.push_back(goodAddr);
+  g_backends.push_back(blackholeAddr);
+  startPool(1.0);
+
+  sendTimer = loop.runEvery(0.01, boost::bind(sendSome, goodAddr.toIpPort()));
+  loop.runAfter(0.5, failSome);
+  loop.loop();
+  assert(reported);
+  assert(destroyed == kDestroyRounds);
+  printf("OK\n");
+}